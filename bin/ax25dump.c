@@ -29,38 +29,171 @@ static void usage(int argc, char **argv, const char *message, ...) {
         va_end(args);
     }
 
-    fprintf(stderr, "usage: %s [-s patty.sock] -i ifname\n"
+    fprintf(stderr, "usage: %s [-s patty.sock] [-m] -i ifname [expression]\n"
                     "       %s /dev/ttyXYZ [tioarg ...]\n"
                     "       %s file.cap\n", argv[0], argv[0], argv[0]);
 
     exit(EX_USAGE);
 }
 
+static int dump_frame(void *buf, ssize_t readlen) {
+    ssize_t decoded,
+            offset = 0;
+
+    patty_ax25_frame frame;
+
+    if ((decoded = patty_ax25_frame_decode_address(&frame, buf, readlen)) < 0) {
+        printf("Invalid frame address\n");
+
+        goto error_ax25_frame_decode_address;
+    } else {
+        offset += decoded;
+    }
+
+    if ((decoded = patty_ax25_frame_decode_control(&frame, PATTY_AX25_FRAME_NORMAL, buf, decoded, readlen)) < 0) {
+        printf("Invalid frame control\n");
+
+        goto error_ax25_frame_decode_control;
+    } else {
+        offset += decoded;
+    }
+
+    if (patty_print_frame_header(stdout, &frame) < 0) {
+        goto error_io;
+    }
+
+    if (frame.type == PATTY_AX25_FRAME_XID) {
+        patty_ax25_params params;
+
+        if (patty_ax25_frame_decode_xid(&params,
+                                        buf,
+                                        offset,
+                                        readlen) < 0) {
+            printf("Invalid XID parameters\n");
+
+            goto error_ax25_frame_decode_xid;
+        } else {
+            if (patty_print_params(stdout, &params) < 0) {
+                goto error_io;
+            }
+        }
+    }
+
+error_ax25_frame_decode_xid:
+error_ax25_frame_decode_control:
+error_ax25_frame_decode_address:
+    if (patty_print_hexdump(stdout, buf, readlen) < 0) {
+        goto error_io;
+    }
+
+    if (fflush(stdout) < 0) {
+        goto error_io;
+    }
+
+    return 0;
+
+error_io:
+    return -1;
+}
+
+/*
+ * Join the remaining arguments into a single filter expression
+ */
+static char *filter_expr(int argc, char **argv) {
+    char *expr;
+    size_t len = 1;
+    int i;
+
+    for (i=0; i<argc; i++) {
+        len += strlen(argv[i]) + 1;
+    }
+
+    if ((expr = malloc(len)) == NULL) {
+        return NULL;
+    }
+
+    expr[0] = '\0';
+
+    for (i=0; i<argc; i++) {
+        if (i) strcat(expr, " ");
+
+        strcat(expr, argv[i]);
+    }
+
+    return expr;
+}
+
+static int dump_tap(patty_ax25_tap *tap,
+                    const patty_ax25_filter *filter,
+                    void *buf) {
+    while (1) {
+        patty_ax25_tap_info info;
+        ssize_t readlen;
+
+        while ((readlen = patty_ax25_tap_read(tap,
+                                              buf,
+                                              AX25DUMP_BUFSZ,
+                                              &info)) > 0) {
+            if (info.dropped) {
+                printf("(%zu frames dropped)\n", info.dropped);
+            }
+
+            /*
+             * Frames read from a tap are filtered here rather than within
+             * the daemon, which writes every frame once for all consumers
+             */
+            if (filter && !patty_ax25_filter_run(filter, buf, readlen)) {
+                continue;
+            }
+
+            if (dump_frame(buf, readlen) < 0) {
+                goto error_io;
+            }
+        }
+
+        if (patty_ax25_tap_wait(tap) < 0) {
+            goto error_io;
+        }
+    }
+
+    return 0;
+
+error_io:
+    return -1;
+}
+
 int main(int argc, char **argv) {
     patty_client *client = NULL;
 
     struct option opts[] = {
         { "sock", required_argument, NULL, 's' },
         { "if",   required_argument, NULL, 'i' },
+        { "mmap", no_argument,       NULL, 'm' },
         { NULL,   0,                 NULL,  0  }
     };
 
     void *buf;
     ssize_t readlen;
+    size_t dropped = 0;
 
     char *sock   = NULL,
          *ifname = NULL;
 
+    int use_tap = 0;
+
     patty_kiss_tnc_info info;
-    patty_kiss_tnc *raw;
+    patty_kiss_tnc *raw = NULL;
+    patty_ax25_tap *tap = NULL;
+    patty_ax25_filter *filter = NULL;
 
     int index,
         ch;
 
-    while ((ch = getopt_long(argc, argv, "s:i:", opts, &index)) >= 0) {
+    while ((ch = getopt_long(argc, argv, "s:i:m", opts, &index)) >= 0) {
         switch (ch) {
             case 's': sock   = optarg; break;
             case 'i': ifname = optarg; break;
+            case 'm': use_tap = 1;     break;
 
             default:
                 usage(argc, argv, NULL);
@@ -69,13 +202,29 @@ int main(int argc, char **argv) {
 
     memset(&info, '\0', sizeof(info));
 
+    if (use_tap && !ifname) {
+        usage(argc, argv, "-m requires -i");
+    }
+
     if (ifname) {
         patty_client_setsockopt_if ifreq;
+        char *expr;
+
+        if ((expr = filter_expr(argc - optind, argv + optind)) == NULL) {
+            goto error_filter_expr;
+        }
+
+        if ((filter = patty_ax25_filter_compile(expr)) == NULL) {
+            fprintf(stderr, "%s: %s: Invalid filter expression\n",
+                argv[0], expr);
+
+            free(expr);
 
-        if (optind < argc) {
-            usage(argc, argv, "Too many arguments provided");
+            goto error_filter_compile;
         }
 
+        free(expr);
+
         info.flags = PATTY_KISS_TNC_FD;
 
         if ((client = patty_client_new(sock)) == NULL) {
@@ -92,15 +241,35 @@ int main(int argc, char **argv) {
             goto error_client_socket;
         }
 
-        patty_strlcpy(ifreq.name, ifname, sizeof(ifreq.name));
+        if (use_tap) {
+            if ((tap = patty_client_tap(client, info.fd, ifname)) == NULL) {
+                fprintf(stderr, "%s: %s: %s: %s\n",
+                    argv[0], "patty_client_tap()", ifname, strerror(errno));
 
-        ifreq.state = PATTY_AX25_SOCK_PROMISC;
+                goto error_client_setsockopt;
+            }
+        } else {
+            if (patty_client_setsockopt(client,
+                                        info.fd,
+                                        PATTY_AX25_SOCK_FILTER,
+                                        (void *)patty_ax25_filter_insns(filter),
+                                        patty_ax25_filter_count(filter) * sizeof(patty_ax25_filter_insn)) < 0) {
+                fprintf(stderr, "%s: %s: %s\n",
+                    argv[0], "patty_client_setsockopt()", strerror(errno));
+
+                goto error_client_setsockopt;
+            }
 
-        if (patty_client_setsockopt(client, info.fd, PATTY_AX25_SOCK_IF, &ifreq, sizeof(ifreq)) < 0) {
-            fprintf(stderr, "%s: %s: %s: %s\n",
-                argv[0], "patty_client_setsockopt()", ifname, strerror(errno));
+            patty_strlcpy(ifreq.name, ifname, sizeof(ifreq.name));
 
-            goto error_client_setsockopt;
+            ifreq.state = PATTY_AX25_SOCK_PROMISC;
+
+            if (patty_client_setsockopt(client, info.fd, PATTY_AX25_SOCK_IF, &ifreq, sizeof(ifreq)) < 0) {
+                fprintf(stderr, "%s: %s: %s: %s\n",
+                    argv[0], "patty_client_setsockopt()", ifname, strerror(errno));
+
+                goto error_client_setsockopt;
+            }
         }
     } else {
         patty_error e;
@@ -117,78 +286,54 @@ int main(int argc, char **argv) {
         }
     }
 
-    if ((raw = patty_kiss_tnc_new(&info)) == NULL) {
-        fprintf(stderr, "%s: fd %d: %s: %s\n",
-            argv[0], info.fd, "patty_kiss_tnc_new()", strerror(errno));
+    if (tap == NULL) {
+        if ((raw = patty_kiss_tnc_new(&info)) == NULL) {
+            fprintf(stderr, "%s: fd %d: %s: %s\n",
+                argv[0], info.fd, "patty_kiss_tnc_new()", strerror(errno));
 
-        goto error_kiss_tnc_new;
+            goto error_kiss_tnc_new;
+        }
     }
 
     if ((buf = malloc(AX25DUMP_BUFSZ)) == NULL) {
         goto error_malloc_buf;
     }
 
-    while ((readlen = patty_kiss_tnc_recv(raw, buf, AX25DUMP_BUFSZ)) > 0) {
-        ssize_t decoded,
-                offset = 0;
-
-        patty_ax25_frame frame;
-
-        if ((decoded = patty_ax25_frame_decode_address(&frame, buf, readlen)) < 0) {
-            printf("Invalid frame address\n");
-
-            goto error_ax25_frame_decode_address;
-        } else {
-            offset += decoded;
-        }
-
-        if ((decoded = patty_ax25_frame_decode_control(&frame, PATTY_AX25_FRAME_NORMAL, buf, decoded, readlen)) < 0) {
-            printf("Invalid frame control\n");
-
-            goto error_ax25_frame_decode_control;
-        } else {
-            offset += decoded;
-        }
-
-        if (patty_print_frame_header(stdout, &frame) < 0) {
+    if (tap) {
+        if (dump_tap(tap, filter, buf) < 0) {
             fprintf(stderr, "%s: %s: %s\n",
-                argv[0], "patty_print_frame_header()", strerror(errno));
+                argv[0], "dump_tap()", strerror(errno));
 
             goto error_io;
         }
+    }
 
-        if (frame.type == PATTY_AX25_FRAME_XID) {
-            patty_ax25_params params;
+    while (raw && (readlen = patty_kiss_tnc_recv(raw, buf, AX25DUMP_BUFSZ)) > 0) {
+        patty_ax25_if_stats *stats = patty_kiss_tnc_stats(raw);
 
-            if (patty_ax25_frame_decode_xid(&params,
-                                            buf,
-                                            offset,
-                                            readlen) < 0) {
-                printf("Invalid XID parameters\n");
+        /*
+         * The daemon reports frames it had to drop while we were not
+         * keeping up, ahead of the next frame it delivers
+         */
+        if (stats->dropped != dropped) {
+            printf("(%zu frames dropped)\n", stats->dropped - dropped);
 
-                goto error_ax25_frame_decode_xid;
-            } else {
-                if (patty_print_params(stdout, &params) < 0) {
-                    goto error_io;
-                }
-            }
+            dropped = stats->dropped;
         }
 
-error_ax25_frame_decode_xid:
-error_ax25_frame_decode_control:
-error_ax25_frame_decode_address:
-        if (patty_print_hexdump(stdout, buf, readlen) < 0) {
-            goto error_io;
-        }
+        if (dump_frame(buf, readlen) < 0) {
+            fprintf(stderr, "%s: %s: %s\n",
+                argv[0], "dump_frame()", strerror(errno));
 
-        if (fflush(stdout) < 0) {
             goto error_io;
         }
     }
 
     free(buf);
 
-    patty_kiss_tnc_destroy(raw);
+    if (raw) patty_kiss_tnc_destroy(raw);
+    if (tap) patty_ax25_tap_destroy(tap);
+    if (filter) patty_ax25_filter_destroy(filter);
 
     if (client) {
         patty_client_close(client, info.fd);
@@ -202,9 +347,11 @@ error_io:
     free(buf);
 
 error_malloc_buf:
-    patty_kiss_tnc_destroy(raw);
+    if (raw) patty_kiss_tnc_destroy(raw);
 
 error_kiss_tnc_new:
+    if (tap) patty_ax25_tap_destroy(tap);
+
 error_kiss_config:
 error_client_setsockopt:
 error_client_socket:
@@ -212,6 +359,9 @@ error_client_socket:
 
 error_client_new:
     if (client) patty_client_destroy(client);
+    if (filter) patty_ax25_filter_destroy(filter);
 
+error_filter_compile:
+error_filter_expr:
     return 1;
 }
@@ -7,6 +7,7 @@
 
 #include <patty/ax25.h>
 #include <patty/ax25/aprs_is.h>
+#include <patty/ax25/axudp.h>
 #include <patty/kiss/tnc.h>
 #include <patty/bin/if.h>
 
@@ -15,6 +16,9 @@ struct context {
 
     char *name;
     patty_ax25_addr addr;
+
+    int thread,
+        cpu;
 };
 
 enum mode {
@@ -22,15 +26,23 @@ enum mode {
     MODE_IFNAME,
     MODE_IFOPTS,
     MODE_IFADDR,
+    MODE_IFCPU,
     MODE_KISS,
     MODE_APRS_IS,
 };
 
 enum mode_kiss {
     MODE_KISS_DEVICE,
+    MODE_KISS_HOST,
+    MODE_KISS_PORT,
     MODE_KISS_IFOPTS,
     MODE_KISS_BAUD,
     MODE_KISS_FLOW,
+    MODE_KISS_TXDELAY,
+    MODE_KISS_PERSIST,
+    MODE_KISS_SLOT_TIME,
+    MODE_KISS_TX_TAIL,
+    MODE_KISS_DUPLEX,
 };
 
 enum mode_aprs_is {
@@ -44,17 +56,73 @@ enum mode_aprs_is {
     MODE_APRS_IS_FILTER,
 };
 
-static patty_ax25_if *create_kiss(struct context *ctx, int argc, char **argv) {
-    enum mode_kiss mode = MODE_KISS_DEVICE;
+enum mode_axudp {
+    MODE_AXUDP_IFOPTS,
+    MODE_AXUDP_BIND,
+    MODE_AXUDP_PORT,
+    MODE_AXUDP_PEER_CALL,
+    MODE_AXUDP_PEER_HOST,
+    MODE_AXUDP_PEER_PORT,
+};
+
+/*
+ * Parse a value given in units of 1/divisor of those of the KISS command
+ * setting it; values which are not a whole number of those units are refused
+ * rather than truncated
+ */
+static int parse_kiss_value(struct context *ctx,
+                            const char *name,
+                            const char *arg,
+                            int divisor,
+                            uint8_t *value) {
+    char *end;
+    long n;
+
+    errno = 0;
+
+    n = strtol(arg, &end, 10);
+
+    if (!(arg[0] >= '0' && arg[0] <= '9') || *end != '\0') {
+        patty_error_fmt(ctx->err, "Invalid %s '%s'", name, arg);
+
+        goto error_invalid;
+    }
+
+    if (errno == ERANGE || n / divisor > 255) {
+        patty_error_fmt(ctx->err, "Value for %s '%s' out of range",
+            name, arg);
+
+        goto error_invalid;
+    }
+
+    if (n % divisor != 0) {
+        patty_error_fmt(ctx->err, "Value for %s '%s' not a multiple of %d",
+            name, arg, divisor);
+
+        goto error_invalid;
+    }
 
+    *value = (uint8_t)(n / divisor);
+
+    return 0;
+
+error_invalid:
+    return -1;
+}
+
+static patty_ax25_if *create_tnc(struct context *ctx,
+                                 int argc,
+                                 char **argv,
+                                 enum mode_kiss mode) {
     patty_kiss_tnc_info info;
     patty_ax25_if *iface;
 
-    int i;
+    int i,
+        adaptive = 0;
 
     memset(&info, '\0', sizeof(info));
 
-    if (argc == 0) {
+    if (argc == 0 && mode == MODE_KISS_DEVICE) {
         patty_error_fmt(ctx->err, "Too few parameters for 'kiss' interface");
 
         goto error_invalid;
@@ -75,11 +143,38 @@ static patty_ax25_if *create_kiss(struct context *ctx, int argc, char **argv) {
 
                 break;
 
+            case MODE_KISS_HOST:
+                info.flags |= PATTY_KISS_TNC_TCP;
+                info.host   = argv[i];
+
+                mode = MODE_KISS_PORT;
+
+                break;
+
+            case MODE_KISS_PORT:
+                info.port = argv[i];
+
+                mode = MODE_KISS_IFOPTS;
+
+                break;
+
             case MODE_KISS_IFOPTS:
                 if (strcmp(argv[i], "baud") == 0) {
                     mode = MODE_KISS_BAUD;
                 } else if (strcmp(argv[i], "flow") == 0) {
                     mode = MODE_KISS_FLOW;
+                } else if (strcmp(argv[i], "txdelay") == 0) {
+                    mode = MODE_KISS_TXDELAY;
+                } else if (strcmp(argv[i], "persist") == 0) {
+                    mode = MODE_KISS_PERSIST;
+                } else if (strcmp(argv[i], "slottime") == 0) {
+                    mode = MODE_KISS_SLOT_TIME;
+                } else if (strcmp(argv[i], "txtail") == 0) {
+                    mode = MODE_KISS_TX_TAIL;
+                } else if (strcmp(argv[i], "duplex") == 0) {
+                    mode = MODE_KISS_DUPLEX;
+                } else if (strcmp(argv[i], "adaptive") == 0) {
+                    adaptive = 1;
                 } else {
                     patty_error_fmt(ctx->err, "Invalid parameter '%s'",
                         argv[i]);
@@ -120,13 +215,101 @@ static patty_ax25_if *create_kiss(struct context *ctx, int argc, char **argv) {
 
                 break;
 
+            case MODE_KISS_TXDELAY:
+                if (parse_kiss_value(ctx, "TX delay", argv[i], 10,
+                                     &info.txdelay) < 0) {
+                    goto error_invalid;
+                }
+
+                info.flags |= PATTY_KISS_TNC_TXDELAY;
+
+                mode = MODE_KISS_IFOPTS;
+
+                break;
+
+            case MODE_KISS_PERSIST:
+                if (parse_kiss_value(ctx, "persistence", argv[i], 1,
+                                     &info.persist) < 0) {
+                    goto error_invalid;
+                }
+
+                info.flags |= PATTY_KISS_TNC_PERSIST;
+
+                mode = MODE_KISS_IFOPTS;
+
+                break;
+
+            case MODE_KISS_SLOT_TIME:
+                if (parse_kiss_value(ctx, "slot time", argv[i], 10,
+                                     &info.slot_time) < 0) {
+                    goto error_invalid;
+                }
+
+                info.flags |= PATTY_KISS_TNC_SLOT_TIME;
+
+                mode = MODE_KISS_IFOPTS;
+
+                break;
+
+            case MODE_KISS_TX_TAIL:
+                if (parse_kiss_value(ctx, "TX tail", argv[i], 10,
+                                     &info.tx_tail) < 0) {
+                    goto error_invalid;
+                }
+
+                info.flags |= PATTY_KISS_TNC_TX_TAIL;
+
+                mode = MODE_KISS_IFOPTS;
+
+                break;
+
+            case MODE_KISS_DUPLEX:
+                if (strcmp(argv[i], "full") == 0) {
+                    info.full_duplex = 1;
+                } else if (strcmp(argv[i], "half") == 0) {
+                    info.full_duplex = 0;
+                } else {
+                    patty_error_fmt(ctx->err, "Invalid duplex mode '%s'",
+                        argv[i]);
+
+                    goto error_invalid;
+                }
+
+                info.flags |= PATTY_KISS_TNC_FULL_DUPLEX;
+
+                mode = MODE_KISS_IFOPTS;
+
+                break;
+
             default:
                 break;
         }
     }
 
+    if (mode == MODE_KISS_HOST) {
+        patty_error_fmt(ctx->err, "No host given for 'kiss-tcp' interface");
+
+        goto error_invalid;
+    }
+
+    if (mode == MODE_KISS_PORT) {
+        patty_error_fmt(ctx->err, "No port given for 'kiss-tcp' interface");
+
+        goto error_invalid;
+    }
+
+    /*
+     * Never allow a slow TNC to stall the daemon
+     */
+    info.flags |= PATTY_KISS_TNC_NONBLOCK;
+
     if ((iface = patty_ax25_if_new(patty_kiss_tnc_driver(),
                                    &info)) == NULL) {
+        if (info.flags & PATTY_KISS_TNC_TCP) {
+            patty_error_fmt(ctx->err, "Unable to resolve KISS TNC %s:%s",
+                info.host, info.port);
+        }
+
         goto error_if_new;
     }
 
@@ -134,10 +317,23 @@ static patty_ax25_if *create_kiss(struct context *ctx, int argc, char **argv) {
         goto error_if_addr_set;
     }
 
+    if (adaptive) {
+        uint32_t persist = (info.flags & PATTY_KISS_TNC_PERSIST)?
+            info.persist: PATTY_AX25_IF_DEFAULT_PERSIST;
+
+        uint32_t slot_time = (info.flags & PATTY_KISS_TNC_SLOT_TIME)?
+            info.slot_time: PATTY_AX25_IF_DEFAULT_SLOT_TIME;
+
+        if (patty_ax25_if_adapt_start(iface, persist, slot_time) < 0) {
+            goto error_if_adapt_start;
+        }
+    }
+
     patty_ax25_if_up(iface);
 
     return iface;
 
+error_if_adapt_start:
 error_if_addr_set:
     patty_ax25_if_destroy(iface);
 
@@ -146,6 +342,16 @@ error_invalid:
     return NULL;
 }
 
+static patty_ax25_if *create_kiss(struct context *ctx, int argc, char **argv) {
+    return create_tnc(ctx, argc, argv, MODE_KISS_DEVICE);
+}
+
+static patty_ax25_if *create_kiss_tcp(struct context *ctx,
+                                      int argc,
+                                      char **argv) {
+    return create_tnc(ctx, argc, argv, MODE_KISS_HOST);
+}
+
 static patty_ax25_if *create_aprs_is(struct context *ctx,
                                      int argc,
                                      char **argv) {
@@ -259,15 +465,137 @@ error_invalid:
     return NULL;
 }
 
+static patty_ax25_if *create_axudp(struct context *ctx,
+                                   int argc,
+                                   char **argv) {
+    patty_ax25_if *iface;
+
+    patty_ax25_axudp_info info;
+
+    enum mode_axudp mode = MODE_AXUDP_IFOPTS;
+
+    patty_ax25_axudp_peer_info *peer = NULL;
+
+    int i;
+
+    memset(&info, '\0', sizeof(info));
+
+    for (i=0; i<argc; i++) {
+        switch (mode) {
+            case MODE_AXUDP_IFOPTS:
+                if (strcmp(argv[i], "bind") == 0) {
+                    mode = MODE_AXUDP_BIND;
+                } else if (strcmp(argv[i], "port") == 0) {
+                    mode = MODE_AXUDP_PORT;
+                } else if (strcmp(argv[i], "crc") == 0) {
+                    info.flags |= PATTY_AX25_AXUDP_CRC;
+                } else if (strcmp(argv[i], "peer") == 0) {
+                    if (info.n_peers == PATTY_AX25_AXUDP_PEERS_MAX) {
+                        patty_error_fmt(ctx->err, "Too many peers for 'axudp' interface");
+
+                        goto error_invalid;
+                    }
+
+                    peer = &info.peers[info.n_peers++];
+                    mode = MODE_AXUDP_PEER_CALL;
+                } else {
+                    patty_error_fmt(ctx->err, "Invalid parameter '%s'",
+                        argv[i]);
+
+                    goto error_invalid;
+                }
+
+                break;
+
+            case MODE_AXUDP_BIND:
+                info.host = argv[i];
+                mode = MODE_AXUDP_IFOPTS;
+
+                break;
+
+            case MODE_AXUDP_PORT:
+                info.port = argv[i];
+                mode = MODE_AXUDP_IFOPTS;
+
+                break;
+
+            case MODE_AXUDP_PEER_CALL:
+                if (strcmp(argv[i], "default") != 0) {
+                    patty_ax25_addr addr;
+
+                    if (patty_ax25_pton(argv[i], &addr) < 0) {
+                        patty_error_fmt(ctx->err, "Invalid AX.25 address '%s': %s",
+                            argv[i], strerror(errno));
+
+                        goto error_invalid;
+                    }
+
+                    peer->call = argv[i];
+                }
+
+                mode = MODE_AXUDP_PEER_HOST;
+
+                break;
+
+            case MODE_AXUDP_PEER_HOST:
+                peer->host = argv[i];
+                mode = MODE_AXUDP_PEER_PORT;
+
+                break;
+
+            case MODE_AXUDP_PEER_PORT:
+                peer->port = argv[i];
+                mode = MODE_AXUDP_IFOPTS;
+
+                break;
+        }
+    }
+
+    if (mode != MODE_AXUDP_IFOPTS) {
+        patty_error_fmt(ctx->err, "Too few parameters for 'axudp' interface");
+
+        goto error_invalid;
+    }
+
+    if (info.n_peers == 0) {
+        patty_error_fmt(ctx->err, "No peers given for 'axudp' interface");
+
+        goto error_invalid;
+    }
+
+    if ((iface = patty_ax25_if_new(patty_ax25_axudp_driver(),
+                                   &info)) == NULL) {
+        patty_error_fmt(ctx->err, "Unable to set up AXUDP interface: %s",
+            strerror(errno));
+
+        goto error_if_new;
+    }
+
+    if (patty_ax25_if_addr_set(iface, &ctx->addr) < 0) {
+        goto error_if_addr_set;
+    }
+
+    return iface;
+
+error_if_addr_set:
+    patty_ax25_if_destroy(iface);
+
+error_if_new:
+error_invalid:
+    return NULL;
+}
+
 struct if_type {
     const char *name;
     patty_ax25_if *(*func)(struct context *ctx, int argc, char **argv);
 };
 
 struct if_type if_types[] = {
-    { "kiss",    create_kiss    },
-    { "aprs-is", create_aprs_is },
-    {  NULL,     NULL           }
+    { "kiss",     create_kiss     },
+    { "kiss-tcp", create_kiss_tcp },
+    { "aprs-is",  create_aprs_is  },
+    { "axudp",    create_axudp    },
+    {  NULL,      NULL            }
 };
 
 patty_ax25_if *patty_bin_if_create(int argc,
@@ -277,8 +605,10 @@ patty_ax25_if *patty_bin_if_create(int argc,
     enum mode mode = MODE_NONE;
 
     struct context ctx = {
-        .err  = e,
-        .name = NULL
+        .err    = e,
+        .name   = NULL,
+        .thread = 0,
+        .cpu    = -1
     };
 
     int i;
@@ -311,16 +641,37 @@ patty_ax25_if *patty_bin_if_create(int argc,
             case MODE_IFOPTS:
                 if (strcmp(argv[i], "ax25") == 0) {
                     mode = MODE_IFADDR;
+                } else if (strcmp(argv[i], "thread") == 0) {
+                    ctx.thread = 1;
+                } else if (strcmp(argv[i], "cpu") == 0) {
+                    mode = MODE_IFCPU;
                 } else {
                     int t;
 
                     for (t=0; if_types[t].name; t++) {
                         if (strcmp(if_types[t].name, argv[i]) == 0) {
+                            patty_ax25_if *iface;
+
                             *ifname = ctx.name;
 
-                            return if_types[t].func(&ctx,
-                                                    argc - i - 1,
-                                                    argv + i + 1);
+                            if ((iface = if_types[t].func(&ctx,
+                                                          argc - i - 1,
+                                                          argv + i + 1)) == NULL) {
+                                goto error_invalid;
+                            }
+
+                            if (ctx.thread) {
+                                if (patty_ax25_if_thread_init(iface, ctx.cpu) < 0) {
+                                    patty_error_fmt(e, "Unable to set up I/O thread: %s",
+                                        strerror(errno));
+
+                                    patty_ax25_if_destroy(iface);
+
+                                    goto error_invalid;
+                                }
+                            }
+
+                            return iface;
                         }
                     }
 
@@ -343,6 +694,20 @@ patty_ax25_if *patty_bin_if_create(int argc,
 
                 break;
 
+            case MODE_IFCPU:
+                if (!(argv[i][0] >= '0' && argv[i][0] <= '9')) {
+                    patty_error_fmt(e, "Invalid CPU number '%s'", argv[i]);
+
+                    goto error_invalid;
+                }
+
+                ctx.thread = 1;
+                ctx.cpu    = atoi(argv[i]);
+
+                mode = MODE_IFOPTS;
+
+                break;
+
             default:
                 break;
         }
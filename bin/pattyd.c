@@ -40,6 +40,14 @@ struct context {
 
     patty_daemon *daemon;
     patty_error e;
+
+    patty_ax25_server_limits limits;
+
+    /*
+     * Duplicate suppression windows, in milliseconds
+     */
+    time_t dedup_digi,
+           dedup_ui;
 };
 
 static int handle_sock(struct context *ctx,
@@ -92,6 +100,89 @@ error_invalid_args:
     return -1;
 }
 
+static int handle_limit(struct context *ctx,
+                        int lineno,
+                        int argc,
+                        char **argv) {
+    int i;
+
+    if (argc < 3 || argc > 4) {
+        goto error_invalid_args;
+    }
+
+    for (i=2; i<argc; i++) {
+        if (!(argv[i][0] >= '0' && argv[i][0] <= '9')) {
+            goto error_invalid_args;
+        }
+    }
+
+    if (strcmp(argv[1], "links") == 0 && argc == 3) {
+        ctx->limits.links = (size_t)atoi(argv[2]);
+    } else if (strcmp(argv[1], "peer") == 0 && argc == 3) {
+        ctx->limits.peer_links = (size_t)atoi(argv[2]);
+    } else if (strcmp(argv[1], "rate") == 0) {
+        ctx->limits.rate  = (size_t)atoi(argv[2]);
+        ctx->limits.burst = argc == 4? (size_t)atoi(argv[3]): 0;
+    } else {
+        goto error_invalid_args;
+    }
+
+    if (patty_daemon_set_limits(ctx->daemon, &ctx->limits) < 0) {
+        patty_error_fmt(&ctx->e, "line %d: Unable to set limits: %s",
+            lineno, strerror(errno));
+
+        goto error_set_limits;
+    }
+
+    return 0;
+
+error_invalid_args:
+    patty_error_fmt(&ctx->e, "line %d: Invalid arguments for 'limit'",
+        lineno);
+
+error_set_limits:
+    return -1;
+}
+
+static int handle_dedup(struct context *ctx,
+                        int lineno,
+                        int argc,
+                        char **argv) {
+    time_t window;
+
+    if (argc != 3 || !(argv[2][0] >= '0' && argv[2][0] <= '9')) {
+        goto error_invalid_args;
+    }
+
+    window = (time_t)atoi(argv[2]) * 1000;
+
+    if (strcmp(argv[1], "digi") == 0) {
+        ctx->dedup_digi = window;
+    } else if (strcmp(argv[1], "ui") == 0) {
+        ctx->dedup_ui = window;
+    } else {
+        goto error_invalid_args;
+    }
+
+    if (patty_daemon_set_dedup(ctx->daemon,
+                               ctx->dedup_digi,
+                               ctx->dedup_ui) < 0) {
+        patty_error_fmt(&ctx->e, "line %d: Unable to set duplicate suppression: %s",
+            lineno, strerror(errno));
+
+        goto error_set_dedup;
+    }
+
+    return 0;
+
+error_invalid_args:
+    patty_error_fmt(&ctx->e, "line %d: Invalid arguments for 'dedup'",
+        lineno);
+
+error_set_dedup:
+    return -1;
+}
+
 static int handle_if(struct context *ctx,
                      int lineno,
                      int argc,
@@ -119,7 +210,7 @@ static int handle_if(struct context *ctx,
 
         goto error_invalid;
     } else {
-        int fd = patty_ax25_if_fd(iface);
+        int fd = patty_ax25_if_phy_fd(iface);
         char *pty;
 
         if (isatty(fd) && (pty = ptsname(fd)) != NULL) {
@@ -153,6 +244,16 @@ static int handle_route(struct context *ctx,
                         int lineno,
                         int argc,
                         char **argv) {
+    char *dest = NULL,
+         **hops = NULL,
+         *ifnames[PATTY_AX25_ROUTE_MAX_NEXTHOPS];
+
+    unsigned int weights[PATTY_AX25_ROUTE_MAX_NEXTHOPS];
+
+    int hopc     = 0,
+        n_ifaces = 0,
+        i;
+
     if (argc < 2) {
         patty_error_fmt(&ctx->e, "line %d: Invalid route declaration",
             lineno);
@@ -161,73 +262,238 @@ static int handle_route(struct context *ctx,
     }
 
     if (strcmp(argv[1], "default") == 0) {
-        if (argc != 4 || strcmp(argv[2], "if") != 0) {
-            patty_error_fmt(&ctx->e, "line %d: Invalid default route declaration",
+        i = 2;
+    } else if (strcmp(argv[1], "station") == 0) {
+        if (argc < 3) {
+            patty_error_fmt(&ctx->e, "line %d: Invalid station route declaration: No station provided",
                 lineno);
 
             goto error_invalid_route;
         }
 
-        if (patty_daemon_route_add_default(ctx->daemon, argv[3]) < 0) {
-            patty_error_fmt(&ctx->e, "line %d: Unable to add default route for interface %s: %s",
-                lineno, argv[3], strerror(errno));
+        dest = argv[2];
+        i    = 3;
+    } else {
+        patty_error_fmt(&ctx->e, "line %d: Invalid route type '%s'",
+            lineno, argv[1]);
 
-            goto error_daemon_route_add;
-        }
-    } else if (strcmp(argv[1], "station") == 0) {
-        int hopc = 0;
-        char **hops = NULL;
+        goto error_invalid_route;
+    }
 
-        if (argc < 5) {
-            if (strcmp(argv[3], "if") != 0) {
-                patty_error_fmt(&ctx->e, "line %d: Invalid station route declaration: Unexpected keyword '%s'",
-                                lineno, argv[3]);
+    for (; i<argc; i++) {
+        if (strcmp(argv[i], "if") == 0) {
+            if (i + 1 == argc) {
+                patty_error_fmt(&ctx->e, "line %d: Invalid route declaration: No interface name provided",
+                    lineno);
 
                 goto error_invalid_route;
             }
-        } else if (argc > 6) {
-            if (strcmp(argv[5], "path") != 0) {
-                patty_error_fmt(&ctx->e, "line %d: Invalid station route declaration: Unexpected keyword '%s'",
-                                lineno, argv[5]);
+
+            if (n_ifaces == PATTY_AX25_ROUTE_MAX_NEXTHOPS) {
+                patty_error_fmt(&ctx->e, "line %d: Invalid route declaration: Too many interfaces",
+                    lineno);
 
                 goto error_invalid_route;
             }
 
-            if (argc < 7) {
+            ifnames[n_ifaces] = argv[++i];
+            weights[n_ifaces] = 1;
+
+            n_ifaces++;
+        } else if (strcmp(argv[i], "weight") == 0) {
+            if (n_ifaces == 0 || i + 1 == argc
+             || !(argv[i+1][0] >= '1' && argv[i+1][0] <= '9')) {
+                patty_error_fmt(&ctx->e, "line %d: Invalid route declaration: Invalid weight",
+                    lineno);
+
+                goto error_invalid_route;
+            }
+
+            weights[n_ifaces-1] = (unsigned int)atoi(argv[++i]);
+        } else if (dest && strcmp(argv[i], "path") == 0) {
+            if (i + 1 == argc) {
                 patty_error_fmt(&ctx->e, "line %d: Invalid station route declaration: No route path provided",
-                                lineno);
+                    lineno);
 
                 goto error_invalid_route;
             }
 
-            hopc = argc - 6;
-            hops = &argv[6];
-        }
+            hopc = argc - i - 1;
+            hops = &argv[i+1];
 
-        if (patty_daemon_route_add(ctx->daemon,
-                                   argv[4],
-                                   argv[2],
-                                   (const char **)hops,
-                                   hopc) < 0) {
-            patty_error_fmt(&ctx->e, "line %d: Unable to add route for interface %s: %s",
-                lineno, argv[4], strerror(errno));
+            break;
+        } else {
+            patty_error_fmt(&ctx->e, "line %d: Invalid route declaration: Unexpected keyword '%s'",
+                lineno, argv[i]);
 
-            goto error_daemon_route_add;
+            goto error_invalid_route;
         }
-    } else {
-        patty_error_fmt(&ctx->e, "line %d: Invalid route type '%s'",
-            lineno, argv[1]);
+    }
+
+    if (n_ifaces == 0) {
+        patty_error_fmt(&ctx->e, "line %d: Invalid route declaration: No interface provided",
+            lineno);
 
         goto error_invalid_route;
     }
 
+    if (patty_daemon_route_add(ctx->daemon,
+                               ifnames[0],
+                               dest,
+                               (const char **)hops,
+                               hopc) < 0) {
+        patty_error_fmt(&ctx->e, "line %d: Unable to add route for interface %s: %s",
+            lineno, ifnames[0], strerror(errno));
+
+        goto error_daemon_route_add;
+    }
+
+    for (i=0; i<n_ifaces; i++) {
+        if (patty_daemon_route_nexthop_add(ctx->daemon,
+                                           dest,
+                                           ifnames[i],
+                                           weights[i]) < 0) {
+            patty_error_fmt(&ctx->e, "line %d: Unable to add route for interface %s: %s",
+                lineno, ifnames[i], strerror(errno));
+
+            goto error_daemon_route_nexthop_add;
+        }
+    }
+
     return 0;
 
+error_daemon_route_nexthop_add:
 error_daemon_route_add:
 error_invalid_route:
     return -1;
 }
 
+static int handle_digi(struct context *ctx,
+                       int lineno,
+                       int argc,
+                       char **argv) {
+    char *outname = NULL;
+    int wide = 0,
+        i;
+
+    if (argc < 2) {
+        patty_error_fmt(&ctx->e, "line %d: No interface name provided",
+            lineno);
+
+        goto error_invalid;
+    }
+
+    for (i=2; i<argc; i++) {
+        if (i + 1 == argc) {
+            patty_error_fmt(&ctx->e, "line %d: No value provided for '%s'",
+                lineno, argv[i]);
+
+            goto error_invalid;
+        }
+
+        if (strcmp(argv[i], "out") == 0) {
+            outname = argv[++i];
+        } else if (strcmp(argv[i], "wide") == 0) {
+            if (!(argv[i+1][0] >= '0' && argv[i+1][0] <= '9')) {
+                patty_error_fmt(&ctx->e, "line %d: Invalid WIDEn-N limit '%s'",
+                    lineno, argv[i+1]);
+
+                goto error_invalid;
+            }
+
+            wide = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "alias") == 0) {
+            if (patty_daemon_if_alias_add(ctx->daemon,
+                                          argv[1],
+                                          argv[i+1]) < 0) {
+                patty_error_fmt(&ctx->e, "line %d: Unable to add alias %s to interface %s: %s",
+                    lineno, argv[i+1], argv[1], strerror(errno));
+
+                goto error_daemon_if_alias_add;
+            }
+
+            i++;
+        } else {
+            patty_error_fmt(&ctx->e, "line %d: Invalid digipeater option '%s'",
+                lineno, argv[i]);
+
+            goto error_invalid;
+        }
+    }
+
+    if (patty_daemon_digi_set(ctx->daemon, argv[1], outname, wide) < 0) {
+        patty_error_fmt(&ctx->e, "line %d: Unable to digipeat on interface %s: %s",
+            lineno, argv[1], strerror(errno));
+
+        goto error_daemon_digi_set;
+    }
+
+    return 0;
+
+error_daemon_digi_set:
+error_daemon_if_alias_add:
+error_invalid:
+    return -1;
+}
+
+static int handle_bridge(struct context *ctx,
+                         int lineno,
+                         int argc,
+                         char **argv) {
+    int i;
+
+    if (argc < 3) {
+        patty_error_fmt(&ctx->e, "line %d: At least two interfaces must be bridged",
+            lineno);
+
+        goto error_invalid;
+    }
+
+    for (i=1; i<argc; i++) {
+        if (patty_daemon_bridge_add(ctx->daemon, argv[i]) < 0) {
+            patty_error_fmt(&ctx->e, "line %d: Unable to bridge interface %s: %s",
+                lineno, argv[i], strerror(errno));
+
+            goto error_daemon_bridge_add;
+        }
+    }
+
+    return 0;
+
+error_daemon_bridge_add:
+error_invalid:
+    return -1;
+}
+
+static int handle_ifparam(struct context *ctx,
+                          int lineno,
+                          int argc,
+                          char **argv) {
+    int i;
+
+    if (argc < 2) {
+        patty_error_fmt(&ctx->e, "line %d: No interface name provided",
+            lineno);
+
+        goto error_invalid;
+    }
+
+    for (i=1; i<argc; i++) {
+        if (patty_daemon_if_param_allow(ctx->daemon, argv[i]) < 0) {
+            patty_error_fmt(&ctx->e, "line %d: Unable to allow parameters for interface %s: %s",
+                lineno, argv[i], strerror(errno));
+
+            goto error_daemon_if_param_allow;
+        }
+    }
+
+    return 0;
+
+error_daemon_if_param_allow:
+error_invalid:
+    return -1;
+}
+
 struct config_handler {
     const char *name;
     int (*func)(struct context *, int, int, char **);
@@ -236,8 +502,13 @@ struct config_handler {
 struct config_handler handlers[] = {
     { "sock",  handle_sock   },
     { "pid",   handle_pid    },
+    { "limit", handle_limit  },
+    { "dedup", handle_dedup  },
     { "if",    handle_if     },
     { "route", handle_route  },
+    { "digi",  handle_digi   },
+    { "bridge", handle_bridge },
+    { "ifparam", handle_ifparam },
     { NULL,   NULL           }
 };
 
@@ -334,7 +605,7 @@ static int handle_standalone(patty_daemon *daemon,
 
         goto error_if_new;
     } else {
-        int fd = patty_ax25_if_fd(iface);
+        int fd = patty_ax25_if_phy_fd(iface);
         char *pty;
 
         if (patty_ax25_if_addr_set(iface, &addr) < 0) {
@@ -399,7 +670,8 @@ int main(int argc, char **argv) {
     };
 
     struct context ctx = {
-        .config_file = DEFAULT_CONFIG_FILE
+        .config_file = DEFAULT_CONFIG_FILE,
+        .dedup_digi  = PATTY_AX25_DEDUP_DEFAULT_WINDOW
     };
 
     memset(&ctx.e, '\0', sizeof(ctx.e));
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,16 +9,58 @@
 #include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <errno.h>
 #include <sysexits.h>
 
 #include <patty/ax25.h>
+#include <patty/hash.h>
 #include <patty/print.h>
 #include <patty/util.h>
 
 #include <patty/bin/kiss.h>
 
+#define TNCD_BUFSZ       4096
+#define TNCD_BACKLOG     16
+#define TNCD_CLIENTS_MAX 64
+#define TNCD_SENT_MAX    16
+
+struct listener {
+    int fd,
+        tcp;
+};
+
+/*
+ * Hashes of the frames a client has sent which the interface is yet to hand
+ * back, so that the client is not sent its own transmissions; only the most
+ * recent are kept, in case any are never handed back
+ */
+struct conn {
+    int fd;
+    patty_kiss_tnc *tnc;
+
+    uint32_t sent[TNCD_SENT_MAX];
+    size_t sent_next,
+           sent_count;
+};
+
+struct tncd {
+    patty_kiss_tnc *raw;
+
+    struct listener listeners[2];
+    size_t n_listeners;
+
+    struct conn conns[TNCD_CLIENTS_MAX];
+    size_t n_conns;
+
+    uint8_t buf[TNCD_BUFSZ];
+};
+
 static void usage(int argc, char **argv, const char *message, ...) {
     if (message != NULL) {
         va_list args;
@@ -28,7 +71,7 @@ static void usage(int argc, char **argv, const char *message, ...) {
         va_end(args);
     }
 
-    fprintf(stderr, "usage: %s [-s patty.sock] -i ifname\n", argv[0]);
+    fprintf(stderr, "usage: %s [-s patty.sock] [-t [host:]port] [-u path] -i ifname\n", argv[0]);
 
     exit(EX_USAGE);
 }
@@ -158,17 +201,579 @@ error_client_write_socket_request:
     return -1;
 }
 
+static int listen_tcp(const char *spec) {
+    struct addrinfo hints,
+                    *ai0,
+                    *ai;
+
+    char host[256];
+    const char *port;
+    char *sep;
+    int fd,
+        one = 1;
+
+    patty_strlcpy(host, spec, sizeof(host));
+
+    if ((sep = strrchr(host, ':')) != NULL) {
+        *sep = '\0';
+        port = sep + 1;
+    } else {
+        port = host;
+    }
+
+    memset(&hints, '\0', sizeof(hints));
+
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags    = AI_PASSIVE;
+
+    if (getaddrinfo(sep && host[0]? host: NULL, port, &hints, &ai0) != 0) {
+        errno = EADDRNOTAVAIL;
+
+        goto error_getaddrinfo;
+    }
+
+    for (ai=ai0; ai; ai=ai->ai_next) {
+        if ((fd = socket(ai->ai_family,
+                         ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                         ai->ai_protocol)) < 0) {
+            continue;
+        }
+
+        (void)setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) < 0
+         || listen(fd, TNCD_BACKLOG) < 0) {
+            close(fd);
+
+            continue;
+        }
+
+        freeaddrinfo(ai0);
+
+        return fd;
+    }
+
+    freeaddrinfo(ai0);
+
+error_getaddrinfo:
+    return -1;
+}
+
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = EOVERFLOW;
+
+        goto error_overflow;
+    }
+
+    if (stat(path, &st) >= 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+
+    if ((fd = socket(PF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) < 0) {
+        goto error_socket;
+    }
+
+    memset(&addr, '\0', sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    patty_strlcpy(addr.sun_path, path, sizeof(addr.sun_path));
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        goto error_bind;
+    }
+
+    if (listen(fd, TNCD_BACKLOG) < 0) {
+        goto error_listen;
+    }
+
+    return fd;
+
+error_listen:
+    unlink(path);
+
+error_bind:
+    close(fd);
+
+error_socket:
+error_overflow:
+    return -1;
+}
+
+static int raw_promisc(patty_client *client, const char *ifname) {
+    patty_client_setsockopt_if ifreq;
+    patty_client_setsockopt_notices notices = {
+        .enable = 1
+    };
+
+    int fd;
+
+    if ((fd = patty_client_socket(client,
+                                  PATTY_AX25_PROTO_NONE,
+                                  PATTY_AX25_SOCK_RAW)) < 0) {
+        goto error_client_socket;
+    }
+
+    patty_strlcpy(ifreq.name, ifname, sizeof(ifreq.name));
+    ifreq.state = PATTY_AX25_SOCK_PROMISC;
+
+    if (patty_client_setsockopt(client,
+                                fd,
+                                PATTY_AX25_SOCK_IF,
+                                &ifreq,
+                                sizeof(ifreq)) < 0) {
+        goto error_client_setsockopt;
+    }
+
+    /*
+     * Frames the daemon drops for us are counted with those of our own
+     */
+    if (patty_client_setsockopt(client,
+                                fd,
+                                PATTY_AX25_SOCK_NOTICES,
+                                &notices,
+                                sizeof(notices)) < 0) {
+        goto error_client_setsockopt;
+    }
+
+    return fd;
+
+error_client_setsockopt:
+    (void)patty_client_close(client, fd);
+
+error_client_socket:
+    return -1;
+}
+
+static int conn_accept(struct tncd *tncd, struct listener *listener) {
+    struct conn *conn = &tncd->conns[tncd->n_conns];
+    patty_kiss_tnc_info info;
+    int one = 1;
+
+    if ((conn->fd = accept4(listener->fd, NULL, NULL, SOCK_CLOEXEC)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ECONNABORTED) {
+            return 0;
+        }
+
+        goto error_accept;
+    }
+
+    if (listener->tcp) {
+        (void)setsockopt(conn->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+
+    memset(&info, '\0', sizeof(info));
+
+    info.flags = PATTY_KISS_TNC_FD | PATTY_KISS_TNC_NONBLOCK;
+    info.fd    = conn->fd;
+
+    if ((conn->tnc = patty_kiss_tnc_new(&info)) == NULL) {
+        goto error_kiss_tnc_new;
+    }
+
+    conn->sent_next  = 0;
+    conn->sent_count = 0;
+
+    tncd->n_conns++;
+
+    return 0;
+
+error_kiss_tnc_new:
+    close(conn->fd);
+
+error_accept:
+    return -1;
+}
+
+static void conn_close(struct tncd *tncd, size_t i) {
+    struct conn *conn = &tncd->conns[i];
+
+    patty_kiss_tnc_destroy(conn->tnc);
+    close(conn->fd);
+
+    if (i != --tncd->n_conns) {
+        memcpy(conn, &tncd->conns[tncd->n_conns], sizeof(*conn));
+    }
+}
+
+static void conn_sent(struct conn *conn, uint32_t hash) {
+    conn->sent[conn->sent_next] = hash;
+    conn->sent_next = (conn->sent_next + 1) % TNCD_SENT_MAX;
+
+    if (conn->sent_count < TNCD_SENT_MAX) {
+        conn->sent_count++;
+    }
+}
+
+/*
+ * Whether a frame handed back by the interface is one the client sent, in
+ * which case it is forgotten
+ */
+static int conn_echo(struct conn *conn, uint32_t hash) {
+    size_t i;
+
+    for (i=0; i<conn->sent_count; i++) {
+        size_t slot = (conn->sent_next + TNCD_SENT_MAX - conn->sent_count + i)
+                    % TNCD_SENT_MAX;
+
+        if (conn->sent[slot] == hash) {
+            size_t first = (conn->sent_next + TNCD_SENT_MAX - conn->sent_count)
+                         % TNCD_SENT_MAX;
+
+            conn->sent[slot] = conn->sent[first];
+            conn->sent_count--;
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Decode each frame received by the interface once, and queue it to every
+ * client but the one which sent it; a client not keeping up only drops
+ * frames of its own, and a client which cannot be written to is disconnected
+ */
+static int raw_receive(struct tncd *tncd) {
+    ssize_t filled,
+            drained;
+
+    if ((filled = patty_kiss_tnc_fill(tncd->raw)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+
+        goto error_fill;
+    } else if (filled == 0) {
+        errno = EIO;
+
+        goto error_fill;
+    }
+
+    while ((drained = patty_kiss_tnc_drain(tncd->raw,
+                                           tncd->buf,
+                                           sizeof(tncd->buf))) > 0) {
+        ssize_t len;
+        uint32_t hash;
+        size_t i;
+
+        if (!patty_kiss_tnc_pending(tncd->raw)) {
+            continue;
+        }
+
+        len  = patty_kiss_tnc_flush(tncd->raw);
+        hash = patty_hash(tncd->buf, len);
+
+        for (i=0; i<tncd->n_conns; i++) {
+            if (conn_echo(&tncd->conns[i], hash)) {
+                continue;
+            }
+
+            if (patty_kiss_tnc_send(tncd->conns[i].tnc, tncd->buf, len) < 0) {
+                conn_close(tncd, i--);
+            }
+        }
+    }
+
+    if (drained < 0) {
+        goto error_drain;
+    }
+
+    return 0;
+
+error_drain:
+error_fill:
+    return -1;
+}
+
+/*
+ * Send each data frame received from a client out to the interface; other
+ * KISS commands, such as channel access parameters, are the business of the
+ * daemon's own TNC, and are ignored
+ */
+static int conn_receive(struct tncd *tncd, size_t i) {
+    struct conn *conn = &tncd->conns[i];
+    ssize_t filled,
+            drained;
+
+    if ((filled = patty_kiss_tnc_fill(conn->tnc)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 0;
+        }
+
+        goto error_conn;
+    } else if (filled == 0) {
+        goto error_conn;
+    }
+
+    while ((drained = patty_kiss_tnc_drain(conn->tnc,
+                                           tncd->buf,
+                                           sizeof(tncd->buf))) > 0) {
+        ssize_t len;
+
+        if (!patty_kiss_tnc_pending(conn->tnc)) {
+            continue;
+        }
+
+        len = patty_kiss_tnc_flush(conn->tnc);
+
+        if (patty_kiss_tnc_send(tncd->raw, tncd->buf, len) < 0) {
+            return -1;
+        }
+
+        conn_sent(conn, patty_hash(tncd->buf, len));
+    }
+
+    if (drained < 0) {
+        goto error_conn;
+    }
+
+    return 0;
+
+error_conn:
+    conn_close(tncd, i);
+
+    return 0;
+}
+
+static int serve(struct tncd *tncd) {
+    int rawfd = patty_kiss_tnc_fd(tncd->raw);
+
+    while (1) {
+        fd_set fds_r,
+               fds_w;
+
+        int fdmax = rawfd;
+        size_t i;
+
+        FD_ZERO(&fds_r);
+        FD_ZERO(&fds_w);
+
+        FD_SET(rawfd, &fds_r);
+
+        if (patty_kiss_tnc_queued(tncd->raw) > 0) {
+            FD_SET(rawfd, &fds_w);
+        }
+
+        if (tncd->n_conns < TNCD_CLIENTS_MAX) {
+            for (i=0; i<tncd->n_listeners; i++) {
+                FD_SET(tncd->listeners[i].fd, &fds_r);
+
+                if (fdmax < tncd->listeners[i].fd) {
+                    fdmax = tncd->listeners[i].fd;
+                }
+            }
+        }
+
+        for (i=0; i<tncd->n_conns; i++) {
+            struct conn *conn = &tncd->conns[i];
+
+            FD_SET(conn->fd, &fds_r);
+
+            if (patty_kiss_tnc_queued(conn->tnc) > 0) {
+                FD_SET(conn->fd, &fds_w);
+            }
+
+            if (fdmax < conn->fd) {
+                fdmax = conn->fd;
+            }
+        }
+
+        if (select(fdmax + 1, &fds_r, &fds_w, NULL, NULL) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            goto error_io;
+        }
+
+        if (FD_ISSET(rawfd, &fds_w)) {
+            if (patty_kiss_tnc_transmit(tncd->raw) < 0) {
+                goto error_io;
+            }
+        }
+
+        /*
+         * Clients are handled last to first, such that any closed along the
+         * way, and replaced by the last, have already been seen to
+         */
+        for (i=tncd->n_conns; i--;) {
+            int fd = tncd->conns[i].fd;
+
+            if (FD_ISSET(fd, &fds_w)) {
+                if (patty_kiss_tnc_transmit(tncd->conns[i].tnc) < 0) {
+                    conn_close(tncd, i);
+
+                    continue;
+                }
+            }
+
+            if (FD_ISSET(fd, &fds_r)) {
+                if (conn_receive(tncd, i) < 0) {
+                    goto error_io;
+                }
+            }
+        }
+
+        if (FD_ISSET(rawfd, &fds_r)) {
+            if (raw_receive(tncd) < 0) {
+                /*
+                 * The daemon having closed the socket is not an error
+                 */
+                if (errno == EIO) {
+                    break;
+                }
+
+                goto error_io;
+            }
+        }
+
+        for (i=0; i<tncd->n_listeners; i++) {
+            if (tncd->n_conns == TNCD_CLIENTS_MAX) {
+                break;
+            }
+
+            if (FD_ISSET(tncd->listeners[i].fd, &fds_r)) {
+                if (conn_accept(tncd, &tncd->listeners[i]) < 0) {
+                    goto error_io;
+                }
+            }
+        }
+    }
+
+    return 0;
+
+error_io:
+    return -1;
+}
+
+static int serve_main(const char *argv0,
+                      patty_client *client,
+                      const char *ifname,
+                      const char *tcp,
+                      const char *path) {
+    struct tncd *tncd;
+    patty_kiss_tnc_info info;
+    size_t i;
+    int bound = 0,
+        ret   = 1;
+
+    if ((tncd = malloc(sizeof(*tncd))) == NULL) {
+        fprintf(stderr, "%s: %s: %s\n",
+            argv0, "malloc()", strerror(errno));
+
+        goto error_malloc_tncd;
+    }
+
+    memset(tncd, '\0', sizeof(*tncd));
+
+    if (tcp) {
+        struct listener *listener = &tncd->listeners[tncd->n_listeners];
+
+        if ((listener->fd = listen_tcp(tcp)) < 0) {
+            fprintf(stderr, "%s: %s: %s: %s\n",
+                argv0, "listen_tcp()", tcp, strerror(errno));
+
+            goto error_listen;
+        }
+
+        listener->tcp = 1;
+
+        tncd->n_listeners++;
+    }
+
+    if (path) {
+        struct listener *listener = &tncd->listeners[tncd->n_listeners];
+
+        if ((listener->fd = listen_unix(path)) < 0) {
+            fprintf(stderr, "%s: %s: %s: %s\n",
+                argv0, "listen_unix()", path, strerror(errno));
+
+            goto error_listen;
+        }
+
+        tncd->n_listeners++;
+
+        bound = 1;
+    }
+
+    memset(&info, '\0', sizeof(info));
+
+    info.flags = PATTY_KISS_TNC_FD | PATTY_KISS_TNC_NONBLOCK;
+
+    if ((info.fd = raw_promisc(client, ifname)) < 0) {
+        fprintf(stderr, "%s: %s: %s: %s\n",
+            argv0, "raw_promisc()", ifname, strerror(errno));
+
+        goto error_raw_promisc;
+    }
+
+    if ((tncd->raw = patty_kiss_tnc_new(&info)) == NULL) {
+        fprintf(stderr, "%s: %s: %s\n",
+            argv0, "patty_kiss_tnc_new()", strerror(errno));
+
+        goto error_kiss_tnc_new;
+    }
+
+    /*
+     * Clients going away mid-write are noticed by way of EPIPE
+     */
+    signal(SIGPIPE, SIG_IGN);
+
+    if (serve(tncd) < 0) {
+        fprintf(stderr, "%s: %s: %s\n",
+            argv0, "serve()", strerror(errno));
+    } else {
+        ret = 0;
+    }
+
+    while (tncd->n_conns) {
+        conn_close(tncd, tncd->n_conns - 1);
+    }
+
+    patty_kiss_tnc_destroy(tncd->raw);
+
+error_kiss_tnc_new:
+    (void)patty_client_close(client, info.fd);
+
+error_raw_promisc:
+error_listen:
+    for (i=0; i<tncd->n_listeners; i++) {
+        close(tncd->listeners[i].fd);
+    }
+
+    if (bound) {
+        unlink(path);
+    }
+
+    free(tncd);
+
+error_malloc_tncd:
+    patty_client_destroy(client);
+
+    return ret;
+}
+
 int main(int argc, char **argv) {
     patty_client *client;
 
     struct option opts[] = {
         { "sock", required_argument, NULL, 's' },
         { "if",   required_argument, NULL, 'i' },
+        { "tcp",  required_argument, NULL, 't' },
+        { "unix", required_argument, NULL, 'u' },
         { NULL,   0,                 NULL,  0  }
     };
 
     char *sock   = NULL,
-         *ifname = NULL;
+         *ifname = NULL,
+         *tcp    = NULL,
+         *path   = NULL;
 
     int ch,
         index;
@@ -176,10 +781,12 @@ int main(int argc, char **argv) {
     int fd;
     char pty[256];
 
-    while ((ch = getopt_long(argc, argv, "s:i:", opts, &index)) >= 0) {
+    while ((ch = getopt_long(argc, argv, "s:i:t:u:", opts, &index)) >= 0) {
         switch (ch) {
             case 's': sock   = optarg; break;
             case 'i': ifname = optarg; break;
+            case 't': tcp    = optarg; break;
+            case 'u': path   = optarg; break;
 
             default:
                 usage(argc, argv, NULL);
@@ -201,6 +808,10 @@ int main(int argc, char **argv) {
         goto error_client_new;
     }
 
+    if (tcp || path) {
+        return serve_main(argv[0], client, ifname, tcp, path);
+    }
+
     if ((fd = pty_promisc(client, ifname, pty, sizeof(pty))) < 0) {
         fprintf(stderr, "%s: %s: %s: %s\n",
             argv[0], "pty_promisc()", ifname, strerror(errno));
@@ -76,7 +76,7 @@ int main(int argc, char **argv) {
         goto error_client_bind;
     }
 
-    if (patty_client_listen(client, local) < 0) {
+    if (patty_client_listen(client, local, 0) < 0) {
         fprintf(stderr, "%s: %s: %s\n",
             argv[0], "patty_client_listen()", strerror(errno));
 
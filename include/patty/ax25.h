@@ -100,10 +100,14 @@ typedef struct _patty_ax25_params {
 
 typedef struct _patty_ax25_if patty_ax25_if;
 
+#include <patty/ax25/tap.h>
 #include <patty/client.h>
 #include <patty/ax25/frame.h>
+#include <patty/ax25/filter.h>
+#include <patty/ax25/dedup.h>
 #include <patty/ax25/if.h>
 #include <patty/ax25/route.h>
+#include <patty/ax25/mheard.h>
 #include <patty/ax25/sock.h>
 #include <patty/ax25/server.h>
 
@@ -0,0 +1,97 @@
+#ifndef _PATTY_AX25_AXUDP_H
+#define _PATTY_AX25_AXUDP_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define PATTY_AX25_AXUDP_DEFAULT_PORT "10093"
+
+#define PATTY_AX25_AXUDP_FRAME_MAX 4096
+#define PATTY_AX25_AXUDP_FCS_LEN   2
+
+/*
+ * Number of datagrams received or sent with a single recvmmsg() or
+ * sendmmsg() call
+ */
+#define PATTY_AX25_AXUDP_BATCH 32
+
+#define PATTY_AX25_AXUDP_PEERS_MAX 64
+
+/*
+ * Number of slots in the table of stations reached by way of each peer, and
+ * the number of neighbouring slots searched for a station before the one
+ * learned least recently among them is replaced
+ */
+#define PATTY_AX25_AXUDP_STATIONS 1024
+#define PATTY_AX25_AXUDP_PROBES   8
+
+/*
+ * Append the AX.25 FCS to each frame sent, and require it upon each frame
+ * received, as per RFC 1226
+ */
+#define PATTY_AX25_AXUDP_CRC (1 << 0)
+
+/*
+ * A remote station, reached at host and port; with a callsign of NULL, the
+ * peer is the one frames are sent to when their next hop is not known
+ */
+typedef struct _patty_ax25_axudp_peer_info {
+    const char *call,
+               *host,
+               *port;
+} patty_ax25_axudp_peer_info;
+
+typedef struct _patty_ax25_axudp_info {
+    int flags;
+
+    const char *host,
+               *port;
+
+    patty_ax25_axudp_peer_info peers[PATTY_AX25_AXUDP_PEERS_MAX];
+    size_t n_peers;
+} patty_ax25_axudp_info;
+
+/*
+ * An interface exchanging AX.25 frames with peers over UDP, one frame per
+ * datagram.  Frames are sent to the peer by way of which the next hop yet to
+ * repeat them, or otherwise their destination, is reached: either the one
+ * configured for that station, or the one last heard relaying frames from
+ * it.  Failing that, frames go to the default peer, or to every peer where
+ * there is none.  Datagrams from any address other than that of a peer are
+ * dropped.
+ */
+typedef struct _patty_ax25_axudp patty_ax25_axudp;
+
+patty_ax25_axudp *patty_ax25_axudp_new(patty_ax25_axudp_info *info);
+
+void patty_ax25_axudp_destroy(patty_ax25_axudp *axudp);
+
+patty_ax25_if_stats *patty_ax25_axudp_stats(patty_ax25_axudp *axudp);
+
+int patty_ax25_axudp_fd(patty_ax25_axudp *axudp);
+
+int patty_ax25_axudp_ready(patty_ax25_axudp *axudp, fd_set *fds);
+
+int patty_ax25_axudp_reset(patty_ax25_axudp *axudp);
+
+ssize_t patty_ax25_axudp_fill(patty_ax25_axudp *axudp);
+
+ssize_t patty_ax25_axudp_drain(patty_ax25_axudp *axudp,
+                               void *buf,
+                               size_t len);
+
+int patty_ax25_axudp_pending(patty_ax25_axudp *axudp);
+
+ssize_t patty_ax25_axudp_flush(patty_ax25_axudp *axudp);
+
+ssize_t patty_ax25_axudp_send(patty_ax25_axudp *axudp,
+                              const void *buf,
+                              size_t len);
+
+ssize_t patty_ax25_axudp_queued(patty_ax25_axudp *axudp);
+
+ssize_t patty_ax25_axudp_transmit(patty_ax25_axudp *axudp);
+
+patty_ax25_if_driver *patty_ax25_axudp_driver();
+
+#endif /* _PATTY_AX25_AXUDP_H */
@@ -0,0 +1,58 @@
+#ifndef _PATTY_AX25_DEDUP_H
+#define _PATTY_AX25_DEDUP_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define PATTY_AX25_DEDUP_DEFAULT_SIZE   1024
+#define PATTY_AX25_DEDUP_DEFAULT_WINDOW 30000 /* ms */
+
+/*
+ * Number of neighbouring slots searched for a fingerprint before the oldest
+ * among them is replaced
+ */
+#define PATTY_AX25_DEDUP_PROBES 4
+
+/*
+ * A set of fingerprints of frames seen recently, each being the hash of the
+ * destination, source, and everything following the address field of a
+ * frame; the repeater path is left out, so that copies of a frame heard by
+ * way of different digipeaters, or from APRS-IS, are found to be the same.
+ * The set is of a fixed size, and fingerprints are forgotten once older than
+ * the window, or when displaced by newer ones.
+ */
+typedef struct _patty_ax25_dedup patty_ax25_dedup;
+
+/*
+ * Create a set of size slots, rounded up to a power of two, remembering
+ * frames for window milliseconds
+ */
+patty_ax25_dedup *patty_ax25_dedup_new(size_t size, time_t window);
+
+void patty_ax25_dedup_destroy(patty_ax25_dedup *dedup);
+
+void patty_ax25_dedup_tick(patty_ax25_dedup *dedup,
+                           struct timespec *elapsed);
+
+/*
+ * Determine whether the encoded frame in buf has been seen within the
+ * window, returning 1 if so; otherwise, the frame is remembered, and 0 is
+ * returned.  -1 is returned if the frame is too short to be fingerprinted.
+ */
+int patty_ax25_dedup_seen(patty_ax25_dedup *dedup,
+                          const void *buf,
+                          size_t len);
+
+/*
+ * As patty_ax25_dedup_seen(), but with the fingerprint of the frame taken
+ * together with tag, so that copies of a frame are only found to be the same
+ * when they bear the same tag, such as that of the interface they were heard
+ * on
+ */
+int patty_ax25_dedup_seen_tagged(patty_ax25_dedup *dedup,
+                                 uint32_t tag,
+                                 const void *buf,
+                                 size_t len);
+
+#endif /* _PATTY_AX25_DEDUP_H */
@@ -0,0 +1,70 @@
+#ifndef _PATTY_AX25_FILTER_H
+#define _PATTY_AX25_FILTER_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#define PATTY_AX25_FILTER_MAX_INSNS 64
+
+/*
+ * A capture filter is a small program run over the raw bytes of each frame,
+ * before the frame is copied anywhere.  Each instruction but RET tests one
+ * field of the frame, then skips jt instructions past the next if the test
+ * succeeds, or jf if it fails.  Jumps only ever run forward, so every
+ * program ends within as many steps as it has instructions.
+ *
+ * Control fields are always read as in modulo 8 operation.
+ */
+enum patty_ax25_filter_op {
+    PATTY_AX25_FILTER_RET,     /* Accept the frame if k is nonzero */
+    PATTY_AX25_FILTER_DEST,    /* Destination address is addr */
+    PATTY_AX25_FILTER_SRC,     /* Source address is addr */
+    PATTY_AX25_FILTER_VIA,     /* Any repeater address is addr */
+    PATTY_AX25_FILTER_CONTROL, /* Control field, masked with mask, is k */
+    PATTY_AX25_FILTER_PID      /* Frame has a PID, and it is k */
+};
+
+/*
+ * Compare only the callsign of addresses, ignoring the SSID
+ */
+#define PATTY_AX25_FILTER_ANY_SSID (1 << 0)
+
+typedef struct _patty_ax25_filter_insn {
+    uint8_t op,
+            flags,
+            jt,
+            jf,
+            mask,
+            k;
+
+    patty_ax25_addr addr;
+} patty_ax25_filter_insn;
+
+typedef struct _patty_ax25_filter patty_ax25_filter;
+
+/*
+ * Create a filter from a program, which is validated first
+ */
+patty_ax25_filter *patty_ax25_filter_new(const patty_ax25_filter_insn *insns,
+                                         size_t count);
+
+/*
+ * Compile a filter from an expression such as "src K5OKC and type I", made
+ * of the primitives src, dst, via and host followed by an address, type
+ * followed by a frame type name, and pid followed by a number; joined by
+ * and, or and not, and grouped with parentheses.  An address without an
+ * SSID matches any SSID.
+ */
+patty_ax25_filter *patty_ax25_filter_compile(const char *expr);
+
+void patty_ax25_filter_destroy(patty_ax25_filter *filter);
+
+const patty_ax25_filter_insn *patty_ax25_filter_insns(patty_ax25_filter *filter);
+
+size_t patty_ax25_filter_count(patty_ax25_filter *filter);
+
+int patty_ax25_filter_run(const patty_ax25_filter *filter,
+                          const void *buf,
+                          size_t len);
+
+#endif /* _PATTY_AX25_FILTER_H */
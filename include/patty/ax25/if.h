@@ -4,12 +4,49 @@
 #include <stdint.h>
 #include <sys/types.h>
 
+#include <patty/timer.h>
+
 #define PATTY_AX25_IF_DEFAULT_CLASSES \
     (PATTY_AX25_PARAM_CLASSES_HALF_DUPLEX)
 
 #define PATTY_AX25_IF_DEFAULT_MTU 4096
 #define PATTY_AX25_IF_DEFAULT_MRU 4096
 
+/*
+ * Depth of the driver output queue, in bytes, beyond which the server stops
+ * reading outbound data from sockets bound to an interface
+ */
+#define PATTY_AX25_IF_QUEUE_HIGH 8192
+
+/*
+ * Depth of the driver output queue below which reading from those sockets
+ * resumes
+ */
+#define PATTY_AX25_IF_QUEUE_LOW 4096
+
+/*
+ * Size of each of the rings used to pass frames between the protocol thread
+ * and the I/O thread of a threaded interface
+ */
+#define PATTY_AX25_IF_THREAD_RING_SIZE 65536
+
+/*
+ * Channel access defaults, in KISS units; persistence is p * 256 - 1, and
+ * time values are in units of 10ms
+ */
+#define PATTY_AX25_IF_DEFAULT_PERSIST    63
+#define PATTY_AX25_IF_DEFAULT_SLOT_TIME  10
+
+/*
+ * Adaptive channel access controller tunables
+ */
+#define PATTY_AX25_IF_ADAPT_INTERVAL  10000 /* ms */
+#define PATTY_AX25_IF_ADAPT_BUSY          2 /* frames heard per second */
+#define PATTY_AX25_IF_ADAPT_PERSIST_MIN  15
+#define PATTY_AX25_IF_ADAPT_PERSIST_MAX 255
+#define PATTY_AX25_IF_ADAPT_SLOT_MIN      5
+#define PATTY_AX25_IF_ADAPT_SLOT_MAX     50
+
 enum patty_ax25_if_flags {
     PATTY_AX25_IF_HALF_DUPLEX = (1 << 0),
     PATTY_AX25_IF_FULL_DUPLEX = (1 << 1),
@@ -17,6 +54,22 @@ enum patty_ax25_if_flags {
     PATTY_AX25_IF_SEGMENTER   = (1 << 7)
 };
 
+enum patty_ax25_if_param {
+    PATTY_AX25_IF_PARAM_TXDELAY,
+    PATTY_AX25_IF_PARAM_PERSIST,
+    PATTY_AX25_IF_PARAM_SLOT_TIME,
+    PATTY_AX25_IF_PARAM_TX_TAIL,
+    PATTY_AX25_IF_PARAM_FULL_DUPLEX
+};
+
+/*
+ * How frames are delimited when written to promiscuous listeners
+ */
+enum patty_ax25_if_promisc_framing {
+    PATTY_AX25_IF_PROMISC_KISS = 1,
+    PATTY_AX25_IF_PROMISC_PACKET
+};
+
 enum patty_ax25_if_status {
     PATTY_AX25_IF_DOWN,
     PATTY_AX25_IF_UP,
@@ -28,7 +81,8 @@ typedef struct _patty_ax25_if_stats {
            tx_frames,
            rx_bytes,
            tx_bytes,
-           dropped;
+           dropped,
+           retries;
 } patty_ax25_if_stats;
 
 typedef void *(patty_ax25_if_driver_create)(void *);
@@ -53,6 +107,14 @@ typedef ssize_t (patty_ax25_if_driver_flush)(void *);
 
 typedef ssize_t (patty_ax25_if_driver_send)(void *, const void *, size_t);
 
+typedef ssize_t (patty_ax25_if_driver_queued)(void *);
+
+typedef ssize_t (patty_ax25_if_driver_transmit)(void *);
+
+typedef int (patty_ax25_if_driver_param_set)(void *,
+                                             enum patty_ax25_if_param,
+                                             uint32_t);
+
 typedef struct _patty_ax25_if_driver {
     patty_ax25_if_driver_create *create;
     patty_ax25_if_driver_destroy *destroy;
@@ -65,12 +127,34 @@ typedef struct _patty_ax25_if_driver {
     patty_ax25_if_driver_pending *pending;
     patty_ax25_if_driver_flush *flush;
     patty_ax25_if_driver_send *send;
+    patty_ax25_if_driver_queued *queued;
+    patty_ax25_if_driver_transmit *transmit;
+    patty_ax25_if_driver_param_set *param_set;
 } patty_ax25_if_driver;
 
 typedef void patty_ax25_if_phy;
 
 typedef void patty_ax25_if_info;
 
+/*
+ * State for the optional adaptive persistence and slot time controller, which
+ * samples interface statistics once per interval
+ */
+typedef struct _patty_ax25_if_adapt {
+    int enabled;
+
+    uint32_t persist,
+             slot_time;
+
+    size_t rx_frames,
+           tx_frames,
+           retries;
+
+    patty_timer timer;
+} patty_ax25_if_adapt;
+
+typedef struct _patty_ax25_if_thread patty_ax25_if_thread;
+
 typedef struct _patty_ax25_if {
     uint32_t flags_classes;
 
@@ -85,6 +169,11 @@ typedef struct _patty_ax25_if {
     patty_ax25_addr addr;
     patty_list *aliases;
     patty_dict *promisc_fds;
+    patty_ax25_tap *tap;
+
+    patty_ax25_if_adapt adapt;
+
+    patty_ax25_if_thread *thread;
 
     patty_ax25_if_driver *driver;
     patty_ax25_if_phy *phy;
@@ -115,15 +204,71 @@ int patty_ax25_if_addr_delete(patty_ax25_if *iface, patty_ax25_addr *addr);
 int patty_ax25_if_addr_match(patty_ax25_if *iface, patty_ax25_addr *addr);
 
 int patty_ax25_if_promisc_add(patty_ax25_if *iface,
-                              int fd);
+                              int fd,
+                              enum patty_ax25_if_promisc_framing framing);
 
 int patty_ax25_if_promisc_delete(patty_ax25_if *iface,
                                  int fd);
 
+/*
+ * Only deliver frames accepted by filter to a promiscuous listener; the
+ * filter remains owned by the caller, and NULL delivers every frame
+ */
+int patty_ax25_if_promisc_filter(patty_ax25_if *iface,
+                                 int fd,
+                                 const patty_ax25_filter *filter);
+
+int patty_ax25_if_promisc_notices(patty_ax25_if *iface,
+                                  int fd,
+                                  int enable);
+
+/*
+ * Frames are never written to promiscuous listeners in a way which could
+ * block; those which cannot be queued are dropped, and their number is told
+ * to the listener ahead of the next frame it receives.  Listeners on ptys
+ * receive this as a KISS frame on port PATTY_KISS_TNC_PORT_DROPPED, only
+ * once enabled with patty_ax25_if_promisc_notices(), and on SOCK_SEQPACKET
+ * channels as a four byte message holding the count in network byte order.
+ *
+ * Output queued for a listener on a pty is written by
+ * patty_ax25_if_promisc_transmit() once its descriptor becomes writable.
+ */
+ssize_t patty_ax25_if_promisc_queued(patty_ax25_if *iface, int fd);
+
+ssize_t patty_ax25_if_promisc_transmit(patty_ax25_if *iface, int fd);
+
+/*
+ * Return the interface's shared memory tap, creating it on first use
+ */
+patty_ax25_tap *patty_ax25_if_tap(patty_ax25_if *iface);
+
 void patty_ax25_if_drop(patty_ax25_if *iface);
 
+void patty_ax25_if_retry(patty_ax25_if *iface);
+
+int patty_ax25_if_param_set(patty_ax25_if *iface,
+                            enum patty_ax25_if_param param,
+                            uint32_t value);
+
+int patty_ax25_if_adapt_start(patty_ax25_if *iface,
+                              uint32_t persist,
+                              uint32_t slot_time);
+
+void patty_ax25_if_adapt_stop(patty_ax25_if *iface);
+
+int patty_ax25_if_adapt_tick(patty_ax25_if *iface,
+                             struct timespec *elapsed);
+
+int patty_ax25_if_thread_init(patty_ax25_if *iface, int cpu);
+
+int patty_ax25_if_thread_start(patty_ax25_if *iface);
+
+void patty_ax25_if_thread_stop(patty_ax25_if *iface);
+
 int patty_ax25_if_fd(patty_ax25_if *iface);
 
+int patty_ax25_if_phy_fd(patty_ax25_if *iface);
+
 int patty_ax25_if_ready(patty_ax25_if *iface, fd_set *fds);
 
 int patty_ax25_if_reset(patty_ax25_if *iface);
@@ -138,6 +283,10 @@ ssize_t patty_ax25_if_flush(patty_ax25_if *iface);
 
 ssize_t patty_ax25_if_recv(patty_ax25_if *iface, void *buf, size_t len);
 
+ssize_t patty_ax25_if_queued(patty_ax25_if *iface);
+
+ssize_t patty_ax25_if_transmit(patty_ax25_if *iface);
+
 ssize_t patty_ax25_if_send(patty_ax25_if *iface, const void *buf, size_t len);
 
 #endif /* _PATTY_AX25_IF_H */
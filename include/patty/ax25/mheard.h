@@ -0,0 +1,76 @@
+#ifndef _PATTY_AX25_MHEARD_H
+#define _PATTY_AX25_MHEARD_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define PATTY_AX25_MHEARD_DEFAULT_SIZE 256
+
+/*
+ * Number of neighbouring slots searched for a station before the one heard
+ * least recently among them is replaced
+ */
+#define PATTY_AX25_MHEARD_PROBES 8
+
+/*
+ * Seconds for which the path a station was last heard by is preferred to a
+ * longer one it is heard by since, and beyond which entries are no longer
+ * used to select routes
+ */
+#define PATTY_AX25_MHEARD_PATH_AGE 600
+#define PATTY_AX25_MHEARD_MAX_AGE  1800
+
+/*
+ * A station heard, the interface it was heard on, and the path of repeaters
+ * its frames came by, in the order they were repeated; where a station is
+ * heard by more than one path, the shortest heard recently is kept
+ */
+typedef struct _patty_ax25_mheard_entry {
+    patty_ax25_addr station;
+    patty_ax25_if *iface;
+
+    time_t first,
+           last;
+
+    size_t frames;
+
+    unsigned int hops;
+
+    patty_ax25_addr path[PATTY_AX25_MAX_HOPS];
+} patty_ax25_mheard_entry;
+
+/*
+ * A table of fixed size holding the stations heard; the hashes used to
+ * locate stations are kept apart from the entries themselves, so that
+ * lookups touch as little memory as possible
+ */
+typedef struct _patty_ax25_mheard patty_ax25_mheard;
+
+patty_ax25_mheard *patty_ax25_mheard_new(size_t size);
+
+void patty_ax25_mheard_destroy(patty_ax25_mheard *mheard);
+
+/*
+ * Record the source of a frame heard on iface at time now, along with the
+ * repeaters it was heard by way of
+ */
+int patty_ax25_mheard_update(patty_ax25_mheard *mheard,
+                             patty_ax25_if *iface,
+                             patty_ax25_frame *frame,
+                             time_t now);
+
+patty_ax25_mheard_entry *patty_ax25_mheard_find(patty_ax25_mheard *mheard,
+                                                patty_ax25_addr *station);
+
+/*
+ * Forget every station heard on iface
+ */
+void patty_ax25_mheard_forget_if(patty_ax25_mheard *mheard,
+                                 patty_ax25_if *iface);
+
+int patty_ax25_mheard_each(patty_ax25_mheard *mheard,
+                           int (*callback)(patty_ax25_mheard_entry *, void *),
+                           void *ctx);
+
+#endif /* _PATTY_AX25_MHEARD_H */
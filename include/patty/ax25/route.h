@@ -1,8 +1,23 @@
 #ifndef _PATTY_AX25_ROUTE_H
 #define _PATTY_AX25_ROUTE_H
 
-typedef struct _patty_ax25_route {
+/*
+ * Maximum number of interfaces a single route may reach its destination by
+ */
+#define PATTY_AX25_ROUTE_MAX_NEXTHOPS 8
+
+/*
+ * An interface a route may use, and its weight relative to the others: an
+ * interface of twice the weight is given twice the load
+ */
+typedef struct _patty_ax25_route_nexthop {
     patty_ax25_if *iface;
+    unsigned int weight;
+} patty_ax25_route_nexthop;
+
+typedef struct _patty_ax25_route {
+    patty_ax25_route_nexthop nexthops[PATTY_AX25_ROUTE_MAX_NEXTHOPS];
+    size_t n_nexthops;
 
     patty_ax25_addr dest,
                     repeaters[PATTY_AX25_MAX_HOPS];
@@ -18,6 +33,14 @@ patty_ax25_route *patty_ax25_route_new(patty_ax25_if *iface,
                                        int hops);
 
 patty_ax25_route *patty_ax25_route_new_default(patty_ax25_if *iface);
+
+/*
+ * Allow a route to use another interface, of the given weight, or change the
+ * weight of one it uses already
+ */
+int patty_ax25_route_nexthop_add(patty_ax25_route *route,
+                                 patty_ax25_if *iface,
+                                 unsigned int weight);
     
 patty_ax25_route_table *patty_ax25_route_table_new();
 
@@ -32,6 +55,12 @@ int patty_ax25_route_table_delete(patty_ax25_route_table *route,
 patty_ax25_route *patty_ax25_route_table_find(patty_ax25_route_table *table,
                                               patty_ax25_addr *dest);
 
+/*
+ * Find the route to dest itself, without falling back to the default route
+ */
+patty_ax25_route *patty_ax25_route_table_get(patty_ax25_route_table *table,
+                                             patty_ax25_addr *dest);
+
 patty_ax25_route *patty_ax25_route_table_default(patty_ax25_route_table *table);
 
 int patty_ax25_route_table_each(patty_ax25_route_table *table,
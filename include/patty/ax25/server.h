@@ -1,12 +1,58 @@
 #ifndef _PATTY_AX25_SERVER_H
 #define _PATTY_AX25_SERVER_H
 
+/*
+ * Number of peers whose XID parameters are remembered, and for how many
+ * seconds, so that connections to them may begin without an XID exchange
+ */
+#define PATTY_AX25_SERVER_XID_CACHE_MAX 256
+#define PATTY_AX25_SERVER_XID_CACHE_TTL 3600
+
+/*
+ * Number of stations whose interface is learned by the bridge, and for how
+ * many seconds after last being heard
+ */
+#define PATTY_AX25_SERVER_BRIDGE_MAX 1024
+#define PATTY_AX25_SERVER_BRIDGE_TTL 1800
+
+/*
+ * Milliseconds for which copies of a frame heard again on the interface it
+ * was bridged from are not bridged again; shorter than any retransmission
+ * timer, so that only copies looping back are caught
+ */
+#define PATTY_AX25_SERVER_BRIDGE_DEDUP_WINDOW 1000
+
 typedef struct _patty_ax25_server patty_ax25_server;
 
+/*
+ * Limits on inbound connections, where zero means no limit: the number of
+ * links open at once per listening socket and per peer, and the rate per
+ * second, in bursts of up to burst, at which SABM and XID frames may set up
+ * new links.  Frames exceeding these are answered with DM.
+ */
+typedef struct _patty_ax25_server_limits {
+    size_t links,
+           peer_links,
+           rate,
+           burst;
+} patty_ax25_server_limits;
+
 patty_ax25_server *patty_ax25_server_new();
 
 void patty_ax25_server_destroy(patty_ax25_server *server);
 
+int patty_ax25_server_limits_set(patty_ax25_server *server,
+                                 const patty_ax25_server_limits *limits);
+
+/*
+ * Set the windows, in milliseconds, within which copies of a frame already
+ * digipeated are not repeated again, and copies of a UI frame already
+ * delivered to local sockets are dropped; a window of zero disables either
+ */
+int patty_ax25_server_dedup_set(patty_ax25_server *server,
+                                time_t digi,
+                                time_t ui);
+
 int patty_ax25_server_if_add(patty_ax25_server *server,
                              patty_ax25_if *iface,
                              const char *ifname);
@@ -17,6 +63,34 @@ int patty_ax25_server_if_delete(patty_ax25_server *server,
 patty_ax25_if *patty_ax25_server_if_get(patty_ax25_server *server,
                                         const char *ifname);
 
+/*
+ * Digipeat frames heard on the interface ifname whose next hop yet to repeat
+ * them names one of its addresses or aliases, or is a WIDEn-N hop where n is
+ * no greater than wide, out of the interface outname, or of the same
+ * interface if outname is NULL
+ */
+int patty_ax25_server_digi_set(patty_ax25_server *server,
+                               const char *ifname,
+                               const char *outname,
+                               int wide);
+
+/*
+ * Join the interface ifname to the bridge: frames heard on any interface in
+ * the bridge, not addressed to this station, are forwarded to the interface
+ * in the bridge where their destination was last heard, or to all others in
+ * the bridge if the destination has not been heard
+ */
+int patty_ax25_server_bridge_add(patty_ax25_server *server,
+                                 const char *ifname);
+
+/*
+ * Allow raw sockets bound to the interface ifname to set its channel access
+ * parameters with PATTY_AX25_SOCK_IF_PARAM, which are otherwise refused with
+ * EPERM
+ */
+int patty_ax25_server_if_param_allow(patty_ax25_server *server,
+                                     const char *ifname);
+
 int patty_ax25_server_if_each(patty_ax25_server *server,
                               int (*callback)(char *, patty_ax25_if *, void *),
                               void *ctx);
@@ -30,12 +104,19 @@ int patty_ax25_server_route_delete(patty_ax25_server *server,
 patty_ax25_route *patty_ax25_server_route_find(patty_ax25_server *server,
                                                patty_ax25_addr *dest);
 
+patty_ax25_route *patty_ax25_server_route_get(patty_ax25_server *server,
+                                              patty_ax25_addr *dest);
+
 patty_ax25_route *patty_ax25_server_route_default(patty_ax25_server *server);
 
 int patty_ax25_server_route_each(patty_ax25_server *server,
                                  int (*callback)(patty_ax25_route *, void *),
                                  void *ctx);
 
+int patty_ax25_server_mheard_each(patty_ax25_server *server,
+                                  int (*callback)(patty_ax25_mheard_entry *, void *),
+                                  void *ctx);
+
 int patty_ax25_server_start(patty_ax25_server *server, const char *path);
 
 int patty_ax25_server_stop(patty_ax25_server *server);
@@ -46,6 +46,13 @@
 #define PATTY_AX25_SOCK_2_2_MAX_I_LEN  1536
 #define PATTY_AX25_SOCK_2_2_MAX_WINDOW  127
 
+/*
+ * Number of established connections which may wait to be accepted by a
+ * listening socket
+ */
+#define PATTY_AX25_SOCK_DEFAULT_BACKLOG  16
+#define PATTY_AX25_SOCK_MAX_BACKLOG     128
+
 /*
  * Parameters flags to be set when calling patty_client_setsockopt() with
  * PATTY_AX25_SOCK_PARAMS
@@ -66,6 +73,20 @@ enum patty_ax25_sock_type {
     PATTY_AX25_SOCK_RAW
 };
 
+/*
+ * Flag which may be OR'd into the socket type given to patty_client_socket()
+ * to request a SOCK_SEQPACKET data channel in place of a pty; each read or
+ * write on such a channel carries exactly one frame, and writes larger than
+ * the socket MTU are discarded
+ */
+#define PATTY_AX25_SOCK_SEQPACKET (1 << 8)
+#define PATTY_AX25_SOCK_TYPE_MASK 0xff
+
+enum patty_ax25_sock_chan {
+    PATTY_AX25_SOCK_CHAN_PTY,
+    PATTY_AX25_SOCK_CHAN_SEQPACKET
+};
+
 enum patty_ax25_sock_state {
     PATTY_AX25_SOCK_CLOSED,
     PATTY_AX25_SOCK_LISTENING,
@@ -89,9 +110,56 @@ enum patty_ax25_sock_flow {
 
 enum patty_ax25_sock_opt {
     PATTY_AX25_SOCK_PARAMS,
-    PATTY_AX25_SOCK_IF
+    PATTY_AX25_SOCK_IF,
+    PATTY_AX25_SOCK_TAP,
+    PATTY_AX25_SOCK_SUBSCRIBE,
+    PATTY_AX25_SOCK_FILTER,
+    PATTY_AX25_SOCK_REUSE,
+    PATTY_AX25_SOCK_IF_PARAM,
+    PATTY_AX25_SOCK_SUB_DROPPED,
+    PATTY_AX25_SOCK_NOTICES
 };
 
+/*
+ * Stream sockets set with PATTY_AX25_SOCK_REUSE before being bound may share
+ * their local address with other such sockets, of any client, and have
+ * incoming connections spread across them as given by the first of them to
+ * listen
+ */
+enum patty_ax25_sock_reuse {
+    PATTY_AX25_SOCK_REUSE_NONE,
+    PATTY_AX25_SOCK_REUSE_HASH,  /* by hash of the peer address */
+    PATTY_AX25_SOCK_REUSE_LEAST  /* to the client holding fewest sockets */
+};
+
+/*
+ * Fields of received UI frames to be matched by a datagram socket
+ * subscription, set with PATTY_AX25_SOCK_SUBSCRIBE; a subscription with no
+ * fields to match is removed
+ */
+#define PATTY_AX25_SOCK_MATCH_DEST  (1 << 0)
+#define PATTY_AX25_SOCK_MATCH_PROTO (1 << 1)
+#define PATTY_AX25_SOCK_MATCH_SRC   (1 << 2)
+
+/*
+ * Size of the ring in which UI frames received by subscribers on ptys are
+ * queued until the client reads them
+ */
+#define PATTY_AX25_SOCK_SUB_BUFSZ 65536
+
+typedef struct _patty_ax25_sock_sub {
+    uint32_t match;
+
+    /*
+     * The destination must match exactly, including SSID, whereas the
+     * callsign of the source need only begin with that of src
+     */
+    patty_ax25_addr dest,
+                    src;
+
+    uint8_t proto;
+} patty_ax25_sock_sub;
+
 typedef struct _patty_ax25_sock_assembler {
     size_t total,
            remaining,
@@ -120,17 +188,80 @@ typedef struct _patty_ax25_sock {
 
     int hops;
 
+    /*
+     * Most connections which may wait to be accepted, when listening
+     */
+    int backlog;
+
+    /*
+     * Whether the local address may be shared with other listening sockets
+     */
+    enum patty_ax25_sock_reuse reuse;
+
+    /*
+     * For listening sockets, the number of links admitted and still open;
+     * for those links, the listening socket which admitted them, if it is
+     * still open, and whether they count towards the limit per peer
+     */
+    size_t links;
+
+    struct _patty_ax25_sock *listener;
+
+    int admitted;
+
+    /*
+     * Whether an outbound connection began with parameters remembered from
+     * an earlier XID exchange with the peer, rather than with one of its own
+     */
+    int xid_cached;
+
     /*
      * Reader for raw packets for PATTY_AX25_SOCK_RAW type
      */
     struct _patty_kiss_tnc *raw;
 
     /*
-     * File descriptor information
+     * File descriptor information; for SOCK_SEQPACKET channels, peer_fd holds
+     * the client end of the socket pair until it is passed to the client
      */
-    int fd;
+    enum patty_ax25_sock_chan chan;
+
+    int fd,
+        peer_fd;
+
+    /*
+     * eventfd used to wake the client when the interface tap this socket
+     * is attached to receives new frames
+     */
+    int tap_fd;
+
     char pty[PATTY_AX25_SOCK_PATH_SIZE];
 
+    /*
+     * UI frames subscribed to by datagram sockets
+     */
+    patty_ax25_sock_sub sub;
+
+    /*
+     * Output ring of UI frames awaiting delivery to subscribers on ptys,
+     * and the number of UI frames dropped as the client fell behind
+     */
+    uint8_t *sub_buf;
+
+    size_t sub_head,
+           sub_len,
+           sub_dropped;
+
+    /*
+     * Capture filter applied to frames delivered to promiscuous sockets
+     */
+    patty_ax25_filter *filter;
+
+    /*
+     * Whether a promiscuous socket on a pty is told of frames dropped for it
+     */
+    int notices;
+
     /*
      * Transmit and receive buffers
      */
@@ -215,6 +346,18 @@ char *patty_ax25_sock_pty(patty_ax25_sock *sock);
 int patty_ax25_sock_bind_if(patty_ax25_sock *sock,
                             patty_ax25_if *iface);
 
+int patty_ax25_sock_tap(patty_ax25_sock *sock,
+                        patty_ax25_if *iface);
+
+/*
+ * Replace the capture filter of a raw socket, taking ownership of filter;
+ * NULL removes the filter
+ */
+void patty_ax25_sock_filter(patty_ax25_sock *sock,
+                            patty_ax25_filter *filter);
+
+void patty_ax25_sock_notices(patty_ax25_sock *sock, int enable);
+
 /*
  * Stream-oriented state management
  */
@@ -291,4 +434,31 @@ ssize_t patty_ax25_sock_write(patty_ax25_sock *sock,
                               void *buf,
                               size_t len);
 
+int patty_ax25_sock_sub_match(patty_ax25_sock *sock,
+                              patty_ax25_frame *frame);
+
+/*
+ * Subscribers on ptys are never written to in a way which could block: UI
+ * frames are queued, or dropped and counted when the queue is full, and the
+ * queue is written out with patty_ax25_sock_sub_flush() as the pty becomes
+ * writable
+ */
+int patty_ax25_sock_sub_init(patty_ax25_sock *sock);
+
+ssize_t patty_ax25_sock_sub_send(patty_ax25_sock *sock,
+                                 const void *buf,
+                                 size_t len);
+
+ssize_t patty_ax25_sock_sub_queued(patty_ax25_sock *sock);
+
+ssize_t patty_ax25_sock_sub_flush(patty_ax25_sock *sock);
+
+ssize_t patty_ax25_sock_sendto(patty_ax25_sock *sock,
+                               patty_ax25_if *iface,
+                               patty_ax25_addr *remote,
+                               patty_ax25_addr *repeaters,
+                               unsigned int hops,
+                               void *buf,
+                               size_t len);
+
 #endif /* _PATTY_AX25_SOCK_H */
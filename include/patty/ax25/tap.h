@@ -0,0 +1,75 @@
+#ifndef _PATTY_AX25_TAP_H
+#define _PATTY_AX25_TAP_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#define PATTY_AX25_TAP_MAGIC   0x50415450 /* "PATP" */
+#define PATTY_AX25_TAP_VERSION 1
+
+#define PATTY_AX25_TAP_DEFAULT_SLOTS 1024
+
+/*
+ * A tap is a shared memory ring of timestamped raw frames, written by the
+ * daemon for each frame sent or received on an interface and read directly by
+ * any number of consumers, each of which keeps its own cursor.  The producer
+ * never waits on consumers; a consumer which falls more than a full ring
+ * behind is told how many frames it missed.
+ */
+typedef struct _patty_ax25_tap patty_ax25_tap;
+
+enum patty_ax25_tap_dir {
+    PATTY_AX25_TAP_RX = 1,
+    PATTY_AX25_TAP_TX
+};
+
+typedef struct _patty_ax25_tap_info {
+    struct timespec ts;
+
+    enum patty_ax25_tap_dir dir;
+
+    /*
+     * Number of frames overwritten before they could be read, since the
+     * previous call to patty_ax25_tap_read()
+     */
+    size_t dropped;
+} patty_ax25_tap_info;
+
+/*
+ * Producer side
+ */
+patty_ax25_tap *patty_ax25_tap_new(size_t slots, size_t mtu);
+
+void patty_ax25_tap_destroy(patty_ax25_tap *tap);
+
+int patty_ax25_tap_fd(patty_ax25_tap *tap);
+
+size_t patty_ax25_tap_size(patty_ax25_tap *tap);
+
+void patty_ax25_tap_push(patty_ax25_tap *tap,
+                         enum patty_ax25_tap_dir dir,
+                         const void *buf,
+                         size_t len);
+
+int patty_ax25_tap_watch(patty_ax25_tap *tap, int eventfd);
+
+int patty_ax25_tap_unwatch(patty_ax25_tap *tap, int eventfd);
+
+int patty_ax25_tap_signal(patty_ax25_tap *tap);
+
+/*
+ * Consumer side
+ */
+patty_ax25_tap *patty_ax25_tap_open(int fd, size_t size, int eventfd);
+
+int patty_ax25_tap_event_fd(patty_ax25_tap *tap);
+
+ssize_t patty_ax25_tap_read(patty_ax25_tap *tap,
+                            void *buf,
+                            size_t len,
+                            patty_ax25_tap_info *info);
+
+int patty_ax25_tap_wait(patty_ax25_tap *tap);
+
+#endif /* _PATTY_AX25_TAP_H */
@@ -15,9 +15,62 @@ enum patty_client_call {
     PATTY_CLIENT_CLOSE,
     PATTY_CLIENT_SENDTO,
     PATTY_CLIENT_RECVFROM,
+    PATTY_CLIENT_GETSOCKOPT,
     PATTY_CLIENT_CALL_COUNT
 };
 
+/*
+ * Tagged requests have this flag OR'd into the call number, which is then
+ * followed by a 32 bit request identifier.  Each response to a tagged request
+ * is preceded by a patty_client_reply header bearing the same identifier, and
+ * responses may arrive in any order.
+ */
+#define PATTY_CLIENT_TAGGED (1 << 16)
+
+#define PATTY_CLIENT_REPLY_MAX 512
+
+/*
+ * Request identifiers are kept positive, so that they may be returned by the
+ * asynchronous calls below
+ */
+#define PATTY_CLIENT_ID_MASK 0x7fffffff
+
+/*
+ * Framed requests
+ *
+ * A connection to the daemon which begins with PATTY_CLIENT_MAGIC carries
+ * only framed messages, each a patty_client_message header followed by len
+ * bytes of request structure and payload.  Any number of messages may be
+ * sent at once, up to PATTY_CLIENT_BATCH_MAX bytes; the daemon handles every
+ * complete message it has received in a single pass.  Responses are tagged
+ * with the identifier given in each message, as with tagged requests.
+ */
+#define PATTY_CLIENT_MAGIC     0x50545931 /* "1YTP" */
+#define PATTY_CLIENT_VERSION   1
+#define PATTY_CLIENT_BATCH_MAX 65536
+
+/*
+ * May be given in place of a socket fd in a request, to refer to the socket
+ * most recently created on the same connection; this allows a socket to be
+ * created and set up within a single batch of requests
+ */
+#define PATTY_CLIENT_FD_LAST -2
+
+typedef struct _patty_client_message {
+    uint32_t magic;
+    uint16_t version,
+             call;
+    uint32_t id,
+             len;
+} patty_client_message;
+
+typedef struct _patty_client_reply {
+    uint32_t id;
+    int ret;
+    int eno;
+    size_t len;
+} patty_client_reply;
+
 typedef struct _patty_client_sock patty_client_sock;
 typedef struct _patty_client patty_client;
 
@@ -29,6 +82,92 @@ ssize_t patty_client_read(patty_client *client, void *buf, size_t len);
 
 ssize_t patty_client_write(patty_client *client, const void *buf, size_t len);
 
+/*
+ * Asynchronous operation
+ *
+ * Each of the _async() calls below issues a request without waiting for it
+ * to complete, returning a request identifier.  Once the daemon responds,
+ * the callback given is invoked with the outcome of the call, from within
+ * patty_client_dispatch(); the client fd may be polled for readability to
+ * learn when responses are available.  Any number of requests may be
+ * outstanding at once, and synchronous calls may be freely mixed with them.
+ */
+typedef struct _patty_client_result {
+    int id;
+    enum patty_client_call call;
+
+    /*
+     * The return value and errno of the call; for socket() and accept(),
+     * ret is the new socket fd
+     */
+    int ret,
+        eno;
+
+    /*
+     * Address of the peer of a socket returned by accept()
+     */
+    patty_ax25_addr peer;
+} patty_client_result;
+
+typedef void (*patty_client_callback)(patty_client *client,
+                                      patty_client_result *result,
+                                      void *ctx);
+
+int patty_client_fd(patty_client *client);
+
+int patty_client_dispatch(patty_client *client);
+
+size_t patty_client_pending(patty_client *client);
+
+int patty_client_socket_async(patty_client *client,
+                              int proto,
+                              int type,
+                              patty_client_callback callback,
+                              void *ctx);
+
+int patty_client_bind_async(patty_client *client,
+                            int fd,
+                            patty_ax25_addr *addr,
+                            patty_client_callback callback,
+                            void *ctx);
+
+int patty_client_listen_async(patty_client *client,
+                              int fd,
+                              int backlog,
+                              patty_client_callback callback,
+                              void *ctx);
+
+int patty_client_accept_async(patty_client *client,
+                              int fd,
+                              int flags,
+                              patty_client_callback callback,
+                              void *ctx);
+
+int patty_client_connect_async(patty_client *client,
+                               int fd,
+                               patty_ax25_addr *peer,
+                               patty_client_callback callback,
+                               void *ctx);
+
+int patty_client_close_async(patty_client *client,
+                             int fd,
+                             patty_client_callback callback,
+                             void *ctx);
+
+/*
+ * Batching
+ *
+ * Requests issued between patty_client_batch_begin() and
+ * patty_client_batch_end() are held back and written to the daemon all at
+ * once, to be handled in a single pass.  Within a batch, PATTY_CLIENT_FD_LAST
+ * may be given to the _async() calls in place of a socket fd, to refer to the
+ * socket created by the most recent call to patty_client_socket_async().  A
+ * synchronous call made during a batch sends the batch before it.
+ */
+int patty_client_batch_begin(patty_client *client);
+
+int patty_client_batch_end(patty_client *client);
+
 /*
  * ping()
  */
@@ -76,17 +215,103 @@ typedef struct _patty_client_setsockopt_if {
     int state;
 } patty_client_setsockopt_if;
 
+/*
+ * Data for PATTY_AX25_SOCK_REUSE, where mode is an enum patty_ax25_sock_reuse
+ */
+typedef struct _patty_client_setsockopt_reuse {
+    int mode;
+} patty_client_setsockopt_reuse;
+
+/*
+ * Data for PATTY_AX25_SOCK_IF_PARAM, setting a channel access parameter of
+ * the interface a raw socket is bound to, where param is an enum
+ * patty_ax25_if_param, and value is in the units of the KISS command which
+ * sets it; refused with EPERM unless the interface is named by an ifparam
+ * directive in the daemon configuration
+ */
+typedef struct _patty_client_setsockopt_if_param {
+    int param;
+    uint32_t value;
+} patty_client_setsockopt_if_param;
+
+/*
+ * Data for PATTY_AX25_SOCK_NOTICES, setting whether a promiscuous raw socket
+ * on a pty is sent reports of frames dropped for it on KISS port
+ * PATTY_KISS_TNC_PORT_DROPPED; as these may confuse KISS applications which
+ * know nothing of them, they are only sent when enabled
+ */
+typedef struct _patty_client_setsockopt_notices {
+    int enable;
+} patty_client_setsockopt_notices;
+
 typedef struct _patty_client_setsockopt_response {
     int ret;
     int eno;
 } patty_client_setsockopt_response;
 
+/*
+ * Sent in place of the usual response upon successfully attaching to a tap,
+ * along with the tap's shared memory and wakeup eventfd
+ */
+typedef struct _patty_client_setsockopt_tap {
+    int ret;
+    int eno;
+    size_t size;
+} patty_client_setsockopt_tap;
+
+int patty_client_setsockopt_async(patty_client *client,
+                                  int fd,
+                                  int opt,
+                                  void *data,
+                                  size_t len,
+                                  patty_client_callback callback,
+                                  void *ctx);
+
 int patty_client_setsockopt(patty_client *client,
                             int fd,
                             int opt,
                             void *data,
                             size_t len);
 
+/*
+ * Attach a raw socket to the shared memory tap of the named interface,
+ * returning a consumer handle to read frames from directly
+ */
+patty_ax25_tap *patty_client_tap(patty_client *client,
+                                 int fd,
+                                 const char *ifname);
+
+/*
+ * getsockopt()
+ *
+ * The response is followed by len bytes of option data.  Options which may
+ * be read are:
+ *
+ *   - PATTY_AX25_SOCK_SUB_DROPPED, a size_t holding the number of UI frames
+ *     a subscribed datagram socket has had dropped, as the client fell
+ *     behind in reading them
+ */
+typedef struct _patty_client_getsockopt_request {
+    int fd;
+    int opt;
+} patty_client_getsockopt_request;
+
+typedef struct _patty_client_getsockopt_response {
+    int ret;
+    int eno;
+    size_t len;
+} patty_client_getsockopt_response;
+
+/*
+ * Read up to *len bytes of option data into data, setting *len to the size
+ * of the option
+ */
+int patty_client_getsockopt(patty_client *client,
+                            int fd,
+                            int opt,
+                            void *data,
+                            size_t *len);
+
 /*
  * bind()
  */
@@ -106,9 +331,16 @@ int patty_client_bind(patty_client *client,
 
 /*
  * listen()
+ *
+ * Connections are established by the daemon as soon as they arrive, then
+ * wait to be accepted; once backlog connections are waiting, further
+ * attempts are ignored, to be retried by their peers.  A backlog of zero or
+ * less selects PATTY_AX25_SOCK_DEFAULT_BACKLOG.  While connections wait, the
+ * listening socket is readable.
  */
 typedef struct _patty_client_listen_request {
     int fd;
+    int backlog;
 } patty_client_listen_request;
 
 typedef struct _patty_client_listen_response {
@@ -117,13 +349,25 @@ typedef struct _patty_client_listen_response {
 } patty_client_listen_response;
 
 int patty_client_listen(patty_client *client,
-                        int fd);
+                        int fd,
+                        int backlog);
 
 /*
  * accept()
+ *
+ * With PATTY_CLIENT_ACCEPT_NONBLOCK, fail with EAGAIN rather than wait when
+ * no connection is waiting to be accepted.
+ */
+#define PATTY_CLIENT_ACCEPT_NONBLOCK (1 << 0)
+
+/*
+ * Most connections taken by a single call to patty_client_accept_bulk()
  */
+#define PATTY_CLIENT_ACCEPT_BULK_MAX 64
+
 typedef struct _patty_client_accept_request {
     int fd;
+    int flags;
 } patty_client_accept_request;
 
 typedef struct _patty_client_accept_response {
@@ -141,6 +385,22 @@ int patty_client_accept(patty_client *client,
                         int fd,
                         patty_ax25_addr *peer);
 
+int patty_client_accept4(patty_client *client,
+                         int fd,
+                         patty_ax25_addr *peer,
+                         int flags);
+
+/*
+ * Take up to max waiting connections at once, without waiting for any,
+ * storing their fds and peer addresses; returns the number taken, or -1 with
+ * errno set to EAGAIN if none were waiting
+ */
+ssize_t patty_client_accept_bulk(patty_client *client,
+                                 int fd,
+                                 int *fds,
+                                 patty_ax25_addr *peers,
+                                 size_t max);
+
 /*
  * connect()
  */
@@ -173,22 +433,75 @@ typedef struct _patty_client_close_response {
 int patty_client_close(patty_client *client,
                        int fd);
 
+/*
+ * Datagram addressing
+ *
+ * Each datagram sent with sendto() or received with recvfrom() carries its
+ * own peer address and digipeater path.  On SOCK_SEQPACKET sockets which
+ * have not been connected, every message on the data channel is a
+ * patty_client_dgram header followed by len bytes of payload, so datagrams
+ * never pass through the control connection at all; other sockets exchange
+ * datagrams over the control connection, one message per datagram.
+ */
+typedef struct _patty_client_path {
+    patty_ax25_addr repeaters[PATTY_AX25_MAX_HOPS];
+    unsigned int hops;
+} patty_client_path;
+
+typedef struct _patty_client_dgram {
+    /*
+     * Destination of a datagram sent, or source of a datagram received
+     */
+    patty_ax25_addr peer;
+
+    /*
+     * The digipeater path of a datagram received is given as heard; a
+     * datagram sent with no hops follows the route to its destination
+     */
+    patty_client_path path;
+
+    size_t len;
+} patty_client_dgram;
+
 /*
  * sendto()
  */
+typedef struct _patty_client_sendto_request {
+    int fd;
+    patty_client_dgram dgram;
+} patty_client_sendto_request;
+
+typedef struct _patty_client_sendto_response {
+    int ret;
+    int eno;
+} patty_client_sendto_response;
+
 ssize_t patty_client_sendto(patty_client *client,
                             int fd,
                             const void *buf,
                             size_t len,
-                            patty_ax25_addr *addr);
+                            patty_ax25_addr *addr,
+                            patty_client_path *path);
 
 /*
  * recvfrom()
+ *
+ * Only available as a tagged request; the response, sent once a datagram
+ * arrives, is a patty_client_dgram header followed by at most len bytes of
+ * payload.  On a socket whose data channel is a pty, datagrams arriving
+ * while no recvfrom() is outstanding are written to the pty without their
+ * addresses.
  */
-int patty_client_recvfrom(patty_client *client,
-                          int fd,
-                          void *buf,
-                          size_t len,
-                          patty_ax25_addr *addr);
+typedef struct _patty_client_recvfrom_request {
+    int fd;
+    size_t len;
+} patty_client_recvfrom_request;
+
+ssize_t patty_client_recvfrom(patty_client *client,
+                              int fd,
+                              void *buf,
+                              size_t len,
+                              patty_ax25_addr *addr,
+                              patty_client_path *path);
 
 #endif /* _PATTY_CLIENT_H */
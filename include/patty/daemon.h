@@ -16,10 +16,28 @@ int patty_daemon_set_sock_path(patty_daemon *daemon, const char *path);
 
 int patty_daemon_set_pidfile(patty_daemon *daemon, const char *path);
 
+int patty_daemon_set_limits(patty_daemon *daemon,
+                            const patty_ax25_server_limits *limits);
+
+int patty_daemon_set_dedup(patty_daemon *daemon, time_t digi, time_t ui);
+
 int patty_daemon_if_add(patty_daemon *daemon,
                         patty_ax25_if *iface,
                         const char *ifname);
 
+int patty_daemon_if_alias_add(patty_daemon *daemon,
+                              const char *ifname,
+                              const char *alias);
+
+int patty_daemon_digi_set(patty_daemon *daemon,
+                          const char *ifname,
+                          const char *outname,
+                          int wide);
+
+int patty_daemon_bridge_add(patty_daemon *daemon, const char *ifname);
+
+int patty_daemon_if_param_allow(patty_daemon *daemon, const char *ifname);
+
 int patty_daemon_route_add(patty_daemon *daemon,
                            const char *ifname,
                            const char *dest,
@@ -29,4 +47,9 @@ int patty_daemon_route_add(patty_daemon *daemon,
 int patty_daemon_route_add_default(patty_daemon *daemon,
                                    const char *ifname);
 
+int patty_daemon_route_nexthop_add(patty_daemon *daemon,
+                                   const char *dest,
+                                   const char *ifname,
+                                   unsigned int weight);
+
 #endif /* _PATTY_DAEMON_H */
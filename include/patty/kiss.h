@@ -1,6 +1,7 @@
 #ifndef _PATTY_KISS_H
 #define _PATTY_KISS_H
 
+#include <stdint.h>
 #include <sys/types.h>
 
 #define PATTY_KISS_FEND  0xc0
@@ -30,4 +31,14 @@ ssize_t patty_kiss_frame_send(int fd,
                               size_t len,
                               int port);
 
+ssize_t patty_kiss_command_send(int fd,
+                                enum patty_kiss_command command,
+                                uint8_t value,
+                                int port);
+
+ssize_t patty_kiss_hw_send(int fd,
+                           const void *buf,
+                           size_t len,
+                           int port);
+
 #endif /* _PATTY_KISS_H */
@@ -4,9 +4,17 @@
 #include <sys/types.h>
 #include <termios.h>
 
-#define PATTY_KISS_TNC_BUFSZ 4096
+#define PATTY_KISS_TNC_BUFSZ   4096
+#define PATTY_KISS_TNC_TXBUFSZ 65536
 #define PATTY_KISS_TNC_PORT     0
 
+/*
+ * Port on which a sender reports the number of frames it had to drop, as a
+ * PATTY_KISS_HW_SET frame carrying a 32-bit count in network byte order;
+ * receivers add the count to their own dropped frame statistics
+ */
+#define PATTY_KISS_TNC_PORT_DROPPED 0x0f
+
 typedef struct _patty_kiss_tnc patty_kiss_tnc;
 
 #define PATTY_KISS_TNC_DEVICE (1 << 0)
@@ -14,6 +22,21 @@ typedef struct _patty_kiss_tnc patty_kiss_tnc;
 #define PATTY_KISS_TNC_BAUD   (1 << 2)
 #define PATTY_KISS_TNC_FLOW   (1 << 3)
 
+#define PATTY_KISS_TNC_TXDELAY     (1 << 4)
+#define PATTY_KISS_TNC_PERSIST     (1 << 5)
+#define PATTY_KISS_TNC_SLOT_TIME   (1 << 6)
+#define PATTY_KISS_TNC_TX_TAIL     (1 << 7)
+#define PATTY_KISS_TNC_FULL_DUPLEX (1 << 8)
+#define PATTY_KISS_TNC_NONBLOCK    (1 << 9)
+#define PATTY_KISS_TNC_TCP         (1 << 10)
+
+/*
+ * Bounds, in milliseconds, of the delay between attempts to reconnect to a
+ * TNC reached over TCP; the delay doubles with each failed attempt
+ */
+#define PATTY_KISS_TNC_BACKOFF_MIN  1000
+#define PATTY_KISS_TNC_BACKOFF_MAX 60000
+
 enum patty_kiss_tnc_flow {
     PATTY_KISS_TNC_FLOW_NONE,
     PATTY_KISS_TNC_FLOW_CRTSCTS,
@@ -27,6 +50,23 @@ typedef struct _patty_kiss_tnc_info {
     int fd;
     speed_t baud;
     enum patty_kiss_tnc_flow flow;
+
+    /*
+     * Address of a TNC reached over TCP, with PATTY_KISS_TNC_TCP; both are
+     * copied, and used anew whenever the connection is reset
+     */
+    const char *host,
+               *port;
+
+    /*
+     * Channel access parameters pushed to the TNC upon creation; values are
+     * in KISS units, ie. 10ms for times, and p * 256 - 1 for persistence
+     */
+    uint8_t txdelay,
+            persist,
+            slot_time,
+            tx_tail,
+            full_duplex;
 } patty_kiss_tnc_info;
 
 patty_ax25_if_driver *patty_kiss_tnc_driver();
@@ -41,6 +81,8 @@ int patty_kiss_tnc_reset(patty_kiss_tnc *tnc);
 
 void patty_kiss_tnc_destroy(patty_kiss_tnc *tnc);
 
+patty_ax25_if_stats *patty_kiss_tnc_stats(patty_kiss_tnc *tnc);
+
 ssize_t patty_kiss_tnc_fill(patty_kiss_tnc *tnc);
 
 ssize_t patty_kiss_tnc_drain(patty_kiss_tnc *tnc, void *buf, size_t len);
@@ -55,4 +97,14 @@ ssize_t patty_kiss_tnc_send(patty_kiss_tnc *tnc,
                             const void *buf,
                             size_t len);
 
+ssize_t patty_kiss_tnc_send_dropped(patty_kiss_tnc *tnc, uint32_t count);
+
+ssize_t patty_kiss_tnc_queued(patty_kiss_tnc *tnc);
+
+ssize_t patty_kiss_tnc_transmit(patty_kiss_tnc *tnc);
+
+int patty_kiss_tnc_param_set(patty_kiss_tnc *tnc,
+                             enum patty_ax25_if_param param,
+                             uint32_t value);
+
 #endif /* _PATTY_KISS_H */
@@ -40,6 +40,11 @@ void *patty_list_shift(patty_list *list);
 
 void *patty_list_splice(patty_list *list, off_t index);
 
+/*
+ * Remove every item holding value, returning the number of items removed
+ */
+size_t patty_list_remove(patty_list *list, void *value);
+
 void *patty_list_insert(patty_list *list, off_t index);
 
 void *patty_list_index(patty_list *list, off_t index);
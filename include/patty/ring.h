@@ -0,0 +1,23 @@
+#ifndef _PATTY_RING_H
+#define _PATTY_RING_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+/*
+ * A lock-free ring of variable length records, safe for use by exactly one
+ * producer thread and one consumer thread
+ */
+typedef struct _patty_ring patty_ring;
+
+patty_ring *patty_ring_new(size_t size);
+
+void patty_ring_destroy(patty_ring *ring);
+
+size_t patty_ring_used(patty_ring *ring);
+
+int patty_ring_push(patty_ring *ring, const void *buf, size_t len);
+
+ssize_t patty_ring_pop(patty_ring *ring, void *buf, size_t len);
+
+#endif /* _PATTY_RING_H */
@@ -5,4 +5,22 @@
 
 ssize_t patty_strlcpy(char *dest, const char *src, size_t n);
 
+#define PATTY_FDS_MAX 4
+
+ssize_t patty_send_fds(int sock,
+                       const void *buf,
+                       size_t len,
+                       const int *fds,
+                       size_t n_fds);
+
+ssize_t patty_recv_fds(int sock,
+                       void *buf,
+                       size_t len,
+                       int *fds,
+                       size_t n_fds);
+
+ssize_t patty_send_fd(int sock, const void *buf, size_t len, int fd);
+
+ssize_t patty_recv_fd(int sock, void *buf, size_t len, int *fd);
+
 #endif /* _PATTY_UTIL_H */
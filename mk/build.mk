@@ -0,0 +1,23 @@
+CFLAGS_DEBUG	=
+LDFLAGS_SO	= -shared -Wl,-soname=$(SONAME)
+
+STATIC		= lib$(LIBNAME).a
+
+SONAME_SHORT	= lib$(LIBNAME).so
+SONAME		= $(SONAME_SHORT).$(VERSION_MAJOR)
+SONAME_FULL	= $(SONAME_SHORT).$(VERSION)
+
+PREFIX		= /usr/local
+MANDIR		= $(PREFIX)/share/man
+CFLAGS_WARN	= -Wall
+CFLAGS_OPT	= -O2
+CFLAGS_GEN	= -fPIC
+CFLAGS		= $(CFLAGS_DEBUG) $(CFLAGS_WARN) $(CFLAGS_OPT) $(CFLAGS_GEN)
+
+AR		= $(CROSS)ar
+RANLIB		= $(CROSS)ranlib
+
+RM		= /bin/rm
+LN		= /bin/ln
+RMDIR		= /bin/rmdir
+INSTALL		= /usr/bin/install
@@ -4,12 +4,14 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <time.h>
 #include <netdb.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 
 #include <patty/ax25.h>
 #include <patty/ax25/aprs_is.h>
+#include <patty/timer.h>
 
 enum state {
     APRS_IS_HEADER,
@@ -43,8 +45,36 @@ struct _patty_ax25_aprs_is {
 
     ssize_t readlen,
             encoded;
+
+    /*
+     * Frames heard from or gated to APRS-IS recently, so that copies of a
+     * frame heard by way of several digipeaters, or echoed back on RF, are
+     * only gated once
+     */
+    patty_ax25_dedup *dupes;
+    struct timespec dupes_last;
 };
 
+/*
+ * Determine whether a frame was gated to or heard from APRS-IS within the
+ * window, remembering it if not
+ */
+static int aprs_is_seen(patty_ax25_aprs_is *aprs,
+                        const void *buf,
+                        size_t len) {
+    struct timespec now,
+                    elapsed;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &now) == 0) {
+        patty_timer_sub(&now, &aprs->dupes_last, &elapsed);
+        patty_ax25_dedup_tick(aprs->dupes, &elapsed);
+
+        memcpy(&aprs->dupes_last, &now, sizeof(aprs->dupes_last));
+    }
+
+    return patty_ax25_dedup_seen(aprs->dupes, buf, len) == 1;
+}
+
 static ssize_t aprs_is_vprintf(patty_ax25_aprs_is *aprs,
                                const char *fmt,
                                va_list args) {
@@ -143,6 +173,15 @@ patty_ax25_aprs_is *patty_ax25_aprs_is_new(patty_ax25_aprs_is_info *info) {
     aprs->bodysz   = PATTY_AX25_APRS_IS_PAYLOAD_MAX;
     aprs->state    = APRS_IS_HEADER;
 
+    if ((aprs->dupes = patty_ax25_dedup_new(PATTY_AX25_DEDUP_DEFAULT_SIZE,
+                                            PATTY_AX25_DEDUP_DEFAULT_WINDOW)) == NULL) {
+        goto error_dedup_new;
+    }
+
+    if (clock_gettime(CLOCK_MONOTONIC, &aprs->dupes_last) < 0) {
+        goto error_clock_gettime;
+    }
+
     if (aprs_is_connect(aprs, info) < 0) {
         goto error_connect;
     }
@@ -154,6 +193,10 @@ patty_ax25_aprs_is *patty_ax25_aprs_is_new(patty_ax25_aprs_is_info *info) {
 error_connect:
     close(aprs->fd);
 
+error_clock_gettime:
+    patty_ax25_dedup_destroy(aprs->dupes);
+
+error_dedup_new:
     free(aprs);
 
 error_malloc_aprs:
@@ -163,6 +206,8 @@ error_malloc_aprs:
 void patty_ax25_aprs_is_destroy(patty_ax25_aprs_is *aprs) {
     close(aprs->fd);
 
+    patty_ax25_dedup_destroy(aprs->dupes);
+
     free(aprs);
 }
 
@@ -287,6 +332,8 @@ ssize_t patty_ax25_aprs_is_drain(patty_ax25_aprs_is *aprs,
                         goto error;
                     }
 
+                    (void)aprs_is_seen(aprs, buf, aprs->encoded);
+
                     goto done;
                 } else {
                     if (aprs->offset_body == aprs->bodysz) {
@@ -311,6 +358,12 @@ drop:
 
     (void)patty_ax25_aprs_is_flush(aprs);
 
+    /*
+     * Skip the remainder of the offending line, preserving any input after
+     * it for subsequent calls
+     */
+    aprs->state = APRS_IS_COMMENT;
+
     return aprs->offset_i - offset_start;
 
 error:
@@ -325,7 +378,6 @@ ssize_t patty_ax25_aprs_is_flush(patty_ax25_aprs_is *aprs) {
     ssize_t ret = aprs->encoded;
 
     aprs->state       = APRS_IS_HEADER;
-    aprs->offset_i    = aprs->readlen;
     aprs->offset_call = 0;
     aprs->offset_body = 0;
     aprs->encoded     = 0;
@@ -371,6 +423,10 @@ ssize_t patty_ax25_aprs_is_send(patty_ax25_aprs_is *aprs,
         return 0;
     }
 
+    if (aprs_is_seen(aprs, buf, len)) {
+        return 0;
+    }
+
     if (patty_ax25_ntop(&frame.src, call, sizeof(call)) < 0) {
         goto error;
     }
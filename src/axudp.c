@@ -0,0 +1,756 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <patty/ax25.h>
+#include <patty/ax25/axudp.h>
+#include <patty/hash.h>
+
+#define FRAME_BUFSZ (PATTY_AX25_AXUDP_FRAME_MAX + PATTY_AX25_AXUDP_FCS_LEN)
+
+struct peer {
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+};
+
+struct station {
+    patty_ax25_addr addr;
+    struct peer *peer;
+    uint64_t learned; /* zero if configured rather than learned */
+};
+
+struct _patty_ax25_axudp {
+    patty_ax25_if_stats stats;
+    patty_ax25_axudp_info info;
+
+    /*
+     * Copies of the address bound, which is bound anew upon reset
+     */
+    char *host,
+         *port;
+
+    int fd;
+
+    struct peer peers[PATTY_AX25_AXUDP_PEERS_MAX],
+               *dflt;
+
+    size_t n_peers;
+
+    uint32_t hashes[PATTY_AX25_AXUDP_STATIONS]; /* zero if the slot is unused */
+    struct station stations[PATTY_AX25_AXUDP_STATIONS];
+    uint64_t learned;
+
+    struct mmsghdr rx_msgs[PATTY_AX25_AXUDP_BATCH];
+    struct iovec rx_iov[PATTY_AX25_AXUDP_BATCH];
+    struct sockaddr_storage rx_addrs[PATTY_AX25_AXUDP_BATCH];
+    uint8_t rx_bufs[PATTY_AX25_AXUDP_BATCH][FRAME_BUFSZ];
+
+    size_t rx_count,
+           rx_next;
+
+    ssize_t rx_pending;
+
+    struct mmsghdr tx_msgs[PATTY_AX25_AXUDP_BATCH];
+    struct iovec tx_iov[PATTY_AX25_AXUDP_BATCH];
+    uint8_t tx_bufs[PATTY_AX25_AXUDP_BATCH][FRAME_BUFSZ];
+
+    size_t tx_count,
+           tx_next,
+           tx_bytes;
+};
+
+/*
+ * The AX.25 FCS, being the CRC-16 of ITU-T X.25, computed four bits at a
+ * time
+ */
+static const uint16_t fcs_table[16] = {
+    0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+    0x8408, 0x9489, 0xa50a, 0xb58b, 0xc60c, 0xd68d, 0xe70e, 0xf78f
+};
+
+static uint16_t fcs(const uint8_t *buf, size_t len) {
+    uint16_t crc = 0xffff;
+    size_t i;
+
+    for (i=0; i<len; i++) {
+        crc = (crc >> 4) ^ fcs_table[(crc ^  buf[i])       & 0x0f];
+        crc = (crc >> 4) ^ fcs_table[(crc ^ (buf[i] >> 4)) & 0x0f];
+    }
+
+    return ~crc;
+}
+
+static uint32_t station_hash(const patty_ax25_addr *station) {
+    uint32_t hash;
+
+    patty_hash_init(&hash);
+    patty_ax25_addr_hash(&hash, station);
+    patty_hash_end(&hash);
+
+    /*
+     * Zero marks unused slots
+     */
+    return hash? hash: 1;
+}
+
+static inline int station_equal(const patty_ax25_addr *a,
+                                const patty_ax25_addr *b) {
+    return memcmp(a->callsign, b->callsign, sizeof(a->callsign)) == 0
+        && PATTY_AX25_ADDR_SSID_NUMBER(a->ssid)
+        == PATTY_AX25_ADDR_SSID_NUMBER(b->ssid);
+}
+
+static struct station *station_find(patty_ax25_axudp *axudp,
+                                    uint32_t hash,
+                                    const patty_ax25_addr *addr) {
+    size_t i;
+
+    for (i=0; i<PATTY_AX25_AXUDP_PROBES; i++) {
+        size_t slot = (hash + i) % PATTY_AX25_AXUDP_STATIONS;
+
+        if (axudp->hashes[slot] == hash
+         && station_equal(&axudp->stations[slot].addr, addr)) {
+            return &axudp->stations[slot];
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Record the peer by way of which a station is reached; stations configured
+ * are never displaced by those learned, and a station learned only displaces
+ * the one among its neighbours learned least recently
+ */
+static void station_set(patty_ax25_axudp *axudp,
+                        const patty_ax25_addr *addr,
+                        struct peer *peer,
+                        int learned) {
+    uint32_t hash = station_hash(addr);
+    struct station *station;
+    size_t i,
+           victim = PATTY_AX25_AXUDP_STATIONS;
+
+    if ((station = station_find(axudp, hash, addr)) != NULL) {
+        if (learned && station->learned == 0) {
+            return;
+        }
+
+        station->peer    = peer;
+        station->learned = learned? ++axudp->learned: 0;
+
+        return;
+    }
+
+    for (i=0; i<PATTY_AX25_AXUDP_PROBES; i++) {
+        size_t slot = (hash + i) % PATTY_AX25_AXUDP_STATIONS;
+
+        if (axudp->hashes[slot] == 0) {
+            victim = slot;
+
+            break;
+        }
+
+        if (axudp->stations[slot].learned == 0) {
+            continue;
+        }
+
+        if (victim == PATTY_AX25_AXUDP_STATIONS
+         || axudp->stations[slot].learned < axudp->stations[victim].learned) {
+            victim = slot;
+        }
+    }
+
+    if (victim == PATTY_AX25_AXUDP_STATIONS) {
+        return;
+    }
+
+    station = &axudp->stations[victim];
+
+    memcpy(&station->addr, addr, sizeof(station->addr));
+
+    station->peer    = peer;
+    station->learned = learned? ++axudp->learned: 0;
+
+    axudp->hashes[victim] = hash;
+}
+
+static struct peer *peer_find(patty_ax25_axudp *axudp,
+                              const struct sockaddr_storage *addr) {
+    size_t i;
+
+    for (i=0; i<axudp->n_peers; i++) {
+        struct peer *peer = &axudp->peers[i];
+
+        if (peer->addr.ss_family != addr->ss_family) {
+            continue;
+        }
+
+        if (addr->ss_family == AF_INET) {
+            const struct sockaddr_in *a = (struct sockaddr_in *)&peer->addr,
+                                     *b = (struct sockaddr_in *)addr;
+
+            if (a->sin_port == b->sin_port
+             && a->sin_addr.s_addr == b->sin_addr.s_addr) {
+                return peer;
+            }
+        } else if (addr->ss_family == AF_INET6) {
+            const struct sockaddr_in6 *a = (struct sockaddr_in6 *)&peer->addr,
+                                      *b = (struct sockaddr_in6 *)addr;
+
+            if (a->sin6_port == b->sin6_port
+             && memcmp(&a->sin6_addr, &b->sin6_addr, sizeof(a->sin6_addr)) == 0) {
+                return peer;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int axudp_bind(patty_ax25_axudp *axudp) {
+    struct addrinfo hints,
+                    *ai0,
+                    *ai;
+
+    memset(&hints, '\0', sizeof(hints));
+
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags    = AI_PASSIVE;
+
+    if (getaddrinfo(axudp->info.host,
+                    axudp->info.port? axudp->info.port:
+                                      PATTY_AX25_AXUDP_DEFAULT_PORT,
+                    &hints,
+                    &ai0) != 0) {
+        errno = EADDRNOTAVAIL;
+
+        goto error_getaddrinfo;
+    }
+
+    for (ai=ai0; ai; ai=ai->ai_next) {
+        if ((axudp->fd = socket(ai->ai_family,
+                                ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                                ai->ai_protocol)) < 0) {
+            continue;
+        }
+
+        if (bind(axudp->fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+            close(axudp->fd);
+
+            continue;
+        }
+
+        freeaddrinfo(ai0);
+
+        return axudp->fd;
+    }
+
+    freeaddrinfo(ai0);
+
+error_getaddrinfo:
+    axudp->fd = -1;
+
+    return -1;
+}
+
+/*
+ * Peers are resolved within the address family of the socket bound, such
+ * that IPv4 peers are reached by their mapped address from an IPv6 socket
+ */
+static int peer_resolve(patty_ax25_axudp *axudp,
+                        struct peer *peer,
+                        patty_ax25_axudp_peer_info *info) {
+    struct sockaddr_storage local;
+    socklen_t locallen = sizeof(local);
+
+    struct addrinfo hints,
+                    *ai;
+
+    if (getsockname(axudp->fd, (struct sockaddr *)&local, &locallen) < 0) {
+        goto error_getsockname;
+    }
+
+    memset(&hints, '\0', sizeof(hints));
+
+    hints.ai_family   = local.ss_family;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags    = local.ss_family == AF_INET6? AI_V4MAPPED: 0;
+
+    if (getaddrinfo(info->host,
+                    info->port? info->port: PATTY_AX25_AXUDP_DEFAULT_PORT,
+                    &hints,
+                    &ai) != 0) {
+        errno = EHOSTUNREACH;
+
+        goto error_getaddrinfo;
+    }
+
+    memcpy(&peer->addr, ai->ai_addr, ai->ai_addrlen);
+
+    peer->addrlen = ai->ai_addrlen;
+
+    freeaddrinfo(ai);
+
+    return 0;
+
+error_getaddrinfo:
+error_getsockname:
+    return -1;
+}
+
+static void batch_init(patty_ax25_axudp *axudp) {
+    size_t i;
+
+    for (i=0; i<PATTY_AX25_AXUDP_BATCH; i++) {
+        axudp->rx_iov[i].iov_base = axudp->rx_bufs[i];
+        axudp->rx_iov[i].iov_len  = FRAME_BUFSZ;
+
+        axudp->rx_msgs[i].msg_hdr.msg_iov    = &axudp->rx_iov[i];
+        axudp->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+        axudp->rx_msgs[i].msg_hdr.msg_name   = &axudp->rx_addrs[i];
+
+        axudp->tx_iov[i].iov_base = axudp->tx_bufs[i];
+
+        axudp->tx_msgs[i].msg_hdr.msg_iov    = &axudp->tx_iov[i];
+        axudp->tx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    axudp->rx_count   = 0;
+    axudp->rx_next    = 0;
+    axudp->rx_pending = 0;
+    axudp->tx_count   = 0;
+    axudp->tx_next    = 0;
+    axudp->tx_bytes   = 0;
+}
+
+patty_ax25_axudp *patty_ax25_axudp_new(patty_ax25_axudp_info *info) {
+    patty_ax25_axudp *axudp;
+    size_t i;
+
+    if (info->n_peers == 0 || info->n_peers > PATTY_AX25_AXUDP_PEERS_MAX) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    if ((axudp = malloc(sizeof(*axudp))) == NULL) {
+        goto error_malloc_axudp;
+    }
+
+    memset(axudp, '\0', sizeof(*axudp));
+
+    memcpy(&axudp->info, info, sizeof(axudp->info));
+
+    if (info->host && (axudp->host = strdup(info->host)) == NULL) {
+        goto error_strdup_host;
+    }
+
+    if (info->port && (axudp->port = strdup(info->port)) == NULL) {
+        goto error_strdup_port;
+    }
+
+    axudp->info.host = axudp->host;
+    axudp->info.port = axudp->port;
+
+    if (axudp_bind(axudp) < 0) {
+        goto error_bind;
+    }
+
+    for (i=0; i<info->n_peers; i++) {
+        struct peer *peer = &axudp->peers[i];
+
+        if (peer_resolve(axudp, peer, &info->peers[i]) < 0) {
+            goto error_peer;
+        }
+
+        if (info->peers[i].call) {
+            patty_ax25_addr addr;
+
+            if (patty_ax25_pton(info->peers[i].call, &addr) < 0) {
+                goto error_peer;
+            }
+
+            station_set(axudp, &addr, peer, 0);
+        } else {
+            axudp->dflt = peer;
+        }
+    }
+
+    axudp->n_peers = info->n_peers;
+
+    batch_init(axudp);
+
+    return axudp;
+
+error_peer:
+    close(axudp->fd);
+
+error_bind:
+    free(axudp->port);
+
+error_strdup_port:
+    free(axudp->host);
+
+error_strdup_host:
+    free(axudp);
+
+error_malloc_axudp:
+error_invalid:
+    return NULL;
+}
+
+void patty_ax25_axudp_destroy(patty_ax25_axudp *axudp) {
+    close(axudp->fd);
+
+    free(axudp->port);
+    free(axudp->host);
+    free(axudp);
+}
+
+patty_ax25_if_stats *patty_ax25_axudp_stats(patty_ax25_axudp *axudp) {
+    return &axudp->stats;
+}
+
+int patty_ax25_axudp_fd(patty_ax25_axudp *axudp) {
+    return axudp->fd;
+}
+
+int patty_ax25_axudp_ready(patty_ax25_axudp *axudp, fd_set *fds) {
+    return FD_ISSET(axudp->fd, fds);
+}
+
+int patty_ax25_axudp_reset(patty_ax25_axudp *axudp) {
+    close(axudp->fd);
+
+    axudp->stats.dropped += axudp->tx_count - axudp->tx_next;
+
+    batch_init(axudp);
+
+    return axudp_bind(axudp);
+}
+
+/*
+ * Receive as many datagrams as are waiting, up to a full batch, returning the
+ * number received
+ */
+ssize_t patty_ax25_axudp_fill(patty_ax25_axudp *axudp) {
+    int count;
+    size_t i;
+
+    if (axudp->rx_next < axudp->rx_count) {
+        return axudp->rx_count - axudp->rx_next;
+    }
+
+    for (i=0; i<PATTY_AX25_AXUDP_BATCH; i++) {
+        axudp->rx_msgs[i].msg_hdr.msg_namelen = sizeof(axudp->rx_addrs[i]);
+        axudp->rx_msgs[i].msg_hdr.msg_flags   = 0;
+    }
+
+    if ((count = recvmmsg(axudp->fd,
+                          axudp->rx_msgs,
+                          PATTY_AX25_AXUDP_BATCH,
+                          MSG_DONTWAIT,
+                          NULL)) < 0) {
+        goto error_recvmmsg;
+    }
+
+    axudp->rx_count = count;
+    axudp->rx_next  = 0;
+
+    return count;
+
+error_recvmmsg:
+    return -1;
+}
+
+/*
+ * Learn that the source of a frame, and each repeater which has repeated it,
+ * are reached by way of the peer it was received from
+ */
+static void learn(patty_ax25_axudp *axudp,
+                  const uint8_t *buf,
+                  size_t len,
+                  struct peer *peer) {
+    size_t offset = 2 * sizeof(patty_ax25_addr);
+
+    if (len < offset) {
+        return;
+    }
+
+    station_set(axudp,
+                (const patty_ax25_addr *)(buf + sizeof(patty_ax25_addr)),
+                peer,
+                1);
+
+    while (!PATTY_AX25_ADDR_OCTET_LAST(buf[offset - 1])
+        && len >= offset + sizeof(patty_ax25_addr)) {
+        const patty_ax25_addr *hop = (const patty_ax25_addr *)(buf + offset);
+
+        if (!PATTY_AX25_ADDR_SSID_REPEATED(hop->ssid)) {
+            break;
+        }
+
+        station_set(axudp, hop, peer, 1);
+
+        offset += sizeof(patty_ax25_addr);
+    }
+}
+
+ssize_t patty_ax25_axudp_drain(patty_ax25_axudp *axudp,
+                               void *buf,
+                               size_t len) {
+    while (axudp->rx_next < axudp->rx_count) {
+        size_t i = axudp->rx_next++;
+
+        struct mmsghdr *msg = &axudp->rx_msgs[i];
+        struct peer *peer;
+
+        uint8_t *frame = axudp->rx_bufs[i];
+        size_t framelen = msg->msg_len;
+
+        if (msg->msg_hdr.msg_flags & MSG_TRUNC) {
+            goto drop;
+        }
+
+        if ((peer = peer_find(axudp, &axudp->rx_addrs[i])) == NULL) {
+            goto drop;
+        }
+
+        if (axudp->info.flags & PATTY_AX25_AXUDP_CRC) {
+            uint16_t sum;
+
+            if (framelen <= PATTY_AX25_AXUDP_FCS_LEN) {
+                goto drop;
+            }
+
+            framelen -= PATTY_AX25_AXUDP_FCS_LEN;
+
+            sum = frame[framelen] | (frame[framelen + 1] << 8);
+
+            if (fcs(frame, framelen) != sum) {
+                goto drop;
+            }
+        }
+
+        if (framelen == 0 || framelen > len) {
+            goto drop;
+        }
+
+        memcpy(buf, frame, framelen);
+
+        learn(axudp, frame, framelen, peer);
+
+        axudp->rx_pending = framelen;
+
+        return msg->msg_len;
+
+drop:
+        axudp->stats.dropped++;
+    }
+
+    return 0;
+}
+
+int patty_ax25_axudp_pending(patty_ax25_axudp *axudp) {
+    return axudp->rx_pending > 0? 1: 0;
+}
+
+ssize_t patty_ax25_axudp_flush(patty_ax25_axudp *axudp) {
+    ssize_t ret = axudp->rx_pending;
+
+    axudp->rx_pending = 0;
+
+    return ret;
+}
+
+/*
+ * Send as much of the batch queued as the socket will take
+ */
+ssize_t patty_ax25_axudp_transmit(patty_ax25_axudp *axudp) {
+    ssize_t sent = 0;
+
+    while (axudp->tx_next < axudp->tx_count) {
+        int count;
+
+        if ((count = sendmmsg(axudp->fd,
+                              axudp->tx_msgs + axudp->tx_next,
+                              axudp->tx_count - axudp->tx_next,
+                              MSG_DONTWAIT)) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+                break;
+            }
+
+            /*
+             * The peer of the first datagram remaining is unreachable; drop
+             * the datagram, and carry on with the rest
+             */
+            count = 1;
+
+            axudp->stats.dropped++;
+        }
+
+        while (count--) {
+            size_t n = axudp->tx_iov[axudp->tx_next++].iov_len;
+
+            axudp->tx_bytes -= n;
+
+            sent += n;
+        }
+    }
+
+    if (axudp->tx_next == axudp->tx_count) {
+        axudp->tx_count = 0;
+        axudp->tx_next  = 0;
+    } else if (axudp->tx_next > 0) {
+        size_t i;
+
+        for (i=0; axudp->tx_next + i < axudp->tx_count; i++) {
+            size_t from = axudp->tx_next + i;
+
+            memcpy(axudp->tx_bufs[i],
+                   axudp->tx_bufs[from],
+                   axudp->tx_iov[from].iov_len);
+
+            axudp->tx_iov[i].iov_len = axudp->tx_iov[from].iov_len;
+
+            axudp->tx_msgs[i].msg_hdr.msg_name =
+                axudp->tx_msgs[from].msg_hdr.msg_name;
+
+            axudp->tx_msgs[i].msg_hdr.msg_namelen =
+                axudp->tx_msgs[from].msg_hdr.msg_namelen;
+        }
+
+        axudp->tx_count -= axudp->tx_next;
+        axudp->tx_next   = 0;
+    }
+
+    return sent;
+}
+
+static int tx_enqueue(patty_ax25_axudp *axudp,
+                      struct peer *peer,
+                      const void *buf,
+                      size_t len) {
+    size_t i,
+           n = len;
+
+    if (axudp->tx_count == PATTY_AX25_AXUDP_BATCH) {
+        (void)patty_ax25_axudp_transmit(axudp);
+
+        if (axudp->tx_count == PATTY_AX25_AXUDP_BATCH) {
+            axudp->stats.dropped++;
+
+            return 0;
+        }
+    }
+
+    i = axudp->tx_count++;
+
+    memcpy(axudp->tx_bufs[i], buf, len);
+
+    if (axudp->info.flags & PATTY_AX25_AXUDP_CRC) {
+        uint16_t sum = fcs(buf, len);
+
+        axudp->tx_bufs[i][n++] =  sum       & 0xff;
+        axudp->tx_bufs[i][n++] = (sum >> 8) & 0xff;
+    }
+
+    axudp->tx_iov[i].iov_len              = n;
+    axudp->tx_msgs[i].msg_hdr.msg_name    = &peer->addr;
+    axudp->tx_msgs[i].msg_hdr.msg_namelen = peer->addrlen;
+
+    axudp->tx_bytes += n;
+
+    return 0;
+}
+
+/*
+ * The next station a frame is to be heard by: the first repeater yet to
+ * repeat it, or otherwise its destination
+ */
+static const patty_ax25_addr *next_hop(const uint8_t *buf, size_t len) {
+    size_t offset = 2 * sizeof(patty_ax25_addr);
+
+    while (!PATTY_AX25_ADDR_OCTET_LAST(buf[offset - 1])
+        && len >= offset + sizeof(patty_ax25_addr)) {
+        const patty_ax25_addr *hop = (const patty_ax25_addr *)(buf + offset);
+
+        if (!PATTY_AX25_ADDR_SSID_REPEATED(hop->ssid)) {
+            return hop;
+        }
+
+        offset += sizeof(patty_ax25_addr);
+    }
+
+    return (const patty_ax25_addr *)buf;
+}
+
+ssize_t patty_ax25_axudp_send(patty_ax25_axudp *axudp,
+                              const void *buf,
+                              size_t len) {
+    const patty_ax25_addr *hop;
+    struct station *station;
+
+    if (len < 2 * sizeof(patty_ax25_addr)) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    if (len > PATTY_AX25_AXUDP_FRAME_MAX) {
+        errno = EMSGSIZE;
+
+        goto error_invalid;
+    }
+
+    hop = next_hop(buf, len);
+
+    if ((station = station_find(axudp, station_hash(hop), hop)) != NULL) {
+        (void)tx_enqueue(axudp, station->peer, buf, len);
+    } else if (axudp->dflt) {
+        (void)tx_enqueue(axudp, axudp->dflt, buf, len);
+    } else {
+        size_t i;
+
+        for (i=0; i<axudp->n_peers; i++) {
+            (void)tx_enqueue(axudp, &axudp->peers[i], buf, len);
+        }
+    }
+
+    return len;
+
+error_invalid:
+    return -1;
+}
+
+ssize_t patty_ax25_axudp_queued(patty_ax25_axudp *axudp) {
+    return axudp->tx_bytes;
+}
+
+patty_ax25_if_driver *patty_ax25_axudp_driver() {
+    static patty_ax25_if_driver driver = {
+        .create   = (patty_ax25_if_driver_create *)patty_ax25_axudp_new,
+        .destroy  = (patty_ax25_if_driver_destroy *)patty_ax25_axudp_destroy,
+        .stats    = (patty_ax25_if_driver_stats *)patty_ax25_axudp_stats,
+        .fd       = (patty_ax25_if_driver_fd *)patty_ax25_axudp_fd,
+        .ready    = (patty_ax25_if_driver_ready *)patty_ax25_axudp_ready,
+        .reset    = (patty_ax25_if_driver_reset *)patty_ax25_axudp_reset,
+        .fill     = (patty_ax25_if_driver_fill *)patty_ax25_axudp_fill,
+        .drain    = (patty_ax25_if_driver_drain *)patty_ax25_axudp_drain,
+        .pending  = (patty_ax25_if_driver_pending *)patty_ax25_axudp_pending,
+        .flush    = (patty_ax25_if_driver_flush *)patty_ax25_axudp_flush,
+        .send     = (patty_ax25_if_driver_send *)patty_ax25_axudp_send,
+        .queued   = (patty_ax25_if_driver_queued *)patty_ax25_axudp_queued,
+        .transmit = (patty_ax25_if_driver_transmit *)patty_ax25_axudp_transmit
+    };
+
+    return &driver;
+}
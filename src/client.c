@@ -4,7 +4,9 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <termios.h>
+#include <poll.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 #include <sys/un.h>
 
@@ -14,14 +16,86 @@
 
 struct _patty_client_sock {
     int fd;
+    enum patty_ax25_sock_chan chan;
     char path[PATTY_AX25_SOCK_PATH_SIZE];
 };
 
+/*
+ * A tagged request awaiting its response from the daemon
+ */
+struct request {
+    uint32_t id;
+    enum patty_client_call call;
+
+    /*
+     * Socket being created by socket() or accept()
+     */
+    patty_client_sock *sock;
+
+    /*
+     * Where to store the body of the response, and any file descriptors
+     * passed along with it
+     */
+    void *buf;
+    size_t len;
+    int fds[2];
+
+    patty_client_callback callback;
+    void *ctx;
+
+    int done;
+    patty_client_result result;
+};
+
 struct _patty_client {
     int fd;
-    patty_dict *socks;
+    patty_dict *socks,
+               *requests;
+
+    uint32_t next_id;
+
+    /*
+     * Framed requests held back until the end of a batch
+     */
+    uint8_t *batch;
+    size_t batch_len;
+    int batching;
+
+    /*
+     * Stands in for the socket most recently requested, which the daemon
+     * resolves PATTY_CLIENT_FD_LAST to
+     */
+    patty_client_sock last;
 };
 
+static int open_pty(const char *path) {
+    int fd;
+    struct termios t;
+
+    if ((fd = open(path, O_RDWR)) < 0) {
+        goto error_open;
+    }
+
+    if (tcgetattr(fd, &t) < 0) {
+        goto error_tcgetattr;
+    }
+
+    cfmakeraw(&t);
+
+    if (tcsetattr(fd, TCSANOW, &t) < 0) {
+        goto error_tcsetattr;
+    }
+
+    return fd;
+
+error_tcsetattr:
+error_tcgetattr:
+    (void)close(fd);
+
+error_open:
+    return -1;
+}
+
 static const char *find_sock(const char *path) {
     struct stat st;
 
@@ -43,6 +117,18 @@ patty_client *patty_client_new(const char *path) {
         goto error_dict_new;
     }
 
+    if ((client->requests = patty_dict_new()) == NULL) {
+        goto error_dict_new_requests;
+    }
+
+    client->next_id   = 0;
+    client->batch     = NULL;
+    client->batch_len = 0;
+    client->batching  = 0;
+
+    client->last.fd   = PATTY_CLIENT_FD_LAST;
+    client->last.chan = PATTY_AX25_SOCK_CHAN_PTY;
+
     if ((client->fd = socket(PF_UNIX, SOCK_STREAM, 0)) < 0) {
         goto error_socket;
     }
@@ -62,6 +148,9 @@ error_connect:
     close(client->fd);
 
 error_socket:
+    patty_dict_destroy(client->requests);
+
+error_dict_new_requests:
     patty_dict_destroy(client->socks);
 
 error_dict_new:
@@ -79,402 +168,712 @@ ssize_t patty_client_write(patty_client *client, const void *buf, size_t len) {
     return write(client->fd, buf, len);
 }
 
-static int request_close(patty_client *client,
-                         int fd) {
-    enum patty_client_call call = PATTY_CLIENT_CLOSE;
+int patty_client_fd(patty_client *client) {
+    return client->fd;
+}
 
-    patty_client_close_request request = { fd };
-    patty_client_close_response response;
+static int count_request(uint32_t key, void *value, void *ctx) {
+    size_t *count = ctx;
 
-    size_t len;
+    (*count)++;
 
-    if (write(client->fd, &call, sizeof(call)) < 0) {
-        goto error_io;
-    }
+    return 0;
+}
 
-    if (write(client->fd, &request, sizeof(request)) < 0) {
-        goto error_io;
-    }
+size_t patty_client_pending(patty_client *client) {
+    size_t count = 0;
 
-    if ((len = read(client->fd, &response, sizeof(response))) < 0) {
-        goto error_io;
-    } else if (len != sizeof(response)) {
-        errno = EIO;
+    (void)patty_dict_each(client->requests, count_request, &count);
 
-        goto error_io;
-    }
+    return count;
+}
 
-    errno = response.eno;
+static ssize_t read_full(int fd, void *buf, size_t len) {
+    size_t offset = 0;
 
-    return response.ret;
+    while (offset < len) {
+        ssize_t readlen;
 
-error_io:
+        if ((readlen = read(fd, (uint8_t *)buf + offset, len - offset)) < 0) {
+            goto error_read;
+        } else if (readlen == 0) {
+            errno = EIO;
+
+            goto error_read;
+        }
+
+        offset += readlen;
+    }
+
+    return offset;
+
+error_read:
     return -1;
 }
 
-static int destroy_sock(uint32_t key, void *value, void *ctx) {
-    patty_client *client    = ctx;
-    patty_client_sock *sock = value;
+static struct request *request_new(patty_client *client,
+                                   enum patty_client_call call,
+                                   patty_client_callback callback,
+                                   void *ctx) {
+    struct request *request;
 
-    (void)request_close(client, sock->fd);
+    if ((request = malloc(sizeof(*request))) == NULL) {
+        goto error_malloc_request;
+    }
 
-    free(sock);
+    memset(request, '\0', sizeof(*request));
 
-    return 0;
-}
+    request->id       = client->next_id++ & PATTY_CLIENT_ID_MASK;
+    request->call     = call;
+    request->fds[0]   = -1;
+    request->fds[1]   = -1;
+    request->callback = callback;
+    request->ctx      = ctx;
 
-void patty_client_destroy(patty_client *client) {
-    close(client->fd);
+    request->result.id   = request->id;
+    request->result.call = call;
 
-    (void)patty_dict_each(client->socks, destroy_sock, client);
-    patty_dict_destroy(client->socks);
+    return request;
 
-    free(client);
+error_malloc_request:
+    return NULL;
 }
 
-int patty_client_ping(patty_client *client) {
-    int call = PATTY_CLIENT_PING,
-        pong;
+static void request_destroy(struct request *request) {
+    if (request->fds[0] >= 0) (void)close(request->fds[0]);
+    if (request->fds[1] >= 0) (void)close(request->fds[1]);
 
-    ssize_t len;
+    free(request->sock);
+    free(request);
+}
 
-    if ((len = write(client->fd, &call, sizeof(call))) < 0 || len == 0) {
-        goto done;
-    }
+static int batch_flush(patty_client *client) {
+    size_t offset = 0;
 
-    if ((len = read(client->fd, &pong, sizeof(pong))) < 0 || len == 0) {
-        goto done;
+    while (offset < client->batch_len) {
+        ssize_t wrlen;
+
+        if ((wrlen = write(client->fd,
+                           client->batch + offset,
+                           client->batch_len - offset)) < 0) {
+            goto error_write;
+        }
+
+        offset += wrlen;
     }
 
-    return pong;
+    client->batch_len = 0;
 
-done:
-    if (errno == EIO) {
-        errno = 0;
+    return 0;
 
-        return 0;
-    }
+error_write:
+    client->batch_len = 0;
 
     return -1;
 }
 
-int patty_client_socket(patty_client *client,
-                        int proto,
-                        int type) {
-    enum patty_client_call call = PATTY_CLIENT_SOCKET;
-
-    patty_client_socket_request request = {
-        proto, type
+/*
+ * Send a framed message, consisting of a header followed by the request
+ * structure and any payload, in a single write; or, while batching, append
+ * it to the batch
+ */
+static int message_send(patty_client *client,
+                        enum patty_client_call call,
+                        uint32_t id,
+                        const void *data,
+                        size_t len,
+                        const void *payload,
+                        size_t payload_len) {
+    patty_client_message header = {
+        .magic   = PATTY_CLIENT_MAGIC,
+        .version = PATTY_CLIENT_VERSION,
+        .call    = call,
+        .id      = id,
+        .len     = len + payload_len
     };
 
-    patty_client_socket_response response;
-    patty_client_sock *sock;
+    struct iovec iov[3] = {
+        { .iov_base = &header,         .iov_len = sizeof(header) },
+        { .iov_base = (void *)data,    .iov_len = len            },
+        { .iov_base = (void *)payload, .iov_len = payload_len    }
+    };
 
-    int fd;
-    struct termios t;
+    size_t total = sizeof(header) + len + payload_len;
 
-    if ((sock = malloc(sizeof(*sock))) == NULL) {
-        goto error_malloc_sock;
-    }
+    if (total > PATTY_CLIENT_BATCH_MAX) {
+        errno = EMSGSIZE;
 
-    if (write(client->fd, &call, sizeof(call)) < 0) {
-        goto error_io;
+        goto error_toobig;
     }
 
-    if (write(client->fd, &request, sizeof(request)) < 0) {
-        goto error_io;
+    if (!client->batching) {
+        return writev(client->fd, iov, 3) < 0? -1: 0;
     }
 
-    if (read(client->fd, &response, sizeof(response)) < 0) {
-        goto error_io;
+    if (client->batch_len + total > PATTY_CLIENT_BATCH_MAX) {
+        if (batch_flush(client) < 0) {
+            goto error_batch_flush;
+        }
     }
 
-    sock->fd = response.fd;
-
-    patty_strlcpy(sock->path, response.path, sizeof(sock->path));
+    memcpy(client->batch + client->batch_len, &header, sizeof(header));
 
-    if ((fd = open(sock->path, O_RDWR)) < 0) {
-        goto error_open;
+    if (len) {
+        memcpy(client->batch + client->batch_len + sizeof(header), data, len);
     }
 
-    if (tcgetattr(fd, &t) < 0) {
-        goto error_tcgetattr;
+    if (payload_len) {
+        memcpy(client->batch + client->batch_len + sizeof(header) + len,
+               payload,
+               payload_len);
     }
 
-    cfmakeraw(&t);
+    client->batch_len += total;
 
-    if (tcsetattr(fd, TCSANOW, &t) < 0) {
-        goto error_tcsetattr;
-    }
+    return 0;
+
+error_batch_flush:
+error_toobig:
+    return -1;
+}
 
-    if (patty_dict_set(client->socks,
-                       (uint32_t)fd,
-                       sock) == NULL) {
+static int request_send(patty_client *client,
+                        struct request *request,
+                        const void *data,
+                        size_t len,
+                        const void *payload,
+                        size_t payload_len) {
+    if (patty_dict_set(client->requests, request->id, request) == NULL) {
         goto error_dict_set;
     }
 
-    errno = response.eno;
-
-    return fd;
-
-error_dict_set:
-error_tcsetattr:
-error_tcgetattr:
-    (void)close(fd);
+    if (message_send(client,
+                     request->call,
+                     request->id,
+                     data,
+                     len,
+                     payload,
+                     payload_len) < 0) {
+        goto error_message_send;
+    }
 
-error_open:
-    (void)request_close(client, sock->fd);
+    return 0;
 
-error_io:
-    free(sock);
+error_message_send:
+    (void)patty_dict_delete(client->requests, request->id);
 
-error_malloc_sock:
+error_dict_set:
     return -1;
 }
 
-int patty_client_setsockopt(patty_client *client,
-                            int fd,
-                            int opt,
-                            void *data,
-                            size_t len) {
-    enum patty_client_call call = PATTY_CLIENT_SETSOCKOPT;
-
-    patty_client_setsockopt_request request = {
-        .opt = opt,
-        .len = len
-    };
-
-    patty_client_setsockopt_response response;
+int patty_client_batch_begin(patty_client *client) {
+    if (client->batch == NULL) {
+        if ((client->batch = malloc(PATTY_CLIENT_BATCH_MAX)) == NULL) {
+            goto error_malloc_batch;
+        }
+    }
 
-    patty_client_sock *sock;
+    client->batching = 1;
 
-    if ((sock = patty_dict_get(client->socks, (uint32_t)fd)) == NULL) {
-        errno = EBADF;
+    return 0;
 
-        goto error_dict_get;
-    }
+error_malloc_batch:
+    return -1;
+}
 
-    request.fd = sock->fd;
+int patty_client_batch_end(patty_client *client) {
+    client->batching = 0;
 
-    if (write(client->fd, &call, sizeof(call)) < 0) {
-        goto error_io;
-    }
+    return batch_flush(client);
+}
 
-    if (write(client->fd, &request, sizeof(request)) < 0) {
-        goto error_io;
-    }
+/*
+ * Find the socket given by a local fd, or the placeholder for the socket
+ * most recently requested
+ */
+static patty_client_sock *sock_get(patty_client *client, int fd) {
+    patty_client_sock *sock;
 
-    if (write(client->fd, data, len) < 0) {
-        goto error_io;
+    if (fd == PATTY_CLIENT_FD_LAST) {
+        return &client->last;
     }
 
-    if (read(client->fd, &response, sizeof(response)) < 0) {
-        goto error_io;
+    if ((sock = patty_dict_get(client->socks, (uint32_t)fd)) == NULL) {
+        errno = EBADF;
     }
 
-    errno = response.eno;
-
-    return response.ret;
-
-error_io:
-error_dict_get:
-    return -1;
+    return sock;
 }
 
-int patty_client_bind(patty_client *client,
-                      int fd,
-                      patty_ax25_addr *addr) {
-    enum patty_client_call call = PATTY_CLIENT_BIND;
-
-    patty_client_bind_request request;
-    patty_client_bind_response response;
-
-    patty_client_sock *sock;
+/*
+ * Take ownership of a socket created by socket() or accept(), returning the
+ * local end of its data channel
+ */
+static int sock_open(patty_client *client,
+                     struct request *request,
+                     int remote_fd,
+                     const char *path) {
+    patty_client_sock *sock = request->sock;
 
-    if ((sock = patty_dict_get(client->socks, (uint32_t)fd)) == NULL) {
-        errno = EBADF;
+    int fd;
 
-        goto error_dict_get;
-    }
+    sock->fd = remote_fd;
 
-    memset(&request, '\0', sizeof(request));
+    patty_strlcpy(sock->path, path, sizeof(sock->path));
 
-    request.fd = sock->fd;
+    if (sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET) {
+        if ((fd = request->fds[0]) < 0) {
+            errno = EIO;
 
-    memcpy(&request.addr, addr, sizeof(*addr));
+            goto error_open;
+        }
 
-    if (write(client->fd, &call, sizeof(call)) < 0) {
-        goto error_io;
+        request->fds[0] = -1;
+    } else if ((fd = open_pty(sock->path)) < 0) {
+        goto error_open;
     }
 
-    if (write(client->fd, &request, sizeof(request)) < 0) {
-        goto error_io;
+    if (patty_dict_set(client->socks, (uint32_t)fd, sock) == NULL) {
+        goto error_dict_set;
     }
 
-    if (read(client->fd, &response, sizeof(response)) < 0) {
-        goto error_io;
-    }
+    request->sock = NULL;
 
-    errno = response.eno;
+    return fd;
 
-    return response.ret;
+error_dict_set:
+    (void)close(fd);
 
-error_io:
-error_dict_get:
+error_open:
     return -1;
 }
 
-int patty_client_listen(patty_client *client,
-                        int fd) {
-    enum patty_client_call call = PATTY_CLIENT_LISTEN;
+/*
+ * Ask the daemon to close a socket, without waiting for a response; the
+ * request identifier is never registered, so the response is skipped over
+ */
+static void sock_discard(patty_client *client, int fd) {
+    uint32_t id = client->next_id++ & PATTY_CLIENT_ID_MASK;
 
-    patty_client_listen_request request;
-    patty_client_listen_response response;
+    patty_client_close_request request = { fd };
 
-    patty_client_sock *sock;
+    (void)message_send(client,
+                       PATTY_CLIENT_CLOSE,
+                       id,
+                       &request,
+                       sizeof(request),
+                       NULL,
+                       0);
+}
 
-    if ((sock = patty_dict_get(client->socks, (uint32_t)fd)) == NULL) {
-        errno = EBADF;
+static void request_complete(patty_client *client,
+                             struct request *request,
+                             patty_client_reply *reply,
+                             void *body) {
+    patty_client_result *result = &request->result;
 
-        goto error_dict_get;
-    }
+    result->ret = reply->ret;
+    result->eno = reply->eno;
 
-    request.fd = sock->fd;
+    switch (request->call) {
+        case PATTY_CLIENT_SOCKET: {
+            patty_client_socket_response *response = body;
 
-    if (write(client->fd, &call, sizeof(call)) < 0) {
-        goto error_io;
-    }
+            if (reply->ret < 0) {
+                break;
+            }
 
-    if (write(client->fd, &request, sizeof(request)) < 0) {
-        goto error_io;
-    }
+            if ((result->ret = sock_open(client,
+                                         request,
+                                         response->fd,
+                                         response->path)) < 0) {
+                result->eno = errno;
 
-    if (read(client->fd, &response, sizeof(response)) < 0) {
-        goto error_io;
-    }
+                sock_discard(client, response->fd);
+            }
 
-    errno = response.eno;
+            break;
+        }
 
-    return response.ret;
+        case PATTY_CLIENT_ACCEPT: {
+            patty_client_accept_message *message = body;
 
-error_io:
-error_dict_get:
-    return -1;
-}
+            if (reply->ret < 0) {
+                break;
+            }
 
-int patty_client_accept(patty_client *client,
-                        int fd,
-                        patty_ax25_addr *peer) {
-    enum patty_client_call call = PATTY_CLIENT_ACCEPT;
+            memcpy(&result->peer, &message->peer, sizeof(result->peer));
 
-    patty_client_accept_request request;
-    patty_client_accept_response response;
-    patty_client_accept_message message;
+            if ((result->ret = sock_open(client,
+                                         request,
+                                         message->fd,
+                                         message->path)) < 0) {
+                result->eno = errno;
 
-    patty_client_sock *local,
-                      *remote;
+                sock_discard(client, message->fd);
+            }
 
-    int pty;
-    struct termios t;
+            break;
+        }
 
-    if ((local = patty_dict_get(client->socks, (uint32_t)fd)) == NULL) {
-        errno = EBADF;
+        default:
+            if (request->buf) {
+                memcpy(request->buf,
+                       body,
+                       reply->len < request->len? reply->len: request->len);
+            }
 
-        goto error_dict_get;
+            break;
     }
 
-    if ((remote = malloc(sizeof(*remote))) == NULL) {
-        goto error_malloc_remote;
-    }
+    request->done = 1;
+}
+
+/*
+ * Read and handle exactly one response from the daemon, blocking until one
+ * is available
+ */
+static int reply_handle(patty_client *client) {
+    patty_client_reply reply;
+    uint8_t body[PATTY_CLIENT_REPLY_MAX];
 
-    request.fd = local->fd;
+    struct request *request;
 
-    memset(&response, '\0', sizeof(response));
+    int fds[2];
+    ssize_t readlen;
 
-    if (write(client->fd, &call, sizeof(call)) < 0) {
+    if ((readlen = patty_recv_fds(client->fd,
+                                  &reply,
+                                  sizeof(reply),
+                                  fds,
+                                  2)) < 0) {
         goto error_io;
-    }
+    } else if (readlen == 0) {
+        errno = EIO;
 
-    if (write(client->fd, &request, sizeof(request)) < 0) {
         goto error_io;
     }
 
-    /*
-     * First, the server will tell us if the fd specified in accept() is indeed
-     * accepting connections.
-     */
-    if (read(client->fd, &response, sizeof(response)) < 0) {
-        goto error_io;
+    if ((size_t)readlen < sizeof(reply)) {
+        if (read_full(client->fd,
+                      (uint8_t *)&reply + readlen,
+                      sizeof(reply) - readlen) < 0) {
+            goto error_read;
+        }
     }
 
-    if (response.ret < 0) {
-        errno = response.eno;
+    if (reply.len > sizeof(body)) {
+        errno = EPROTO;
 
-        return response.ret;
+        goto error_read;
     }
 
-    /*
-     * Next, we will wait for the server to receive a SABM or SABME frame, and
-     * notify us via the listening socket that a connection has been accepted.
-     */
-    if (read(fd, &message, sizeof(message)) < 0) {
-        goto error_io;
+    memset(body, '\0', sizeof(body));
+
+    if (read_full(client->fd, body, reply.len) < 0) {
+        goto error_read;
     }
 
-    remote->fd = message.fd;
+    if ((request = patty_dict_get(client->requests, reply.id)) == NULL) {
+        goto discard;
+    }
 
-    memcpy(peer, &message.peer, sizeof(*peer));
-    patty_strlcpy(remote->path, message.path, sizeof(remote->path));
+    (void)patty_dict_delete(client->requests, reply.id);
 
-    if ((pty = open(remote->path, O_RDWR)) < 0) {
-        goto error_open;
-    }
+    request->fds[0] = fds[0];
+    request->fds[1] = fds[1];
 
-    if (tcgetattr(pty, &t) < 0) {
-        goto error_tcgetattr;
-    }
+    request_complete(client, request, &reply, body);
 
-    cfmakeraw(&t);
+    if (request->callback) {
+        request->callback(client, &request->result, request->ctx);
 
-    if (tcsetattr(pty, TCSANOW, &t) < 0) {
-        goto error_tcsetattr;
+        request_destroy(request);
     }
 
-    if (patty_dict_set(client->socks,
-                       (uint32_t)pty,
-                       remote) == NULL) {
-        goto error_dict_set;
-    }
+    return 0;
 
-    errno = response.eno;
+discard:
+    if (fds[0] >= 0) (void)close(fds[0]);
+    if (fds[1] >= 0) (void)close(fds[1]);
 
-    return pty;
+    return 0;
 
-error_tcsetattr:
-error_tcgetattr:
-error_dict_set:
-    (void)close(pty);
-
-error_open:
-    (void)request_close(client, remote->fd);
+error_read:
+    if (fds[0] >= 0) (void)close(fds[0]);
+    if (fds[1] >= 0) (void)close(fds[1]);
 
 error_io:
-    free(remote);
+    return -1;
+}
 
-error_malloc_remote:
-error_dict_get:
+int patty_client_dispatch(patty_client *client) {
+    struct pollfd pfd = {
+        .fd     = client->fd,
+        .events = POLLIN
+    };
+
+    int count = 0;
+
+    while (1) {
+        int ready;
+
+        if ((ready = poll(&pfd, 1, 0)) < 0) {
+            goto error_poll;
+        } else if (ready == 0) {
+            break;
+        }
+
+        if (reply_handle(client) < 0) {
+            goto error_reply_handle;
+        }
+
+        count++;
+    }
+
+    return count;
+
+error_reply_handle:
+error_poll:
     return -1;
 }
 
-int patty_client_connect(patty_client *client,
+/*
+ * Wait for the response to a request issued synchronously, handling any
+ * responses to asynchronous requests which arrive in the meantime
+ */
+static int request_wait(patty_client *client, struct request *request) {
+    if (batch_flush(client) < 0) {
+        goto error_reply_handle;
+    }
+
+    while (!request->done) {
+        if (reply_handle(client) < 0) {
+            goto error_reply_handle;
+        }
+    }
+
+    errno = request->result.eno;
+
+    return request->result.ret;
+
+error_reply_handle:
+    (void)patty_dict_delete(client->requests, request->id);
+
+    return -1;
+}
+
+static int request_finish(patty_client *client, struct request *request) {
+    int ret = request_wait(client, request),
+        eno = errno;
+
+    request_destroy(request);
+
+    errno = eno;
+
+    return ret;
+}
+
+static int request_issue(patty_client *client,
+                         struct request *request,
+                         const void *data,
+                         size_t len,
+                         const void *payload,
+                         size_t payload_len) {
+    if (request_send(client, request, data, len, payload, payload_len) < 0) {
+        goto error_request_send;
+    }
+
+    if (request->callback) {
+        return request->id;
+    }
+
+    return request_finish(client, request);
+
+error_request_send:
+    request_destroy(request);
+
+    return -1;
+}
+
+static int request_close(patty_client *client,
                          int fd,
-                         patty_ax25_addr *peer) {
-    enum patty_client_call call = PATTY_CLIENT_CONNECT;
+                         patty_client_callback callback,
+                         void *ctx) {
+    patty_client_close_request request = { fd };
+    struct request *req;
 
-    patty_client_connect_request request;
-    patty_client_connect_response response;
+    if ((req = request_new(client, PATTY_CLIENT_CLOSE, callback, ctx)) == NULL) {
+        return -1;
+    }
+
+    return request_issue(client, req, &request, sizeof(request), NULL, 0);
+}
+
+static int destroy_sock(uint32_t key, void *value, void *ctx) {
+    patty_client *client    = ctx;
+    patty_client_sock *sock = value;
+
+    (void)request_close(client, sock->fd, NULL, NULL);
+
+    free(sock);
+
+    return 0;
+}
+
+static int destroy_request(uint32_t key, void *value, void *ctx) {
+    request_destroy(value);
+
+    return 0;
+}
+
+void patty_client_destroy(patty_client *client) {
+    client->batching = 0;
+
+    close(client->fd);
+
+    (void)patty_dict_each(client->socks, destroy_sock, client);
+    patty_dict_destroy(client->socks);
+
+    (void)patty_dict_each(client->requests, destroy_request, NULL);
+    patty_dict_destroy(client->requests);
+
+    free(client->batch);
+    free(client);
+}
+
+int patty_client_ping(patty_client *client) {
+    struct request *request;
+    int pong;
+
+    if ((request = request_new(client, PATTY_CLIENT_PING, NULL, NULL)) == NULL) {
+        goto error_request_new;
+    }
+
+    request->buf = &pong;
+    request->len = sizeof(pong);
+
+    if (request_send(client, request, NULL, 0, NULL, 0) < 0) {
+        goto error_request_send;
+    }
+
+    if (request_finish(client, request) < 0) {
+        goto done;
+    }
+
+    return pong;
+
+error_request_send:
+    request_destroy(request);
+
+done:
+    if (errno == EIO) {
+        errno = 0;
+
+        return 0;
+    }
+
+error_request_new:
+    return -1;
+}
+
+int patty_client_socket_async(patty_client *client,
+                              int proto,
+                              int type,
+                              patty_client_callback callback,
+                              void *ctx) {
+    patty_client_socket_request request = {
+        proto, type
+    };
+
+    struct request *req;
+
+    if ((req = request_new(client, PATTY_CLIENT_SOCKET, callback, ctx)) == NULL) {
+        goto error_request_new;
+    }
+
+    if ((req->sock = malloc(sizeof(*req->sock))) == NULL) {
+        goto error_malloc_sock;
+    }
+
+    /*
+     * The client end of a SOCK_SEQPACKET channel is passed to us alongside
+     * the response
+     */
+    req->sock->chan = (type & PATTY_AX25_SOCK_SEQPACKET)?
+                          PATTY_AX25_SOCK_CHAN_SEQPACKET:
+                          PATTY_AX25_SOCK_CHAN_PTY;
+
+    client->last.chan = req->sock->chan;
+
+    return request_issue(client, req, &request, sizeof(request), NULL, 0);
+
+error_malloc_sock:
+    request_destroy(req);
+
+error_request_new:
+    return -1;
+}
+
+int patty_client_socket(patty_client *client,
+                        int proto,
+                        int type) {
+    return patty_client_socket_async(client, proto, type, NULL, NULL);
+}
+
+int patty_client_setsockopt_async(patty_client *client,
+                                  int fd,
+                                  int opt,
+                                  void *data,
+                                  size_t len,
+                                  patty_client_callback callback,
+                                  void *ctx) {
+    patty_client_setsockopt_request request = {
+        .opt = opt,
+        .len = len
+    };
 
     patty_client_sock *sock;
+    struct request *req;
+
+    if ((sock = sock_get(client, fd)) == NULL) {
+        goto error_sock_get;
+    }
+
+    request.fd = sock->fd;
+
+    if ((req = request_new(client, PATTY_CLIENT_SETSOCKOPT, callback, ctx)) == NULL) {
+        goto error_request_new;
+    }
+
+    return request_issue(client, req, &request, sizeof(request), data, len);
+
+error_request_new:
+error_sock_get:
+    return -1;
+}
+
+int patty_client_setsockopt(patty_client *client,
+                            int fd,
+                            int opt,
+                            void *data,
+                            size_t len) {
+    return patty_client_setsockopt_async(client, fd, opt, data, len, NULL, NULL);
+}
+
+patty_ax25_tap *patty_client_tap(patty_client *client,
+                                 int fd,
+                                 const char *ifname) {
+    patty_client_setsockopt_request request = {
+        .opt = PATTY_AX25_SOCK_TAP
+    };
+
+    patty_client_setsockopt_if data;
+    patty_client_setsockopt_tap response;
+
+    patty_client_sock *sock;
+    patty_ax25_tap *tap;
+    struct request *req;
 
     if ((sock = patty_dict_get(client->socks, (uint32_t)fd)) == NULL) {
         errno = EBADF;
@@ -482,36 +881,437 @@ int patty_client_connect(patty_client *client,
         goto error_dict_get;
     }
 
+    memset(&data, '\0', sizeof(data));
+
+    patty_strlcpy(data.name, ifname, sizeof(data.name));
+
+    request.fd  = sock->fd;
+    request.len = sizeof(data);
+
+    if ((req = request_new(client, PATTY_CLIENT_SETSOCKOPT, NULL, NULL)) == NULL) {
+        goto error_request_new;
+    }
+
+    req->buf = &response;
+    req->len = sizeof(response);
+
+    if (request_send(client, req, &request, sizeof(request), &data, sizeof(data)) < 0) {
+        goto error_request_send;
+    }
+
+    /*
+     * The tap's shared memory and wakeup eventfd accompany the response
+     */
+    if (request_wait(client, req) < 0) {
+        goto error_request_wait;
+    }
+
+    if (req->fds[0] < 0 || req->fds[1] < 0) {
+        errno = EIO;
+
+        goto error_request_wait;
+    }
+
+    if ((tap = patty_ax25_tap_open(req->fds[0], response.size, req->fds[1])) == NULL) {
+        goto error_tap_open;
+    }
+
+    req->fds[0] = -1;
+    req->fds[1] = -1;
+
+    request_destroy(req);
+
+    return tap;
+
+error_tap_open:
+error_request_wait:
+error_request_send:
+    request_destroy(req);
+
+error_request_new:
+error_dict_get:
+    return NULL;
+}
+
+int patty_client_getsockopt(patty_client *client,
+                            int fd,
+                            int opt,
+                            void *data,
+                            size_t *len) {
+    patty_client_getsockopt_request request = {
+        .opt = opt
+    };
+
+    patty_client_getsockopt_response response;
+    uint8_t body[PATTY_CLIENT_REPLY_MAX];
+
+    patty_client_sock *sock;
+    struct request *req;
+
+    int ret;
+
+    if ((sock = sock_get(client, fd)) == NULL) {
+        goto error_sock_get;
+    }
+
+    request.fd = sock->fd;
+
+    if ((req = request_new(client, PATTY_CLIENT_GETSOCKOPT, NULL, NULL)) == NULL) {
+        goto error_request_new;
+    }
+
+    req->buf = body;
+    req->len = sizeof(body);
+
+    if (request_send(client, req, &request, sizeof(request), NULL, 0) < 0) {
+        goto error_request_send;
+    }
+
+    if ((ret = request_wait(client, req)) < 0) {
+        goto error_request_wait;
+    }
+
+    memcpy(&response, body, sizeof(response));
+
+    if (response.len > sizeof(body) - sizeof(response)) {
+        errno = EPROTO;
+
+        goto error_request_wait;
+    }
+
+    memcpy(data, body + sizeof(response),
+           response.len < *len? response.len: *len);
+
+    *len = response.len;
+
+    request_destroy(req);
+
+    return ret;
+
+error_request_wait:
+error_request_send:
+    request_destroy(req);
+
+error_request_new:
+error_sock_get:
+    return -1;
+}
+
+int patty_client_bind_async(patty_client *client,
+                            int fd,
+                            patty_ax25_addr *addr,
+                            patty_client_callback callback,
+                            void *ctx) {
+    patty_client_bind_request request;
+
+    patty_client_sock *sock;
+    struct request *req;
+
+    if ((sock = sock_get(client, fd)) == NULL) {
+        goto error_sock_get;
+    }
+
     memset(&request, '\0', sizeof(request));
 
     request.fd = sock->fd;
 
-    memcpy(&request.peer, peer, sizeof(*peer));
+    memcpy(&request.addr, addr, sizeof(*addr));
 
-    if (write(client->fd, &call, sizeof(call)) < 0) {
-        goto error_io;
+    if ((req = request_new(client, PATTY_CLIENT_BIND, callback, ctx)) == NULL) {
+        goto error_request_new;
     }
 
-    if (write(client->fd, &request, sizeof(request)) < 0) {
-        goto error_io;
+    return request_issue(client, req, &request, sizeof(request), NULL, 0);
+
+error_request_new:
+error_sock_get:
+    return -1;
+}
+
+int patty_client_bind(patty_client *client,
+                      int fd,
+                      patty_ax25_addr *addr) {
+    return patty_client_bind_async(client, fd, addr, NULL, NULL);
+}
+
+int patty_client_listen_async(patty_client *client,
+                              int fd,
+                              int backlog,
+                              patty_client_callback callback,
+                              void *ctx) {
+    patty_client_listen_request request;
+
+    patty_client_sock *sock;
+    struct request *req;
+
+    if ((sock = sock_get(client, fd)) == NULL) {
+        goto error_sock_get;
     }
 
-    if (read(client->fd, &response, sizeof(response)) < 0) {
-        goto error_io;
+    request.fd      = sock->fd;
+    request.backlog = backlog;
+
+    if ((req = request_new(client, PATTY_CLIENT_LISTEN, callback, ctx)) == NULL) {
+        goto error_request_new;
     }
 
-    errno = response.eno;
+    return request_issue(client, req, &request, sizeof(request), NULL, 0);
 
-    return response.ret;
+error_request_new:
+error_sock_get:
+    return -1;
+}
 
-error_io:
-error_dict_get:
+int patty_client_listen(patty_client *client,
+                        int fd,
+                        int backlog) {
+    return patty_client_listen_async(client, fd, backlog, NULL, NULL);
+}
+
+/*
+ * Discard the notices written by the daemon to a listening socket's channel
+ * as connections arrive, which serve only to make it readable; which
+ * connections are waiting is learned from accept() itself
+ */
+static void listener_clear(int fd) {
+    struct pollfd pfd = {
+        .fd     = fd,
+        .events = POLLIN
+    };
+
+    uint8_t buf[64];
+
+    if (fd == PATTY_CLIENT_FD_LAST) {
+        return;
+    }
+
+    while (poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN)) {
+        if (read(fd, buf, sizeof(buf)) <= 0) {
+            break;
+        }
+    }
+}
+
+static struct request *accept_send(patty_client *client,
+                                   int fd,
+                                   int flags,
+                                   patty_client_callback callback,
+                                   void *ctx) {
+    patty_client_accept_request request;
+
+    patty_client_sock *local;
+    struct request *req;
+
+    if ((local = sock_get(client, fd)) == NULL) {
+        goto error_sock_get;
+    }
+
+    request.fd    = local->fd;
+    request.flags = flags;
+
+    if ((req = request_new(client, PATTY_CLIENT_ACCEPT, callback, ctx)) == NULL) {
+        goto error_request_new;
+    }
+
+    if ((req->sock = malloc(sizeof(*req->sock))) == NULL) {
+        goto error_malloc_sock;
+    }
+
+    /*
+     * The daemon responds once a connection has been accepted, with the new
+     * socket using the same type of data channel as the listener
+     */
+    req->sock->chan = local->chan;
+
+    if (request_send(client, req, &request, sizeof(request), NULL, 0) < 0) {
+        goto error_request_send;
+    }
+
+    return req;
+
+error_request_send:
+error_malloc_sock:
+    request_destroy(req);
+
+error_request_new:
+error_sock_get:
+    return NULL;
+}
+
+int patty_client_accept_async(patty_client *client,
+                              int fd,
+                              int flags,
+                              patty_client_callback callback,
+                              void *ctx) {
+    struct request *req;
+
+    listener_clear(fd);
+
+    if ((req = accept_send(client, fd, flags, callback, ctx)) == NULL) {
+        return -1;
+    }
+
+    return req->id;
+}
+
+int patty_client_accept4(patty_client *client,
+                         int fd,
+                         patty_ax25_addr *peer,
+                         int flags) {
+    struct request *req;
+
+    int ret, eno;
+
+    listener_clear(fd);
+
+    if ((req = accept_send(client, fd, flags, NULL, NULL)) == NULL) {
+        goto error_accept_send;
+    }
+
+    ret = request_wait(client, req);
+    eno = errno;
+
+    if (ret >= 0) {
+        memcpy(peer, &req->result.peer, sizeof(*peer));
+    }
+
+    request_destroy(req);
+
+    errno = eno;
+
+    return ret;
+
+error_accept_send:
     return -1;
 }
 
-int patty_client_close(patty_client *client,
-                       int fd) {
+int patty_client_accept(patty_client *client,
+                        int fd,
+                        patty_ax25_addr *peer) {
+    return patty_client_accept4(client, fd, peer, 0);
+}
+
+/*
+ * Issue one non-blocking accept() per connection wanted, all in a single
+ * batch, so that the daemon hands over every waiting connection in one pass
+ */
+ssize_t patty_client_accept_bulk(patty_client *client,
+                                 int fd,
+                                 int *fds,
+                                 patty_ax25_addr *peers,
+                                 size_t max) {
+    struct request *reqs[PATTY_CLIENT_ACCEPT_BULK_MAX];
+
+    size_t count = 0,
+           taken = 0,
+           i;
+
+    int batching = client->batching,
+        eno      = EAGAIN;
+
+    if (max > PATTY_CLIENT_ACCEPT_BULK_MAX) {
+        max = PATTY_CLIENT_ACCEPT_BULK_MAX;
+    }
+
+    listener_clear(fd);
+
+    if (patty_client_batch_begin(client) < 0) {
+        goto error_batch_begin;
+    }
+
+    while (count < max) {
+        if ((reqs[count] = accept_send(client,
+                                       fd,
+                                       PATTY_CLIENT_ACCEPT_NONBLOCK,
+                                       NULL,
+                                       NULL)) == NULL) {
+            break;
+        }
+
+        count++;
+    }
+
+    client->batching = batching;
+
+    if (count == 0) {
+        goto error_accept_send;
+    }
+
+    for (i=0; i<count; i++) {
+        int ret = request_wait(client, reqs[i]);
+
+        if (ret >= 0) {
+            fds[taken] = ret;
+
+            memcpy(&peers[taken], &reqs[i]->result.peer, sizeof(peers[taken]));
+
+            taken++;
+        } else if (errno != EAGAIN) {
+            eno = errno;
+        }
+
+        request_destroy(reqs[i]);
+    }
+
+    if (taken == 0) {
+        errno = eno;
+
+        return -1;
+    }
+
+    return taken;
+
+error_accept_send:
+    client->batching = batching;
+
+error_batch_begin:
+    return -1;
+}
+
+int patty_client_connect_async(patty_client *client,
+                               int fd,
+                               patty_ax25_addr *peer,
+                               patty_client_callback callback,
+                               void *ctx) {
+    patty_client_connect_request request;
+
     patty_client_sock *sock;
+    struct request *req;
+
+    if ((sock = sock_get(client, fd)) == NULL) {
+        goto error_sock_get;
+    }
+
+    memset(&request, '\0', sizeof(request));
+
+    request.fd = sock->fd;
+
+    memcpy(&request.peer, peer, sizeof(*peer));
+
+    if ((req = request_new(client, PATTY_CLIENT_CONNECT, callback, ctx)) == NULL) {
+        goto error_request_new;
+    }
+
+    return request_issue(client, req, &request, sizeof(request), NULL, 0);
+
+error_request_new:
+error_sock_get:
+    return -1;
+}
+
+int patty_client_connect(patty_client *client,
+                         int fd,
+                         patty_ax25_addr *peer) {
+    return patty_client_connect_async(client, fd, peer, NULL, NULL);
+}
+
+int patty_client_close_async(patty_client *client,
+                             int fd,
+                             patty_client_callback callback,
+                             void *ctx) {
+    patty_client_sock *sock;
+
+    int remote_fd;
 
     if ((sock = patty_dict_get(client->socks, (uint32_t)fd)) == NULL) {
         errno = EBADF;
@@ -519,9 +1319,7 @@ int patty_client_close(patty_client *client,
         goto error_dict_get;
     }
 
-    if (request_close(client, sock->fd) < 0) {
-        goto error_request_close;
-    }
+    remote_fd = sock->fd;
 
     if (close(fd) < 0) {
         goto error_close;
@@ -531,10 +1329,167 @@ int patty_client_close(patty_client *client,
 
     free(sock);
 
-    return 0;
+    return request_close(client, remote_fd, callback, ctx);
 
 error_close:
-error_request_close:
 error_dict_get:
     return -1;
 }
+
+int patty_client_close(patty_client *client,
+                       int fd) {
+    return patty_client_close_async(client, fd, NULL, NULL);
+}
+
+ssize_t patty_client_sendto(patty_client *client,
+                            int fd,
+                            const void *buf,
+                            size_t len,
+                            patty_ax25_addr *addr,
+                            patty_client_path *path) {
+    patty_client_sendto_request request;
+
+    patty_client_sock *sock;
+    struct request *req;
+
+    if ((sock = sock_get(client, fd)) == NULL) {
+        goto error_sock_get;
+    }
+
+    memset(&request, '\0', sizeof(request));
+
+    request.fd        = sock->fd;
+    request.dgram.len = len;
+
+    memcpy(&request.dgram.peer, addr, sizeof(*addr));
+
+    if (path) {
+        memcpy(&request.dgram.path, path, sizeof(*path));
+    }
+
+    /*
+     * Datagrams on SOCK_SEQPACKET channels bypass the daemon's control
+     * connection entirely
+     */
+    if (sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET && fd != PATTY_CLIENT_FD_LAST) {
+        struct iovec iov[2] = {
+            { .iov_base = &request.dgram, .iov_len = sizeof(request.dgram) },
+            { .iov_base = (void *)buf,    .iov_len = len                   }
+        };
+
+        struct msghdr msg = {
+            .msg_iov    = iov,
+            .msg_iovlen = 2
+        };
+
+        if (sendmsg(fd, &msg, MSG_NOSIGNAL) < 0) {
+            goto error_sendmsg;
+        }
+
+        return len;
+    }
+
+    if ((req = request_new(client, PATTY_CLIENT_SENDTO, NULL, NULL)) == NULL) {
+        goto error_request_new;
+    }
+
+    return request_issue(client, req, &request, sizeof(request), buf, len);
+
+error_request_new:
+error_sendmsg:
+error_sock_get:
+    return -1;
+}
+
+ssize_t patty_client_recvfrom(patty_client *client,
+                              int fd,
+                              void *buf,
+                              size_t len,
+                              patty_ax25_addr *addr,
+                              patty_client_path *path) {
+    patty_client_recvfrom_request request;
+    patty_client_dgram dgram;
+
+    uint8_t body[PATTY_CLIENT_REPLY_MAX];
+
+    patty_client_sock *sock;
+    struct request *req;
+
+    ssize_t ret;
+    size_t copy;
+
+    if ((sock = sock_get(client, fd)) == NULL) {
+        goto error_sock_get;
+    }
+
+    if (sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET && fd != PATTY_CLIENT_FD_LAST) {
+        struct iovec iov[2] = {
+            { .iov_base = &dgram, .iov_len = sizeof(dgram) },
+            { .iov_base = buf,    .iov_len = len           }
+        };
+
+        struct msghdr msg = {
+            .msg_iov    = iov,
+            .msg_iovlen = 2
+        };
+
+        if ((ret = recvmsg(fd, &msg, 0)) < 0) {
+            goto error_recvmsg;
+        } else if ((size_t)ret < sizeof(dgram)) {
+            errno = EIO;
+
+            goto error_recvmsg;
+        }
+
+        copy = ret - sizeof(dgram);
+
+        goto done;
+    }
+
+    request.fd  = sock->fd;
+    request.len = len;
+
+    if ((req = request_new(client, PATTY_CLIENT_RECVFROM, NULL, NULL)) == NULL) {
+        goto error_request_new;
+    }
+
+    memset(body, '\0', sizeof(body));
+
+    req->buf = body;
+    req->len = sizeof(body);
+
+    if ((ret = request_issue(client, req, &request, sizeof(request), NULL, 0)) < 0) {
+        goto error_request_issue;
+    }
+
+    memcpy(&dgram, body, sizeof(dgram));
+
+    /*
+     * The daemon truncates datagrams to fit in a single response
+     */
+    copy = (size_t)ret < sizeof(body) - sizeof(dgram)?
+           (size_t)ret: sizeof(body) - sizeof(dgram);
+
+    if (copy > len) {
+        copy = len;
+    }
+
+    memcpy(buf, body + sizeof(dgram), copy);
+
+done:
+    if (addr) {
+        memcpy(addr, &dgram.peer, sizeof(*addr));
+    }
+
+    if (path) {
+        memcpy(path, &dgram.path, sizeof(*path));
+    }
+
+    return copy;
+
+error_request_issue:
+error_request_new:
+error_recvmsg:
+error_sock_get:
+    return -1;
+}
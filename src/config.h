@@ -0,0 +1,14 @@
+#ifndef _CONFIG_H
+#define _CONFIG_H
+
+/*
+ * Generic compatibility
+ */
+#include <endian.h>
+
+/*
+ * Linux openpty(3) compatibility
+ */
+#include <pty.h>
+
+#endif /* _CONFIG_H */
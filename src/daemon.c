@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <errno.h>
 
 #include <patty/ax25.h>
 #include <patty/daemon.h>
@@ -116,12 +117,59 @@ error_strdup:
     return -1;
 }
 
+int patty_daemon_set_limits(patty_daemon *daemon,
+                            const patty_ax25_server_limits *limits) {
+    return patty_ax25_server_limits_set(daemon->server, limits);
+}
+
+int patty_daemon_set_dedup(patty_daemon *daemon, time_t digi, time_t ui) {
+    return patty_ax25_server_dedup_set(daemon->server, digi, ui);
+}
+
 int patty_daemon_if_add(patty_daemon *daemon,
                         patty_ax25_if *iface,
                         const char *ifname) {
     return patty_ax25_server_if_add(daemon->server, iface, ifname);
 }
 
+int patty_daemon_if_alias_add(patty_daemon *daemon,
+                              const char *ifname,
+                              const char *alias) {
+    patty_ax25_if *iface;
+    patty_ax25_addr addr;
+
+    if ((iface = patty_ax25_server_if_get(daemon->server, ifname)) == NULL) {
+        errno = ENODEV;
+
+        goto error_server_if_get;
+    }
+
+    if (patty_ax25_pton(alias, &addr) < 0) {
+        goto error_pton;
+    }
+
+    return patty_ax25_if_addr_add(iface, &addr);
+
+error_pton:
+error_server_if_get:
+    return -1;
+}
+
+int patty_daemon_digi_set(patty_daemon *daemon,
+                          const char *ifname,
+                          const char *outname,
+                          int wide) {
+    return patty_ax25_server_digi_set(daemon->server, ifname, outname, wide);
+}
+
+int patty_daemon_bridge_add(patty_daemon *daemon, const char *ifname) {
+    return patty_ax25_server_bridge_add(daemon->server, ifname);
+}
+
+int patty_daemon_if_param_allow(patty_daemon *daemon, const char *ifname) {
+    return patty_ax25_server_if_param_allow(daemon->server, ifname);
+}
+
 int patty_daemon_route_add(patty_daemon *daemon,
                            const char *ifname,
                            const char *dest,
@@ -142,7 +190,9 @@ int patty_daemon_route_add(patty_daemon *daemon,
 
     memset(route, '\0', sizeof(*route));
 
-    route->iface = iface;
+    route->nexthops[0].iface  = iface;
+    route->nexthops[0].weight = 1;
+    route->n_nexthops         = 1;
 
     if (dest) {
         if (patty_ax25_pton(dest, &route->dest) < 0) {
@@ -156,8 +206,15 @@ int patty_daemon_route_add(patty_daemon *daemon,
         }
     }
 
-    return patty_ax25_server_route_add(daemon->server, route);
+    route->hops = hops;
+
+    if (patty_ax25_server_route_add(daemon->server, route) < 0) {
+        goto error_server_route_add;
+    }
+
+    return 0;
 
+error_server_route_add:
 error_pton:
     free(route);
 
@@ -170,3 +227,41 @@ int patty_daemon_route_add_default(patty_daemon *daemon,
                                    const char *ifname) {
     return patty_daemon_route_add(daemon, ifname, NULL, NULL, 0);
 }
+
+int patty_daemon_route_nexthop_add(patty_daemon *daemon,
+                                   const char *dest,
+                                   const char *ifname,
+                                   unsigned int weight) {
+    patty_ax25_route *route;
+    patty_ax25_if *iface;
+    patty_ax25_addr addr;
+
+    if ((iface = patty_ax25_server_if_get(daemon->server, ifname)) == NULL) {
+        errno = ENODEV;
+
+        goto error_server_if_get;
+    }
+
+    if (dest) {
+        if (patty_ax25_pton(dest, &addr) < 0) {
+            goto error_pton;
+        }
+
+        route = patty_ax25_server_route_get(daemon->server, &addr);
+    } else {
+        route = patty_ax25_server_route_default(daemon->server);
+    }
+
+    if (route == NULL) {
+        errno = ENOENT;
+
+        goto error_route_get;
+    }
+
+    return patty_ax25_route_nexthop_add(route, iface, weight);
+
+error_route_get:
+error_pton:
+error_server_if_get:
+    return -1;
+}
@@ -0,0 +1,172 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <patty/ax25.h>
+#include <patty/hash.h>
+
+struct entry {
+    uint32_t hash;
+    uint64_t seen; /* microseconds, or zero if unused */
+};
+
+struct _patty_ax25_dedup {
+    struct entry *entries;
+    size_t mask;
+
+    uint64_t window,
+             now;
+};
+
+patty_ax25_dedup *patty_ax25_dedup_new(size_t size, time_t window) {
+    patty_ax25_dedup *dedup;
+    size_t slots = 1;
+
+    if (size == 0 || window <= 0) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    while (slots < size) {
+        slots <<= 1;
+    }
+
+    if ((dedup = malloc(sizeof(*dedup))) == NULL) {
+        goto error_malloc_dedup;
+    }
+
+    if ((dedup->entries = calloc(slots, sizeof(struct entry))) == NULL) {
+        goto error_malloc_entries;
+    }
+
+    dedup->mask   = slots - 1;
+    dedup->window = (uint64_t)window * 1000;
+
+    /*
+     * Start the clock beyond zero, which marks unused slots
+     */
+    dedup->now = 1;
+
+    return dedup;
+
+error_malloc_entries:
+    free(dedup);
+
+error_malloc_dedup:
+error_invalid:
+    return NULL;
+}
+
+void patty_ax25_dedup_destroy(patty_ax25_dedup *dedup) {
+    free(dedup->entries);
+    free(dedup);
+}
+
+void patty_ax25_dedup_tick(patty_ax25_dedup *dedup,
+                           struct timespec *elapsed) {
+    int64_t us = (int64_t)elapsed->tv_sec * 1000000
+               + (int64_t)elapsed->tv_nsec / 1000;
+
+    if (us > 0) {
+        dedup->now += (uint64_t)us;
+    }
+}
+
+static void hash_station(uint32_t *hash, const uint8_t *addr) {
+    uint8_t ssid = PATTY_AX25_ADDR_SSID_NUMBER(addr[PATTY_AX25_CALLSTRLEN]);
+
+    patty_hash_data(hash, (void *)addr, PATTY_AX25_CALLSTRLEN);
+    patty_hash_data(hash, &ssid, sizeof(ssid));
+}
+
+static int fingerprint(uint32_t *hash,
+                       uint32_t tag,
+                       const uint8_t *buf,
+                       size_t len) {
+    size_t offset = 2 * sizeof(patty_ax25_addr);
+
+    if (len <= offset) {
+        errno = EIO;
+
+        goto error_short;
+    }
+
+    /*
+     * Skip over the repeater path, to where the control field begins
+     */
+    if (!PATTY_AX25_ADDR_OCTET_LAST(buf[offset - 1])) {
+        do {
+            offset += sizeof(patty_ax25_addr);
+
+            if (len <= offset) {
+                errno = EIO;
+
+                goto error_short;
+            }
+        } while (!PATTY_AX25_ADDR_OCTET_LAST(buf[offset - 1]));
+    }
+
+    patty_hash_init(hash);
+    patty_hash_data(hash, &tag, sizeof(tag));
+    hash_station(hash, buf);
+    hash_station(hash, buf + sizeof(patty_ax25_addr));
+    patty_hash_data(hash, (void *)(buf + offset), len - offset);
+    patty_hash_end(hash);
+
+    return 0;
+
+error_short:
+    return -1;
+}
+
+int patty_ax25_dedup_seen_tagged(patty_ax25_dedup *dedup,
+                                 uint32_t tag,
+                                 const void *buf,
+                                 size_t len) {
+    struct entry *victim = NULL;
+    int victim_live = 0;
+    uint32_t hash;
+    size_t i;
+
+    if (fingerprint(&hash, tag, buf, len) < 0) {
+        return -1;
+    }
+
+    for (i=0; i<PATTY_AX25_DEDUP_PROBES; i++) {
+        struct entry *entry = &dedup->entries[(hash + i) & dedup->mask];
+
+        int live = entry->seen
+                && dedup->now - entry->seen < dedup->window;
+
+        if (live && entry->hash == hash) {
+            return 1;
+        }
+
+        /*
+         * Replace the first unused or expired slot, or failing that, the
+         * oldest of those searched
+         */
+        if (!live) {
+            if (victim == NULL || victim_live) {
+                victim      = entry;
+                victim_live = 0;
+            }
+        } else if (victim == NULL
+                || (victim_live && entry->seen < victim->seen)) {
+            victim      = entry;
+            victim_live = 1;
+        }
+    }
+
+    victim->hash = hash;
+    victim->seen = dedup->now;
+
+    return 0;
+}
+
+int patty_ax25_dedup_seen(patty_ax25_dedup *dedup,
+                          const void *buf,
+                          size_t len) {
+    return patty_ax25_dedup_seen_tagged(dedup, 0, buf, len);
+}
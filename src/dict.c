@@ -29,13 +29,7 @@ patty_dict_slot *patty_dict_slot_find(patty_dict *dict, uint32_t key) {
 
         patty_dict_slot *slot = &bucket->slots[index];
 
-        if (!slot->set) {
-            /*
-             * In this case, we have determined that there is no value in the
-             * dict for the given key.
-             */
-            return NULL;
-        } else if (slot->key == key) {
+        if (slot->set && slot->key == key) {
             /*
              * We have found the desired slot, so return that.
              */
@@ -43,7 +37,8 @@ patty_dict_slot *patty_dict_slot_find(patty_dict *dict, uint32_t key) {
         }
 
         /*
-         * Otherwise, look for the next bucket, if present.
+         * Otherwise, look for the next bucket, if present; a slot emptied by
+         * a deletion may still lead to keys chained beyond it.
          */
         bucket = (patty_dict_bucket *)slot->next;
 
@@ -112,14 +107,23 @@ void *patty_dict_set(patty_dict *dict,
                      uint32_t key,
                      void *value) {
     patty_dict_bucket *bucket = &dict->bucket;
+    patty_dict_slot *slot;
 
     int collisions;
 
+    /*
+     * If the key is already present, possibly beyond a slot emptied by a
+     * deletion, then update it in place.
+     */
+    if ((slot = patty_dict_slot_find(dict, key)) != NULL) {
+        return slot->value = value;
+    }
+
     for (collisions = 0; collisions < 7; collisions++) {
         uint32_t mask  = 0x0f << (4 * collisions);
         uint8_t  index = (key & mask) >> (4 * collisions);
 
-        patty_dict_slot *slot = &bucket->slots[index];
+        slot = &bucket->slots[index];
 
         if (!slot->set) {
             /*
@@ -170,7 +174,13 @@ int patty_dict_delete(patty_dict *dict, uint32_t key) {
         goto error_dict_slot_find;
     }
 
-    memset(slot, '\0', sizeof(*slot));
+    /*
+     * Keep the slot's link to the next bucket, so that keys chained beyond it
+     * remain reachable
+     */
+    slot->key   = 0;
+    slot->value = NULL;
+    slot->set   = 0;
 
     return 0;
 
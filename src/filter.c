@@ -0,0 +1,572 @@
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+
+#include <patty/ax25.h>
+
+struct _patty_ax25_filter {
+    size_t count;
+
+    patty_ax25_filter_insn insns[];
+};
+
+patty_ax25_filter *patty_ax25_filter_new(const patty_ax25_filter_insn *insns,
+                                         size_t count) {
+    patty_ax25_filter *filter;
+    size_t i;
+
+    if (count == 0 || count > PATTY_AX25_FILTER_MAX_INSNS) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    /*
+     * Every jump must land on an instruction within the program, which
+     * means the final instruction is always a RET
+     */
+    for (i=0; i<count; i++) {
+        const patty_ax25_filter_insn *insn = &insns[i];
+
+        if (insn->op > PATTY_AX25_FILTER_PID) {
+            errno = EINVAL;
+
+            goto error_invalid;
+        }
+
+        if (insn->op == PATTY_AX25_FILTER_RET) {
+            continue;
+        }
+
+        if (i + 1 + insn->jt >= count || i + 1 + insn->jf >= count) {
+            errno = EINVAL;
+
+            goto error_invalid;
+        }
+    }
+
+    if ((filter = malloc(sizeof(*filter) + count * sizeof(*insns))) == NULL) {
+        goto error_malloc_filter;
+    }
+
+    filter->count = count;
+
+    memcpy(filter->insns, insns, count * sizeof(*insns));
+
+    return filter;
+
+error_malloc_filter:
+error_invalid:
+    return NULL;
+}
+
+void patty_ax25_filter_destroy(patty_ax25_filter *filter) {
+    free(filter);
+}
+
+const patty_ax25_filter_insn *patty_ax25_filter_insns(patty_ax25_filter *filter) {
+    return filter->insns;
+}
+
+size_t patty_ax25_filter_count(patty_ax25_filter *filter) {
+    return filter->count;
+}
+
+static inline int addr_match(const patty_ax25_filter_insn *insn,
+                             const uint8_t *octets) {
+    if (memcmp(octets, insn->addr.callsign, sizeof(insn->addr.callsign)) != 0) {
+        return 0;
+    }
+
+    return (insn->flags & PATTY_AX25_FILTER_ANY_SSID)
+        || (octets[6] & 0x1e) == (insn->addr.ssid & 0x1e);
+}
+
+int patty_ax25_filter_run(const patty_ax25_filter *filter,
+                          const void *buf,
+                          size_t len) {
+    const uint8_t *frame = buf;
+
+    size_t addrs = 0,
+           pc    = 0;
+
+    uint8_t control;
+    int has_pid;
+
+    /*
+     * Locate the end of the address field, then the control field and PID
+     * which follow it
+     */
+    while (1) {
+        if ((addrs + 1) * sizeof(patty_ax25_addr) > len
+         || addrs == 2 + PATTY_AX25_MAX_HOPS) {
+            return 0;
+        }
+
+        if (PATTY_AX25_ADDR_OCTET_LAST(frame[addrs++ * sizeof(patty_ax25_addr) + 6])) {
+            break;
+        }
+    }
+
+    if (addrs < 2 || addrs * sizeof(patty_ax25_addr) >= len) {
+        return 0;
+    }
+
+    control = frame[addrs * sizeof(patty_ax25_addr)];
+    has_pid = (PATTY_AX25_FRAME_CONTROL_I(control)
+            || PATTY_AX25_FRAME_CONTROL_UI(control))
+           && addrs * sizeof(patty_ax25_addr) + 1 < len;
+
+    while (1) {
+        const patty_ax25_filter_insn *insn = &filter->insns[pc];
+        int match = 0;
+
+        size_t i;
+
+        switch (insn->op) {
+            case PATTY_AX25_FILTER_RET:
+                return insn->k != 0;
+
+            case PATTY_AX25_FILTER_DEST:
+                match = addr_match(insn, frame);
+
+                break;
+
+            case PATTY_AX25_FILTER_SRC:
+                match = addr_match(insn, frame + sizeof(patty_ax25_addr));
+
+                break;
+
+            case PATTY_AX25_FILTER_VIA:
+                for (i=2; i<addrs && !match; i++) {
+                    match = addr_match(insn, frame + i * sizeof(patty_ax25_addr));
+                }
+
+                break;
+
+            case PATTY_AX25_FILTER_CONTROL:
+                match = (control & insn->mask) == insn->k;
+
+                break;
+
+            case PATTY_AX25_FILTER_PID:
+                match = has_pid
+                     && frame[addrs * sizeof(patty_ax25_addr) + 1] == insn->k;
+
+                break;
+        }
+
+        pc += 1 + (match? insn->jt: insn->jf);
+    }
+}
+
+/*
+ * Expression compiler
+ */
+enum node_type {
+    NODE_LEAF,
+    NODE_NOT,
+    NODE_AND,
+    NODE_OR
+};
+
+struct node {
+    enum node_type type;
+
+    struct node *left,
+                *right;
+
+    patty_ax25_filter_insn insn;
+};
+
+struct parser {
+    const char *expr;
+
+    char token[32];
+    int have_token;
+
+    struct node nodes[PATTY_AX25_FILTER_MAX_INSNS];
+    size_t n_nodes;
+};
+
+static const struct {
+    const char *name;
+    uint8_t mask,
+            k;
+} frame_types[] = {
+    { "i",     0x01,                    PATTY_AX25_FRAME_I     },
+    { "s",     0x03,                    0x01                   },
+    { "u",     0x03,                    0x03                   },
+    { "rr",    PATTY_AX25_FRAME_S_MASK, PATTY_AX25_FRAME_RR    },
+    { "rnr",   PATTY_AX25_FRAME_S_MASK, PATTY_AX25_FRAME_RNR   },
+    { "rej",   PATTY_AX25_FRAME_S_MASK, PATTY_AX25_FRAME_REJ   },
+    { "srej",  PATTY_AX25_FRAME_S_MASK, PATTY_AX25_FRAME_SREJ  },
+    { "sabm",  PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_SABM  },
+    { "sabme", PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_SABME },
+    { "disc",  PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_DISC  },
+    { "dm",    PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_DM    },
+    { "ua",    PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_UA    },
+    { "frmr",  PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_FRMR  },
+    { "ui",    PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_UI    },
+    { "xid",   PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_XID   },
+    { "test",  PATTY_AX25_FRAME_U_MASK, PATTY_AX25_FRAME_TEST  },
+    { NULL,    0,                       0                      }
+};
+
+static const char *next_token(struct parser *parser) {
+    const char *p = parser->expr;
+    size_t len = 0;
+
+    if (parser->have_token) {
+        return parser->token;
+    }
+
+    while (isspace((unsigned char)*p)) {
+        p++;
+    }
+
+    if (*p == '\0') {
+        return NULL;
+    }
+
+    if (*p == '(' || *p == ')' || *p == '!') {
+        parser->token[len++] = *p++;
+    } else {
+        while (*p && !isspace((unsigned char)*p)
+            && *p != '(' && *p != ')' && *p != '!') {
+            if (len == sizeof(parser->token) - 1) {
+                return NULL;
+            }
+
+            parser->token[len++] = *p++;
+        }
+    }
+
+    parser->token[len] = '\0';
+    parser->expr       = p;
+    parser->have_token = 1;
+
+    return parser->token;
+}
+
+static inline void consume(struct parser *parser) {
+    parser->have_token = 0;
+}
+
+static inline int token_is(const char *token, const char *a, const char *b) {
+    return token && (strcasecmp(token, a) == 0
+                 || (b && strcmp(token, b) == 0));
+}
+
+static struct node *node_new(struct parser *parser,
+                             enum node_type type,
+                             struct node *left,
+                             struct node *right) {
+    struct node *node;
+
+    if (parser->n_nodes == PATTY_AX25_FILTER_MAX_INSNS) {
+        return NULL;
+    }
+
+    node = &parser->nodes[parser->n_nodes++];
+
+    memset(node, '\0', sizeof(*node));
+
+    node->type  = type;
+    node->left  = left;
+    node->right = right;
+
+    return node;
+}
+
+static struct node *leaf_addr(struct parser *parser,
+                              enum patty_ax25_filter_op op,
+                              const char *callsign) {
+    struct node *node;
+
+    if ((node = node_new(parser, NODE_LEAF, NULL, NULL)) == NULL) {
+        return NULL;
+    }
+
+    if (patty_ax25_pton(callsign, &node->insn.addr) < 0) {
+        return NULL;
+    }
+
+    node->insn.op = op;
+
+    if (strchr(callsign, '-') == NULL) {
+        node->insn.flags |= PATTY_AX25_FILTER_ANY_SSID;
+    }
+
+    return node;
+}
+
+static struct node *parse_or(struct parser *parser);
+
+static struct node *parse_primitive(struct parser *parser) {
+    const char *token = next_token(parser);
+
+    char keyword[sizeof(parser->token)];
+
+    struct node *node;
+    size_t i;
+
+    if (token == NULL) {
+        return NULL;
+    }
+
+    if (token_is(token, "not", "!")) {
+        consume(parser);
+
+        if ((node = parse_primitive(parser)) == NULL) {
+            return NULL;
+        }
+
+        return node_new(parser, NODE_NOT, node, NULL);
+    }
+
+    if (token_is(token, "(", NULL)) {
+        consume(parser);
+
+        if ((node = parse_or(parser)) == NULL) {
+            return NULL;
+        }
+
+        if (!token_is(next_token(parser), ")", NULL)) {
+            return NULL;
+        }
+
+        consume(parser);
+
+        return node;
+    }
+
+    strcpy(keyword, token);
+
+    consume(parser);
+
+    if ((token = next_token(parser)) == NULL) {
+        return NULL;
+    }
+
+    consume(parser);
+
+    if (token_is(keyword, "src", NULL)) {
+        return leaf_addr(parser, PATTY_AX25_FILTER_SRC, token);
+    } else if (token_is(keyword, "dst", NULL) || token_is(keyword, "dest", NULL)) {
+        return leaf_addr(parser, PATTY_AX25_FILTER_DEST, token);
+    } else if (token_is(keyword, "via", NULL)) {
+        return leaf_addr(parser, PATTY_AX25_FILTER_VIA, token);
+    } else if (token_is(keyword, "host", NULL)) {
+        struct node *src, *dest;
+
+        if ((src  = leaf_addr(parser, PATTY_AX25_FILTER_SRC,  token)) == NULL
+         || (dest = leaf_addr(parser, PATTY_AX25_FILTER_DEST, token)) == NULL) {
+            return NULL;
+        }
+
+        return node_new(parser, NODE_OR, src, dest);
+    } else if (token_is(keyword, "type", NULL)) {
+        for (i=0; frame_types[i].name; i++) {
+            if (strcasecmp(token, frame_types[i].name) == 0) {
+                break;
+            }
+        }
+
+        if (frame_types[i].name == NULL
+         || (node = node_new(parser, NODE_LEAF, NULL, NULL)) == NULL) {
+            return NULL;
+        }
+
+        node->insn.op   = PATTY_AX25_FILTER_CONTROL;
+        node->insn.mask = frame_types[i].mask;
+        node->insn.k    = frame_types[i].k;
+
+        return node;
+    } else if (token_is(keyword, "pid", NULL)) {
+        char *end;
+        long pid = strtol(token, &end, 0);
+
+        if (*end != '\0' || pid < 0 || pid > 0xff
+         || (node = node_new(parser, NODE_LEAF, NULL, NULL)) == NULL) {
+            return NULL;
+        }
+
+        node->insn.op = PATTY_AX25_FILTER_PID;
+        node->insn.k  = (uint8_t)pid;
+
+        return node;
+    }
+
+    return NULL;
+}
+
+static struct node *parse_and(struct parser *parser) {
+    struct node *node;
+
+    if ((node = parse_primitive(parser)) == NULL) {
+        return NULL;
+    }
+
+    while (token_is(next_token(parser), "and", "&&")) {
+        struct node *right;
+
+        consume(parser);
+
+        if ((right = parse_primitive(parser)) == NULL) {
+            return NULL;
+        }
+
+        if ((node = node_new(parser, NODE_AND, node, right)) == NULL) {
+            return NULL;
+        }
+    }
+
+    return node;
+}
+
+static struct node *parse_or(struct parser *parser) {
+    struct node *node;
+
+    if ((node = parse_and(parser)) == NULL) {
+        return NULL;
+    }
+
+    while (token_is(next_token(parser), "or", "||")) {
+        struct node *right;
+
+        consume(parser);
+
+        if ((right = parse_and(parser)) == NULL) {
+            return NULL;
+        }
+
+        if ((node = node_new(parser, NODE_OR, node, right)) == NULL) {
+            return NULL;
+        }
+    }
+
+    return node;
+}
+
+static size_t node_leaves(struct node *node) {
+    switch (node->type) {
+        case NODE_LEAF: return 1;
+        case NODE_NOT:  return node_leaves(node->left);
+
+        default:
+            break;
+    }
+
+    return node_leaves(node->left) + node_leaves(node->right);
+}
+
+/*
+ * Emit the tests of a node starting at pos, jumping to the instruction at t
+ * if the expression holds and to f otherwise; the right side of AND and OR
+ * always directly follows the left, so all jumps run forward
+ */
+static void node_emit(struct node *node,
+                      patty_ax25_filter_insn *insns,
+                      size_t pos,
+                      size_t t,
+                      size_t f) {
+    size_t next;
+
+    switch (node->type) {
+        case NODE_LEAF:
+            memcpy(&insns[pos], &node->insn, sizeof(insns[pos]));
+
+            insns[pos].jt = t - pos - 1;
+            insns[pos].jf = f - pos - 1;
+
+            break;
+
+        case NODE_NOT:
+            node_emit(node->left, insns, pos, f, t);
+
+            break;
+
+        case NODE_AND:
+            next = pos + node_leaves(node->left);
+
+            node_emit(node->left,  insns, pos,  next, f);
+            node_emit(node->right, insns, next, t,    f);
+
+            break;
+
+        case NODE_OR:
+            next = pos + node_leaves(node->left);
+
+            node_emit(node->left,  insns, pos,  t, next);
+            node_emit(node->right, insns, next, t, f);
+
+            break;
+    }
+}
+
+patty_ax25_filter *patty_ax25_filter_compile(const char *expr) {
+    struct parser *parser;
+    struct node *root;
+    patty_ax25_filter *filter;
+
+    patty_ax25_filter_insn insns[PATTY_AX25_FILTER_MAX_INSNS];
+    size_t count;
+
+    if ((parser = malloc(sizeof(*parser))) == NULL) {
+        goto error_malloc_parser;
+    }
+
+    memset(parser, '\0', sizeof(*parser));
+    memset(insns, '\0', sizeof(insns));
+
+    parser->expr = expr;
+
+    /*
+     * An empty expression accepts every frame
+     */
+    if (next_token(parser) == NULL) {
+        insns[0].op = PATTY_AX25_FILTER_RET;
+        insns[0].k  = 1;
+
+        count = 1;
+
+        goto done;
+    }
+
+    if ((root = parse_or(parser)) == NULL || next_token(parser) != NULL) {
+        errno = EINVAL;
+
+        goto error_parse;
+    }
+
+    if ((count = node_leaves(root)) + 2 > PATTY_AX25_FILTER_MAX_INSNS) {
+        errno = EINVAL;
+
+        goto error_parse;
+    }
+
+    node_emit(root, insns, 0, count, count + 1);
+
+    insns[count].op   = PATTY_AX25_FILTER_RET;
+    insns[count++].k  = 1;
+    insns[count].op   = PATTY_AX25_FILTER_RET;
+    insns[count++].k  = 0;
+
+done:
+    if ((filter = patty_ax25_filter_new(insns, count)) == NULL) {
+        goto error_filter_new;
+    }
+
+    free(parser);
+
+    return filter;
+
+error_filter_new:
+error_parse:
+    free(parser);
+
+error_malloc_parser:
+    return NULL;
+}
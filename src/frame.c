@@ -146,7 +146,7 @@ static inline uint8_t decode_nr(uint16_t control,
                                 enum patty_ax25_frame_format format) {
     switch (format) {
         case PATTY_AX25_FRAME_NORMAL:   return (control & 0x00e0) >> 5;
-        case PATTY_AX25_FRAME_EXTENDED: return (control & 0x7e00) >> 9;
+        case PATTY_AX25_FRAME_EXTENDED: return (control & 0xfe00) >> 9;
     }
 
     return 0;
@@ -156,7 +156,7 @@ static inline uint8_t decode_ns(uint16_t control,
                                 enum patty_ax25_frame_format format) {
     switch (format) {
         case PATTY_AX25_FRAME_NORMAL:   return (control & 0x000e) >> 1;
-        case PATTY_AX25_FRAME_EXTENDED: return (control & 0x007e) >> 1;
+        case PATTY_AX25_FRAME_EXTENDED: return (control & 0x00fe) >> 1;
     }
 
     return 0;
@@ -1,11 +1,19 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <termios.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <stdatomic.h>
 #include <errno.h>
 
 #include <patty/ax25.h>
 #include <patty/kiss.h>
+#include <patty/kiss/tnc.h>
+#include <patty/ring.h>
 
 patty_ax25_if *patty_ax25_if_new(patty_ax25_if_driver *driver,
                                  patty_ax25_if_info *info) {
@@ -77,11 +85,663 @@ int patty_ax25_if_addr_set(patty_ax25_if *iface,
     return patty_ax25_addr_copy(&iface->addr, addr, 0);
 }
 
+/*
+ * Threaded interface I/O: the driver fill/drain/flush and send routines run
+ * on a dedicated thread, and frames are passed to and from the protocol
+ * thread by way of a pair of single producer, single consumer rings.  Each
+ * direction is accompanied by a non-blocking pipe, used only to wake the
+ * other side; the read end of the receive wakeup pipe stands in for the
+ * interface file descriptor in the event loop of the protocol thread.
+ */
+enum thread_state {
+    THREAD_RUNNING,
+    THREAD_EOF,
+    THREAD_ERROR
+};
+
+enum thread_record {
+    THREAD_RECORD_FRAME,
+    THREAD_RECORD_PARAM
+};
+
+struct _patty_ax25_if_thread {
+    pthread_t thread;
+
+    int cpu,
+        started;
+
+    patty_ring *rx,
+               *tx;
+
+    int wake_rx[2],
+        wake_tx[2];
+
+    atomic_int state,
+               error,
+               stop,
+               drain_wait; /* Wake protocol thread once below low watermark */
+
+    atomic_size_t queued; /* Output queued by the driver, as last seen */
+
+    uint8_t *rx_buf, /* Used only by the I/O thread */
+            *tx_buf,
+            *scratch; /* Used only by the protocol thread */
+
+    size_t rx_bufsz,
+           tx_bufsz;
+
+    ssize_t pending;
+
+    /*
+     * Counters kept by the protocol thread; those of the PHY are only ever
+     * updated by the I/O thread
+     */
+    patty_ax25_if_stats stats;
+};
+
+static void thread_wake(int fd) {
+    uint8_t c = 0;
+
+    /*
+     * A full pipe already guarantees a pending wakeup
+     */
+    if (write(fd, &c, sizeof(c)) < 0) {
+        return;
+    }
+}
+
+static void thread_wake_clear(int fd) {
+    uint8_t buf[64];
+
+    while (read(fd, buf, sizeof(buf)) > 0) {
+        continue;
+    }
+}
+
+/*
+ * Return the counters the protocol thread may update for an interface
+ */
+static patty_ax25_if_stats *if_stats(patty_ax25_if *iface) {
+    if (iface->thread) {
+        return &iface->thread->stats;
+    }
+
+    return iface->driver->stats(iface->phy);
+}
+
+static void thread_fail(patty_ax25_if_thread *thread,
+                        enum thread_state state,
+                        int error) {
+    atomic_store(&thread->error, error);
+    atomic_store(&thread->state, state);
+
+    thread_wake(thread->wake_rx[1]);
+}
+
+static int thread_rx(patty_ax25_if *iface) {
+    patty_ax25_if_thread *thread = iface->thread;
+    patty_ax25_if_driver *driver = iface->driver;
+
+    ssize_t len;
+    size_t frames = 0;
+
+    if ((len = driver->fill(iface->phy)) < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return 1;
+        }
+
+        goto error_fill;
+    } else if (len == 0) {
+        return 0;
+    }
+
+    while (1) {
+        ssize_t drained;
+
+        if ((drained = driver->drain(iface->phy,
+                                     thread->rx_buf,
+                                     thread->rx_bufsz)) < 0) {
+            goto error_drain;
+        }
+
+        if (!driver->pending(iface->phy)) {
+            if (drained == 0) {
+                break;
+            }
+
+            continue;
+        }
+
+        if ((len = driver->flush(iface->phy)) < 0) {
+            goto error_flush;
+        }
+
+        if (patty_ring_push(thread->rx, thread->rx_buf, len) < 0) {
+            driver->stats(iface->phy)->dropped++;
+        } else {
+            frames++;
+        }
+    }
+
+    if (frames) {
+        thread_wake(thread->wake_rx[1]);
+    }
+
+    return 1;
+
+error_flush:
+error_drain:
+error_fill:
+    return -1;
+}
+
+static inline size_t driver_queued(patty_ax25_if *iface) {
+    ssize_t queued = iface->driver->queued?
+                     iface->driver->queued(iface->phy): 0;
+
+    return queued > 0? (size_t)queued: 0;
+}
+
+/*
+ * Publish the output queued by the driver to the protocol thread, and wake
+ * the latter if it waits for the interface to drain
+ */
+static void thread_queued_update(patty_ax25_if *iface) {
+    patty_ax25_if_thread *thread = iface->thread;
+
+    size_t queued = driver_queued(iface);
+
+    atomic_store(&thread->queued, queued);
+
+    if (patty_ring_used(thread->tx) + queued < PATTY_AX25_IF_QUEUE_LOW
+     && atomic_exchange(&thread->drain_wait, 0)) {
+        thread_wake(thread->wake_rx[1]);
+    }
+}
+
+static int thread_tx(patty_ax25_if *iface) {
+    patty_ax25_if_thread *thread = iface->thread;
+    patty_ax25_if_driver *driver = iface->driver;
+
+    ssize_t len;
+
+    /*
+     * Leave records in the ring while the driver's own output queue is
+     * backed up, as the driver would otherwise drop them
+     */
+    while (driver_queued(iface) < PATTY_AX25_IF_QUEUE_HIGH
+        && (len = patty_ring_pop(thread->tx,
+                                 thread->tx_buf,
+                                 thread->tx_bufsz)) != 0) {
+        if (len < 0) {
+            driver->stats(iface->phy)->dropped++;
+
+            continue;
+        }
+
+        switch (thread->tx_buf[0]) {
+            case THREAD_RECORD_FRAME:
+                if (driver->send(iface->phy,
+                                 thread->tx_buf + 1,
+                                 len - 1) < 0) {
+                    goto error_send;
+                }
+
+                break;
+
+            case THREAD_RECORD_PARAM: {
+                uint32_t value;
+
+                memcpy(&value, thread->tx_buf + 2, sizeof(value));
+
+                if (driver->param_set(iface->phy,
+                                      thread->tx_buf[1],
+                                      value) < 0) {
+                    goto error_param_set;
+                }
+
+                break;
+            }
+        }
+    }
+
+    thread_queued_update(iface);
+
+    return 0;
+
+error_param_set:
+error_send:
+    return -1;
+}
+
+static void *thread_main(void *ctx) {
+    patty_ax25_if *iface = ctx;
+    patty_ax25_if_thread *thread = iface->thread;
+    patty_ax25_if_driver *driver = iface->driver;
+
+    int fd     = driver->fd(iface->phy),
+        fd_max = (fd > thread->wake_tx[0]? fd: thread->wake_tx[0]) + 1;
+
+    while (!atomic_load(&thread->stop)) {
+        fd_set fds_r,
+               fds_w;
+
+        FD_ZERO(&fds_r);
+        FD_ZERO(&fds_w);
+
+        FD_SET(fd, &fds_r);
+        FD_SET(thread->wake_tx[0], &fds_r);
+
+        if (driver->queued && driver->queued(iface->phy) > 0) {
+            FD_SET(fd, &fds_w);
+        }
+
+        if (select(fd_max, &fds_r, &fds_w, NULL, NULL) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            goto error_io;
+        }
+
+        if (FD_ISSET(fd, &fds_w)) {
+            if (driver->transmit(iface->phy) < 0) {
+                goto error_io;
+            }
+        }
+
+        if (FD_ISSET(thread->wake_tx[0], &fds_r)) {
+            thread_wake_clear(thread->wake_tx[0]);
+        }
+
+        /*
+         * Records left in the ring while the driver was backed up are taken
+         * once it has made room
+         */
+        if (FD_ISSET(thread->wake_tx[0], &fds_r) || FD_ISSET(fd, &fds_w)) {
+            if (thread_tx(iface) < 0) {
+                goto error_io;
+            }
+        }
+
+        if (driver->ready(iface->phy, &fds_r)) {
+            switch (thread_rx(iface)) {
+                case -1:
+                    goto error_io;
+
+                case 0:
+                    thread_fail(thread, THREAD_EOF, EIO);
+
+                    return NULL;
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    return NULL;
+
+error_io:
+    thread_fail(thread, THREAD_ERROR, errno);
+
+    return NULL;
+}
+
+static int thread_pipe(int fds[2]) {
+    int i;
+
+    if (pipe(fds) < 0) {
+        goto error_pipe;
+    }
+
+    for (i=0; i<2; i++) {
+        int flags;
+
+        if ((flags = fcntl(fds[i], F_GETFL)) < 0) {
+            goto error_fcntl;
+        }
+
+        if (fcntl(fds[i], F_SETFL, flags | O_NONBLOCK) < 0) {
+            goto error_fcntl;
+        }
+    }
+
+    return 0;
+
+error_fcntl:
+    (void)close(fds[0]);
+    (void)close(fds[1]);
+
+error_pipe:
+    return -1;
+}
+
+int patty_ax25_if_thread_init(patty_ax25_if *iface, int cpu) {
+    patty_ax25_if_thread *thread;
+
+    if (iface->thread) {
+        errno = EBUSY;
+
+        goto error_busy;
+    }
+
+    if ((thread = malloc(sizeof(*thread))) == NULL) {
+        goto error_malloc_thread;
+    }
+
+    memset(thread, '\0', sizeof(*thread));
+
+    thread->cpu      = cpu;
+    thread->rx_bufsz = iface->mru;
+    thread->tx_bufsz = iface->mtu + 1;
+
+    atomic_init(&thread->state, THREAD_RUNNING);
+    atomic_init(&thread->error, 0);
+    atomic_init(&thread->stop,  0);
+    atomic_init(&thread->drain_wait, 0);
+    atomic_init(&thread->queued, 0);
+
+    if ((thread->rx_buf = malloc(thread->rx_bufsz)) == NULL) {
+        goto error_malloc_rx_buf;
+    }
+
+    if ((thread->tx_buf = malloc(thread->tx_bufsz)) == NULL) {
+        goto error_malloc_tx_buf;
+    }
+
+    if ((thread->scratch = malloc(thread->tx_bufsz)) == NULL) {
+        goto error_malloc_scratch;
+    }
+
+    if ((thread->rx = patty_ring_new(PATTY_AX25_IF_THREAD_RING_SIZE)) == NULL) {
+        goto error_ring_new_rx;
+    }
+
+    if ((thread->tx = patty_ring_new(PATTY_AX25_IF_THREAD_RING_SIZE)) == NULL) {
+        goto error_ring_new_tx;
+    }
+
+    if (thread_pipe(thread->wake_rx) < 0) {
+        goto error_pipe_rx;
+    }
+
+    if (thread_pipe(thread->wake_tx) < 0) {
+        goto error_pipe_tx;
+    }
+
+    /*
+     * Carry the counts so far over, so that the adaptive channel access
+     * controller sees no discontinuity
+     */
+    memcpy(&thread->stats,
+           iface->driver->stats(iface->phy),
+           sizeof(thread->stats));
+
+    iface->thread = thread;
+
+    return 0;
+
+error_pipe_tx:
+    (void)close(thread->wake_rx[0]);
+    (void)close(thread->wake_rx[1]);
+
+error_pipe_rx:
+    patty_ring_destroy(thread->tx);
+
+error_ring_new_tx:
+    patty_ring_destroy(thread->rx);
+
+error_ring_new_rx:
+    free(thread->scratch);
+
+error_malloc_scratch:
+    free(thread->tx_buf);
+
+error_malloc_tx_buf:
+    free(thread->rx_buf);
+
+error_malloc_rx_buf:
+    free(thread);
+
+error_malloc_thread:
+error_busy:
+    return -1;
+}
+
+int patty_ax25_if_thread_start(patty_ax25_if *iface) {
+    patty_ax25_if_thread *thread = iface->thread;
+    pthread_attr_t attr;
+
+    int err;
+
+    if (thread == NULL || thread->started) {
+        return 0;
+    }
+
+    if ((err = pthread_attr_init(&attr)) != 0) {
+        errno = err;
+
+        goto error_pthread_attr_init;
+    }
+
+    /*
+     * Bind the thread to its CPU before it runs, rather than after
+     */
+    if (thread->cpu >= 0) {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(thread->cpu, &set);
+
+        if ((err = pthread_attr_setaffinity_np(&attr,
+                                               sizeof(set),
+                                               &set)) != 0) {
+            errno = err;
+
+            goto error_pthread_attr_setaffinity_np;
+        }
+    }
+
+    atomic_store(&thread->state, THREAD_RUNNING);
+    atomic_store(&thread->error, 0);
+    atomic_store(&thread->stop,  0);
+    atomic_store(&thread->queued, driver_queued(iface));
+
+    if ((err = pthread_create(&thread->thread, &attr, thread_main, iface)) != 0) {
+        errno = err;
+
+        goto error_pthread_create;
+    }
+
+    thread->started = 1;
+
+    (void)pthread_attr_destroy(&attr);
+
+    return 0;
+
+error_pthread_create:
+error_pthread_attr_setaffinity_np:
+    (void)pthread_attr_destroy(&attr);
+
+error_pthread_attr_init:
+    return -1;
+}
+
+void patty_ax25_if_thread_stop(patty_ax25_if *iface) {
+    patty_ax25_if_thread *thread = iface->thread;
+
+    if (thread == NULL || !thread->started) {
+        return;
+    }
+
+    atomic_store(&thread->stop, 1);
+
+    thread_wake(thread->wake_tx[1]);
+
+    (void)pthread_join(thread->thread, NULL);
+
+    thread->started = 0;
+}
+
+static void thread_destroy(patty_ax25_if *iface) {
+    patty_ax25_if_thread *thread = iface->thread;
+
+    patty_ax25_if_thread_stop(iface);
+
+    (void)close(thread->wake_tx[0]);
+    (void)close(thread->wake_tx[1]);
+    (void)close(thread->wake_rx[0]);
+    (void)close(thread->wake_rx[1]);
+
+    patty_ring_destroy(thread->tx);
+    patty_ring_destroy(thread->rx);
+
+    free(thread->scratch);
+    free(thread->tx_buf);
+    free(thread->rx_buf);
+    free(thread);
+
+    iface->thread = NULL;
+}
+
+static ssize_t thread_fill(patty_ax25_if *iface) {
+    patty_ax25_if_thread *thread = iface->thread;
+
+    if (atomic_load(&thread->state) == THREAD_RUNNING) {
+        thread_wake_clear(thread->wake_rx[0]);
+
+        return 1;
+    }
+
+    /*
+     * The I/O thread has exited; leave its final wakeup pending until all
+     * frames it received have been consumed
+     */
+    if (patty_ring_used(thread->rx) > 0) {
+        return 1;
+    }
+
+    errno = atomic_load(&thread->error);
+
+    return -1;
+}
+
+static ssize_t thread_drain(patty_ax25_if *iface, void *buf, size_t len) {
+    patty_ax25_if_thread *thread = iface->thread;
+
+    ssize_t ret;
+
+    if (thread->pending) {
+        return 0;
+    }
+
+    if ((ret = patty_ring_pop(thread->rx, buf, len)) < 0) {
+        thread->stats.dropped++;
+
+        return 1;
+    }
+
+    return thread->pending = ret;
+}
+
+static ssize_t thread_flush(patty_ax25_if *iface) {
+    ssize_t ret = iface->thread->pending;
+
+    iface->thread->pending = 0;
+
+    return ret;
+}
+
+static int thread_push(patty_ax25_if *iface,
+                       enum thread_record type,
+                       const void *buf,
+                       size_t len) {
+    patty_ax25_if_thread *thread = iface->thread;
+
+    if (len + 1 > thread->tx_bufsz) {
+        errno = EMSGSIZE;
+
+        goto error_toobig;
+    }
+
+    thread->scratch[0] = type;
+
+    memcpy(thread->scratch + 1, buf, len);
+
+    if (patty_ring_push(thread->tx, thread->scratch, len + 1) < 0) {
+        thread->stats.dropped++;
+    }
+
+    thread_wake(thread->wake_tx[1]);
+
+    return 0;
+
+error_toobig:
+    return -1;
+}
+
+static int thread_param_set(patty_ax25_if *iface,
+                            enum patty_ax25_if_param param,
+                            uint32_t value) {
+    uint8_t buf[1 + sizeof(value)];
+
+    buf[0] = param;
+
+    memcpy(buf + 1, &value, sizeof(value));
+
+    return thread_push(iface, THREAD_RECORD_PARAM, buf, sizeof(buf));
+}
+
+struct promisc {
+    enum patty_ax25_if_promisc_framing framing;
+
+    const patty_ax25_filter *filter;
+
+    /*
+     * Non-blocking encoder holding KISS frames the listener has yet to
+     * read; frames which do not fit are dropped
+     */
+    patty_kiss_tnc *tnc;
+
+    /*
+     * Frames dropped since the listener was last told of any, and whether a
+     * listener on a pty is told at all
+     */
+    uint32_t dropped;
+
+    int notices;
+};
+
+static void promisc_free(struct promisc *promisc) {
+    if (promisc->tnc) {
+        patty_kiss_tnc_destroy(promisc->tnc);
+    }
+
+    free(promisc);
+}
+
+static int destroy_promisc(uint32_t key, void *value, void *ctx) {
+    promisc_free(value);
+
+    return 0;
+}
+
 void patty_ax25_if_destroy(patty_ax25_if *iface) {
+    if (iface->thread) {
+        thread_destroy(iface);
+    }
+
     if (iface->driver->destroy) {
         iface->driver->destroy(iface->phy);
     }
 
+    if (iface->tap) {
+        patty_ax25_tap_destroy(iface->tap);
+    }
+
+    (void)patty_dict_each(iface->promisc_fds, destroy_promisc, NULL);
+
     patty_dict_destroy(iface->promisc_fds);
     patty_list_destroy(iface->aliases);
 
@@ -162,7 +822,7 @@ int patty_ax25_if_addr_add(patty_ax25_if *iface,
 
     memcpy(&alias->callsign, &addr->callsign, sizeof(alias->callsign));
 
-    addr->ssid = 0;
+    alias->ssid = 0;
 
     if ((patty_list_append(iface->aliases, alias)) == NULL) {
         goto error_list_append;
@@ -231,16 +891,38 @@ int patty_ax25_if_addr_match(patty_ax25_if *iface,
 }
 
 int patty_ax25_if_promisc_add(patty_ax25_if *iface,
-                              int fd) {
+                              int fd,
+                              enum patty_ax25_if_promisc_framing framing) {
+    struct promisc *promisc;
+
     if (patty_dict_get(iface->promisc_fds, (uint32_t)fd)) {
         errno = EEXIST;
 
         goto error_exists;
     }
 
+    if ((promisc = malloc(sizeof(*promisc))) == NULL) {
+        goto error_malloc_promisc;
+    }
+
+    memset(promisc, '\0', sizeof(*promisc));
+
+    promisc->framing = framing;
+
+    if (framing == PATTY_AX25_IF_PROMISC_KISS) {
+        patty_kiss_tnc_info info = {
+            .flags = PATTY_KISS_TNC_FD | PATTY_KISS_TNC_NONBLOCK,
+            .fd    = fd
+        };
+
+        if ((promisc->tnc = patty_kiss_tnc_new(&info)) == NULL) {
+            goto error_kiss_tnc_new;
+        }
+    }
+
     if (patty_dict_set(iface->promisc_fds,
                        (uint32_t)fd,
-                       NULL) == NULL) {
+                       promisc) == NULL) {
         errno = ENOMEM;
 
         goto error_dict_set;
@@ -249,72 +931,471 @@ int patty_ax25_if_promisc_add(patty_ax25_if *iface,
     return 0;
 
 error_dict_set:
+error_kiss_tnc_new:
+    promisc_free(promisc);
+
+error_malloc_promisc:
 error_exists:
     return -1;
 }
 
 int patty_ax25_if_promisc_delete(patty_ax25_if *iface,
                                  int fd) {
+    struct promisc *promisc;
+
+    if ((promisc = patty_dict_get(iface->promisc_fds, (uint32_t)fd)) == NULL) {
+        return 0;
+    }
+
+    promisc_free(promisc);
+
     return patty_dict_delete(iface->promisc_fds, (uint32_t)fd);
 }
 
+int patty_ax25_if_promisc_filter(patty_ax25_if *iface,
+                                 int fd,
+                                 const patty_ax25_filter *filter) {
+    struct promisc *promisc;
+
+    if ((promisc = patty_dict_get(iface->promisc_fds, (uint32_t)fd)) == NULL) {
+        errno = ENOENT;
+
+        return -1;
+    }
+
+    promisc->filter = filter;
+
+    return 0;
+}
+
+int patty_ax25_if_promisc_notices(patty_ax25_if *iface,
+                                  int fd,
+                                  int enable) {
+    struct promisc *promisc;
+
+    if ((promisc = patty_dict_get(iface->promisc_fds, (uint32_t)fd)) == NULL) {
+        errno = ENOENT;
+
+        return -1;
+    }
+
+    promisc->notices = enable;
+
+    return 0;
+}
+
+ssize_t patty_ax25_if_promisc_queued(patty_ax25_if *iface, int fd) {
+    struct promisc *promisc;
+
+    if ((promisc = patty_dict_get(iface->promisc_fds, (uint32_t)fd)) == NULL
+     || promisc->tnc == NULL) {
+        return 0;
+    }
+
+    return patty_kiss_tnc_queued(promisc->tnc);
+}
+
+ssize_t patty_ax25_if_promisc_transmit(patty_ax25_if *iface, int fd) {
+    struct promisc *promisc;
+
+    if ((promisc = patty_dict_get(iface->promisc_fds, (uint32_t)fd)) == NULL
+     || promisc->tnc == NULL) {
+        return 0;
+    }
+
+    return patty_kiss_tnc_transmit(promisc->tnc);
+}
+
 struct promisc_frame {
     const void *buf;
     size_t len;
     patty_ax25_if *iface;
 };
 
+/*
+ * Deliver a frame to a listener on a SOCK_SEQPACKET channel, whose socket
+ * buffer serves as its queue; a report of frames previously dropped is sent
+ * first, as a message too short to be a frame
+ */
+static int promisc_send_packet(int fd,
+                               struct promisc *promisc,
+                               const void *buf,
+                               size_t len) {
+    if (promisc->dropped) {
+        uint8_t notice[4] = {
+            (promisc->dropped >> 24) & 0xff,
+            (promisc->dropped >> 16) & 0xff,
+            (promisc->dropped >>  8) & 0xff,
+             promisc->dropped        & 0xff
+        };
+
+        if (send(fd, notice, sizeof(notice), MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+            goto error_send;
+        }
+
+        promisc->dropped = 0;
+    }
+
+    if (send(fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL) < 0) {
+        goto error_send;
+    }
+
+    return 0;
+
+error_send:
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS) {
+        promisc->dropped++;
+
+        return 0;
+    }
+
+    return -1;
+}
+
+/*
+ * Queue a frame for a listener on a pty, behind a report of frames dropped
+ * since the last one queued, for listeners which asked to be told
+ */
+static int promisc_send_kiss(struct promisc *promisc,
+                             const void *buf,
+                             size_t len) {
+    patty_ax25_if_stats *stats = patty_kiss_tnc_stats(promisc->tnc);
+
+    size_t dropped = stats->dropped;
+
+    if (promisc->dropped && promisc->notices) {
+        if (patty_kiss_tnc_send_dropped(promisc->tnc, promisc->dropped) < 0) {
+            goto error_send;
+        }
+
+        if (stats->dropped != dropped) {
+            stats->dropped = dropped;
+
+            goto drop;
+        }
+
+        promisc->dropped = 0;
+    }
+
+    if (patty_kiss_tnc_send(promisc->tnc, buf, len) < 0) {
+        goto error_send;
+    }
+
+    if (stats->dropped != dropped) {
+        stats->dropped = dropped;
+
+        goto drop;
+    }
+
+    return 0;
+
+drop:
+    promisc->dropped++;
+
+    return 0;
+
+error_send:
+    return -1;
+}
+
 static int handle_promisc_frame(uint32_t key,
                                 void *value,
                                 void *ctx) {
     int fd = (int)key;
+    struct promisc *promisc = value;
     struct promisc_frame *frame = ctx;
 
-    return patty_kiss_frame_send(fd, frame->buf, frame->len, 0);
+    /*
+     * Rejected frames are never encoded nor copied to the listener
+     */
+    if (promisc->filter
+     && !patty_ax25_filter_run(promisc->filter, frame->buf, frame->len)) {
+        return 0;
+    }
+
+    switch (promisc->framing) {
+        case PATTY_AX25_IF_PROMISC_PACKET:
+            return promisc_send_packet(fd, promisc, frame->buf, frame->len);
+
+        default:
+            break;
+    }
+
+    return promisc_send_kiss(promisc, frame->buf, frame->len);
+}
+
+patty_ax25_tap *patty_ax25_if_tap(patty_ax25_if *iface) {
+    if (iface->tap == NULL) {
+        size_t mtu = iface->mru > iface->mtu? iface->mru: iface->mtu;
+
+        iface->tap = patty_ax25_tap_new(PATTY_AX25_TAP_DEFAULT_SLOTS, mtu);
+    }
+
+    return iface->tap;
 }
 
 void patty_ax25_if_drop(patty_ax25_if *iface) {
-    iface->driver->stats(iface->phy)->dropped++;
+    if_stats(iface)->dropped++;
+}
+
+void patty_ax25_if_retry(patty_ax25_if *iface) {
+    if_stats(iface)->retries++;
+}
+
+int patty_ax25_if_param_set(patty_ax25_if *iface,
+                            enum patty_ax25_if_param param,
+                            uint32_t value) {
+    if (iface->driver->param_set == NULL) {
+        errno = ENOSYS;
+
+        goto error_nosys;
+    }
+
+    if (iface->thread) {
+        if (thread_param_set(iface, param, value) < 0) {
+            goto error_param_set;
+        }
+    } else if (iface->driver->param_set(iface->phy, param, value) < 0) {
+        goto error_param_set;
+    }
+
+    /*
+     * Have the adaptive channel access controller carry on from a value set
+     * by hand, rather than from its own last
+     */
+    if (param == PATTY_AX25_IF_PARAM_PERSIST) {
+        iface->adapt.persist = value;
+    } else if (param == PATTY_AX25_IF_PARAM_SLOT_TIME) {
+        iface->adapt.slot_time = value;
+    }
+
+    return 0;
+
+error_param_set:
+error_nosys:
+    return -1;
+}
+
+static void adapt_sample(patty_ax25_if *iface) {
+    patty_ax25_if_stats *stats = if_stats(iface);
+
+    iface->adapt.rx_frames = stats->rx_frames;
+    iface->adapt.tx_frames = stats->tx_frames;
+    iface->adapt.retries   = stats->retries;
+}
+
+int patty_ax25_if_adapt_start(patty_ax25_if *iface,
+                              uint32_t persist,
+                              uint32_t slot_time) {
+    if (iface->driver->param_set == NULL) {
+        errno = ENOSYS;
+
+        goto error_nosys;
+    }
+
+    iface->adapt.enabled   = 1;
+    iface->adapt.persist   = persist;
+    iface->adapt.slot_time = slot_time;
+
+    adapt_sample(iface);
+
+    patty_timer_init(&iface->adapt.timer, PATTY_AX25_IF_ADAPT_INTERVAL);
+    patty_timer_start(&iface->adapt.timer);
+
+    return 0;
+
+error_nosys:
+    return -1;
+}
+
+void patty_ax25_if_adapt_stop(patty_ax25_if *iface) {
+    iface->adapt.enabled = 0;
+
+    patty_timer_stop(&iface->adapt.timer);
+}
+
+int patty_ax25_if_adapt_tick(patty_ax25_if *iface,
+                             struct timespec *elapsed) {
+    patty_ax25_if_adapt *adapt = &iface->adapt;
+    patty_ax25_if_stats *stats;
+
+    size_t heard,
+           sent,
+           retries;
+
+    uint32_t persist,
+             slot_time;
+
+    if (!adapt->enabled || iface->status != PATTY_AX25_IF_UP) {
+        return 0;
+    }
+
+    patty_timer_tick(&adapt->timer, elapsed);
+
+    if (!patty_timer_expired(&adapt->timer)) {
+        return 0;
+    }
+
+    patty_timer_start(&adapt->timer);
+
+    stats   = if_stats(iface);
+    heard   = stats->rx_frames - adapt->rx_frames;
+    sent    = stats->tx_frames - adapt->tx_frames;
+    retries = stats->retries   - adapt->retries;
+
+    adapt_sample(iface);
+
+    persist   = adapt->persist;
+    slot_time = adapt->slot_time;
+
+    /*
+     * Retransmissions are taken as evidence of collisions; when more than one
+     * in four frames sent is a retry, or the channel is busy, back off by
+     * halving persistence and stretching the slot time.  Otherwise, on a
+     * quiet channel with no retries, recover gradually towards the maxima.
+     */
+    if (retries * 4 > sent
+     || heard * 1000 > PATTY_AX25_IF_ADAPT_BUSY * PATTY_AX25_IF_ADAPT_INTERVAL) {
+        persist >>= 1;
+        slot_time++;
+    } else if (retries == 0) {
+        persist += (persist >> 2) + 1;
+
+        if (slot_time > 0) {
+            slot_time--;
+        }
+    }
+
+    if (persist < PATTY_AX25_IF_ADAPT_PERSIST_MIN) {
+        persist = PATTY_AX25_IF_ADAPT_PERSIST_MIN;
+    } else if (persist > PATTY_AX25_IF_ADAPT_PERSIST_MAX) {
+        persist = PATTY_AX25_IF_ADAPT_PERSIST_MAX;
+    }
+
+    if (slot_time < PATTY_AX25_IF_ADAPT_SLOT_MIN) {
+        slot_time = PATTY_AX25_IF_ADAPT_SLOT_MIN;
+    } else if (slot_time > PATTY_AX25_IF_ADAPT_SLOT_MAX) {
+        slot_time = PATTY_AX25_IF_ADAPT_SLOT_MAX;
+    }
+
+    if (persist != adapt->persist) {
+        if (patty_ax25_if_param_set(iface,
+                                    PATTY_AX25_IF_PARAM_PERSIST,
+                                    persist) < 0) {
+            goto error_param_set;
+        }
+
+        adapt->persist = persist;
+    }
+
+    if (slot_time != adapt->slot_time) {
+        if (patty_ax25_if_param_set(iface,
+                                    PATTY_AX25_IF_PARAM_SLOT_TIME,
+                                    slot_time) < 0) {
+            goto error_param_set;
+        }
+
+        adapt->slot_time = slot_time;
+    }
+
+    return 0;
+
+error_param_set:
+    return -1;
 }
 
 int patty_ax25_if_fd(patty_ax25_if *iface) {
+    if (iface->thread) {
+        return iface->thread->wake_rx[0];
+    }
+
+    return iface->driver->fd(iface->phy);
+}
+
+int patty_ax25_if_phy_fd(patty_ax25_if *iface) {
     return iface->driver->fd(iface->phy);
 }
 
 int patty_ax25_if_ready(patty_ax25_if *iface, fd_set *fds) {
-    return iface->status == PATTY_AX25_IF_UP?
-           iface->driver->ready(iface->phy, fds): 0;
+    if (iface->status != PATTY_AX25_IF_UP) {
+        return 0;
+    }
+
+    if (iface->thread) {
+        return FD_ISSET(iface->thread->wake_rx[0], fds);
+    }
+
+    return iface->driver->ready(iface->phy, fds);
 }
 
 int patty_ax25_if_reset(patty_ax25_if *iface) {
     int ret;
 
+    /*
+     * The I/O thread of a threaded interface owns the PHY, and has exited by
+     * the time a reset is called for; reap it, reset the PHY, then start a
+     * new thread on it, which keeps the same wakeup descriptor
+     */
+    if (iface->thread) {
+        patty_ax25_if_thread_stop(iface);
+
+        thread_wake_clear(iface->thread->wake_rx[0]);
+        thread_wake_clear(iface->thread->wake_tx[0]);
+    }
+
     if ((ret = iface->driver->reset(iface->phy)) < 0) {
-        iface->status = PATTY_AX25_IF_ERROR;
-    } else {
-        iface->status = PATTY_AX25_IF_UP;
+        goto error_reset;
+    }
+
+    if (iface->thread) {
+        if (patty_ax25_if_thread_start(iface) < 0) {
+            goto error_thread_start;
+        }
+
+        ret = iface->thread->wake_rx[0];
     }
 
+    iface->status = PATTY_AX25_IF_UP;
+
     return ret;
+
+error_thread_start:
+error_reset:
+    iface->status = PATTY_AX25_IF_ERROR;
+
+    return -1;
 }
 
 ssize_t patty_ax25_if_fill(patty_ax25_if *iface) {
+    if (iface->thread) {
+        return thread_fill(iface);
+    }
+
     return iface->driver->fill(iface->phy);
 }
 
 ssize_t patty_ax25_if_drain(patty_ax25_if *iface, void *buf, size_t len) {
+    if (iface->thread) {
+        return thread_drain(iface, buf, len);
+    }
+
     return iface->driver->drain(iface->phy, buf, len);
 }
 
 int patty_ax25_if_pending(patty_ax25_if *iface) {
+    if (iface->thread) {
+        return iface->thread->pending > 0? 1: 0;
+    }
+
     return iface->driver->pending(iface->phy);
 }
 
 ssize_t patty_ax25_if_flush(patty_ax25_if *iface) {
-    ssize_t len = iface->driver->flush(iface->phy);
+    ssize_t len = iface->thread? thread_flush(iface):
+                                 iface->driver->flush(iface->phy);
 
     if (len > 0) {
-        patty_ax25_if_stats *stats = iface->driver->stats(iface->phy);
+        patty_ax25_if_stats *stats = if_stats(iface);
 
         struct promisc_frame frame = {
             .buf   = iface->rx_buf,
@@ -325,6 +1406,10 @@ ssize_t patty_ax25_if_flush(patty_ax25_if *iface) {
         stats->rx_frames++;
         stats->rx_bytes += len;
 
+        if (iface->tap) {
+            patty_ax25_tap_push(iface->tap, PATTY_AX25_TAP_RX, iface->rx_buf, len);
+        }
+
         if (patty_dict_each(iface->promisc_fds,
                             handle_promisc_frame,
                             &frame) < 0) {
@@ -362,21 +1447,64 @@ error_fill:
     return -1;
 }
 
+ssize_t patty_ax25_if_queued(patty_ax25_if *iface) {
+    if (iface->thread) {
+        patty_ax25_if_thread *thread = iface->thread;
+
+        size_t queued = patty_ring_used(thread->tx)
+                      + atomic_load(&thread->queued);
+
+        if (queued < PATTY_AX25_IF_QUEUE_HIGH) {
+            return queued;
+        }
+
+        /*
+         * Have the I/O thread wake this one once the queue drains, then
+         * look again, lest it have drained in the meantime unawares
+         */
+        atomic_store(&thread->drain_wait, 1);
+
+        return patty_ring_used(thread->tx) + atomic_load(&thread->queued);
+    }
+
+    return iface->driver->queued?
+           iface->driver->queued(iface->phy): 0;
+}
+
+ssize_t patty_ax25_if_transmit(patty_ax25_if *iface) {
+    if (iface->thread) {
+        return 0;
+    }
+
+    return iface->driver->transmit?
+           iface->driver->transmit(iface->phy): 0;
+}
+
 ssize_t patty_ax25_if_send(patty_ax25_if *iface, const void *buf, size_t len) {
     struct promisc_frame frame;
     patty_ax25_if_stats *stats;
 
     ssize_t wrlen;
 
-    if ((wrlen = iface->driver->send(iface->phy, buf, len)) < 0) {
+    if (iface->thread) {
+        if (thread_push(iface, THREAD_RECORD_FRAME, buf, len) < 0) {
+            goto error_driver_send;
+        }
+
+        wrlen = len;
+    } else if ((wrlen = iface->driver->send(iface->phy, buf, len)) < 0) {
         goto error_driver_send;
     }
 
-    stats = iface->driver->stats(iface->phy);
+    stats = if_stats(iface);
 
     stats->tx_frames++;
     stats->tx_bytes += wrlen;
 
+    if (iface->tap) {
+        patty_ax25_tap_push(iface->tap, PATTY_AX25_TAP_TX, buf, wrlen);
+    }
+
     frame.buf   = buf;
     frame.len   = wrlen;
     frame.iface = iface;
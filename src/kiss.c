@@ -33,13 +33,14 @@ static inline ssize_t write_start(int fd,
 static uint8_t escape_fend[2] = { PATTY_KISS_FESC, PATTY_KISS_TFEND };
 static uint8_t escape_fesc[2] = { PATTY_KISS_FESC, PATTY_KISS_TFESC };
 
-ssize_t patty_kiss_frame_send(int fd,
-                             const void *buf,
-                             size_t len,
-                             int port) {
+static ssize_t frame_send(int fd,
+                          enum patty_kiss_command command,
+                          const void *buf,
+                          size_t len,
+                          int port) {
     size_t i, start = 0, end = 0;
 
-    if (write_start(fd, PATTY_KISS_DATA, port) < 0) {
+    if (write_start(fd, command, port) < 0) {
         goto error_io;
     }
 
@@ -92,3 +93,33 @@ ssize_t patty_kiss_frame_send(int fd,
 error_io:
     return -1;
 }
+
+ssize_t patty_kiss_frame_send(int fd,
+                              const void *buf,
+                              size_t len,
+                              int port) {
+    return frame_send(fd, PATTY_KISS_DATA, buf, len, port);
+}
+
+ssize_t patty_kiss_command_send(int fd,
+                                enum patty_kiss_command command,
+                                uint8_t value,
+                                int port) {
+    if (command == PATTY_KISS_DATA || command == PATTY_KISS_RETURN) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    return frame_send(fd, command, &value, sizeof(value), port);
+
+error_invalid:
+    return -1;
+}
+
+ssize_t patty_kiss_hw_send(int fd,
+                           const void *buf,
+                           size_t len,
+                           int port) {
+    return frame_send(fd, PATTY_KISS_HW_SET, buf, len, port);
+}
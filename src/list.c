@@ -62,6 +62,7 @@ void *patty_list_append(patty_list *list, void *value) {
     }
 
     new->value = value;
+    new->prev  = list->last;
     new->next  = NULL;
 
     if (list->first == NULL) {
@@ -170,6 +171,39 @@ void *patty_list_splice(patty_list *list, off_t index) {
     return NULL;
 }
 
+size_t patty_list_remove(patty_list *list, void *value) {
+    patty_list_item *item = list->first;
+    size_t count = 0;
+
+    while (item) {
+        patty_list_item *next = item->next;
+
+        if (item->value == value) {
+            if (item->prev) {
+                item->prev->next = item->next;
+            } else {
+                list->first = item->next;
+            }
+
+            if (item->next) {
+                item->next->prev = item->prev;
+            } else {
+                list->last = item->prev;
+            }
+
+            list->length--;
+
+            free(item);
+
+            count++;
+        }
+
+        item = next;
+    }
+
+    return count;
+}
+
 void *patty_list_index(patty_list *list, off_t index) {
     patty_list_item *item = list->first;
     size_t i = 0;
@@ -0,0 +1,247 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <patty/ax25.h>
+#include <patty/hash.h>
+
+struct _patty_ax25_mheard {
+    uint32_t *hashes; /* zero if the slot is unused */
+    patty_ax25_mheard_entry *entries;
+    size_t mask;
+};
+
+patty_ax25_mheard *patty_ax25_mheard_new(size_t size) {
+    patty_ax25_mheard *mheard;
+    size_t slots = 1;
+
+    if (size == 0) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    while (slots < size) {
+        slots <<= 1;
+    }
+
+    if ((mheard = malloc(sizeof(*mheard))) == NULL) {
+        goto error_malloc_mheard;
+    }
+
+    if ((mheard->hashes = calloc(slots, sizeof(uint32_t))) == NULL) {
+        goto error_malloc_hashes;
+    }
+
+    if ((mheard->entries = calloc(slots, sizeof(patty_ax25_mheard_entry))) == NULL) {
+        goto error_malloc_entries;
+    }
+
+    mheard->mask = slots - 1;
+
+    return mheard;
+
+error_malloc_entries:
+    free(mheard->hashes);
+
+error_malloc_hashes:
+    free(mheard);
+
+error_malloc_mheard:
+error_invalid:
+    return NULL;
+}
+
+void patty_ax25_mheard_destroy(patty_ax25_mheard *mheard) {
+    free(mheard->entries);
+    free(mheard->hashes);
+    free(mheard);
+}
+
+static uint32_t station_hash(patty_ax25_addr *station) {
+    uint32_t hash;
+
+    patty_hash_init(&hash);
+    patty_ax25_addr_hash(&hash, station);
+    patty_hash_end(&hash);
+
+    /*
+     * Zero marks unused slots
+     */
+    return hash? hash: 1;
+}
+
+static inline int station_equal(patty_ax25_addr *a, patty_ax25_addr *b) {
+    return memcmp(a->callsign, b->callsign, sizeof(a->callsign)) == 0
+        && PATTY_AX25_ADDR_SSID_NUMBER(a->ssid)
+        == PATTY_AX25_ADDR_SSID_NUMBER(b->ssid);
+}
+
+static size_t find_slot(patty_ax25_mheard *mheard,
+                        uint32_t hash,
+                        patty_ax25_addr *station,
+                        int *found) {
+    size_t i,
+           victim = (hash & mheard->mask);
+
+    for (i=0; i<PATTY_AX25_MHEARD_PROBES; i++) {
+        size_t slot = (hash + i) & mheard->mask;
+
+        if (mheard->hashes[slot] == hash
+         && station_equal(&mheard->entries[slot].station, station)) {
+            *found = 1;
+
+            return slot;
+        }
+
+        if (mheard->hashes[victim] == 0) {
+            continue;
+        }
+
+        if (mheard->hashes[slot] == 0
+         || mheard->entries[slot].last < mheard->entries[victim].last) {
+            victim = slot;
+        }
+    }
+
+    *found = 0;
+
+    return victim;
+}
+
+/*
+ * Whether a repeater address is a generic alias, such as WIDEn-N or TRACEn-N,
+ * rather than the callsign of a station that can be routed by
+ */
+static int generic_alias(const patty_ax25_addr *addr) {
+    static const char *prefixes[] = { "WIDE", "TRACE", "RELAY", NULL };
+    char callsign[PATTY_AX25_CALLSTRLEN+1];
+    size_t i, len = 0;
+
+    for (i=0; i<PATTY_AX25_CALLSTRLEN; i++) {
+        char c = ((const uint8_t *)addr->callsign)[i] >> 1;
+
+        if (c == ' ') {
+            break;
+        }
+
+        callsign[len++] = c;
+    }
+
+    callsign[len] = '\0';
+
+    for (i=0; prefixes[i]; i++) {
+        size_t plen = strlen(prefixes[i]);
+
+        if (strncmp(callsign, prefixes[i], plen) != 0) {
+            continue;
+        }
+
+        if (len == plen
+         || (len == plen + 1 && callsign[plen] >= '1'
+                             && callsign[plen] <= '7')) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int patty_ax25_mheard_update(patty_ax25_mheard *mheard,
+                             patty_ax25_if *iface,
+                             patty_ax25_frame *frame,
+                             time_t now) {
+    uint32_t hash = station_hash(&frame->src);
+    patty_ax25_mheard_entry *entry;
+    patty_ax25_addr path[PATTY_AX25_MAX_HOPS];
+    unsigned int i, hops = 0;
+    size_t slot;
+    int found;
+
+    /*
+     * Only the repeaters which have already repeated the frame are part of
+     * the path it was heard by, and of those only the ones named by their
+     * own callsigns; a generic alias says nothing of which station repeated
+     * the frame, and cannot be used to reach it again
+     */
+    for (i=0; i<frame->hops && i<PATTY_AX25_MAX_HOPS; i++) {
+        if (!PATTY_AX25_ADDR_SSID_REPEATED(frame->repeaters[i].ssid)) {
+            break;
+        }
+
+        if (!generic_alias(&frame->repeaters[i])) {
+            memcpy(&path[hops++], &frame->repeaters[i], sizeof(path[0]));
+        }
+    }
+
+    slot  = find_slot(mheard, hash, &frame->src, &found);
+    entry = &mheard->entries[slot];
+
+    if (!found) {
+        memset(entry, '\0', sizeof(*entry));
+
+        memcpy(&entry->station, &frame->src, sizeof(entry->station));
+
+        mheard->hashes[slot] = hash;
+
+        entry->first = now;
+    } else if (entry->iface == iface
+            && hops > entry->hops
+            && now - entry->last < PATTY_AX25_MHEARD_PATH_AGE) {
+        /*
+         * Keep the shorter path heard recently on the same interface
+         */
+        entry->last = now;
+        entry->frames++;
+
+        return 0;
+    }
+
+    entry->iface = iface;
+    entry->last  = now;
+    entry->hops  = hops;
+    entry->frames++;
+
+    memcpy(entry->path, path, hops * sizeof(patty_ax25_addr));
+
+    return 0;
+}
+
+patty_ax25_mheard_entry *patty_ax25_mheard_find(patty_ax25_mheard *mheard,
+                                                patty_ax25_addr *station) {
+    size_t slot;
+    int found;
+
+    slot = find_slot(mheard, station_hash(station), station, &found);
+
+    return found? &mheard->entries[slot]: NULL;
+}
+
+void patty_ax25_mheard_forget_if(patty_ax25_mheard *mheard,
+                                 patty_ax25_if *iface) {
+    size_t i;
+
+    for (i=0; i<=mheard->mask; i++) {
+        if (mheard->hashes[i] && mheard->entries[i].iface == iface) {
+            mheard->hashes[i] = 0;
+        }
+    }
+}
+
+int patty_ax25_mheard_each(patty_ax25_mheard *mheard,
+                           int (*callback)(patty_ax25_mheard_entry *, void *),
+                           void *ctx) {
+    size_t i;
+
+    for (i=0; i<=mheard->mask; i++) {
+        if (mheard->hashes[i] == 0) {
+            continue;
+        }
+
+        if (callback(&mheard->entries[i], ctx) < 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
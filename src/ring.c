@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+
+#include <patty/ring.h>
+
+typedef uint32_t record_len;
+
+struct _patty_ring {
+    uint8_t *buf;
+    size_t size;
+
+    /*
+     * Free-running offsets; head is only written by the consumer, and tail
+     * only by the producer
+     */
+    atomic_size_t head,
+                  tail;
+};
+
+patty_ring *patty_ring_new(size_t size) {
+    patty_ring *ring;
+
+    size_t actual = 1;
+
+    /*
+     * Round up to a power of two, so that offsets may wrap freely
+     */
+    while (actual < size) {
+        actual <<= 1;
+    }
+
+    if ((ring = malloc(sizeof(*ring))) == NULL) {
+        goto error_malloc_ring;
+    }
+
+    if ((ring->buf = malloc(actual)) == NULL) {
+        goto error_malloc_buf;
+    }
+
+    ring->size = actual;
+
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+
+    return ring;
+
+error_malloc_buf:
+    free(ring);
+
+error_malloc_ring:
+    return NULL;
+}
+
+void patty_ring_destroy(patty_ring *ring) {
+    free(ring->buf);
+    free(ring);
+}
+
+size_t patty_ring_used(patty_ring *ring) {
+    return atomic_load_explicit(&ring->tail, memory_order_acquire)
+         - atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+static void copy_in(patty_ring *ring,
+                    size_t offset,
+                    const void *buf,
+                    size_t len) {
+    size_t start = offset & (ring->size - 1),
+           first = ring->size - start;
+
+    if (first > len) {
+        first = len;
+    }
+
+    memcpy(ring->buf + start, buf, first);
+    memcpy(ring->buf, (uint8_t *)buf + first, len - first);
+}
+
+static void copy_out(patty_ring *ring,
+                     size_t offset,
+                     void *buf,
+                     size_t len) {
+    size_t start = offset & (ring->size - 1),
+           first = ring->size - start;
+
+    if (first > len) {
+        first = len;
+    }
+
+    memcpy(buf, ring->buf + start, first);
+    memcpy((uint8_t *)buf + first, ring->buf, len - first);
+}
+
+int patty_ring_push(patty_ring *ring, const void *buf, size_t len) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed),
+           head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    record_len hdr = len;
+
+    if (sizeof(hdr) + len > ring->size - (tail - head)) {
+        errno = ENOBUFS;
+
+        goto error_full;
+    }
+
+    copy_in(ring, tail, &hdr, sizeof(hdr));
+    copy_in(ring, tail + sizeof(hdr), buf, len);
+
+    atomic_store_explicit(&ring->tail,
+                          tail + sizeof(hdr) + len,
+                          memory_order_release);
+
+    return 0;
+
+error_full:
+    return -1;
+}
+
+ssize_t patty_ring_pop(patty_ring *ring, void *buf, size_t len) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed),
+           tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    record_len hdr;
+
+    if (head == tail) {
+        return 0;
+    }
+
+    copy_out(ring, head, &hdr, sizeof(hdr));
+
+    if (hdr > len) {
+        atomic_store_explicit(&ring->head,
+                              head + sizeof(hdr) + hdr,
+                              memory_order_release);
+
+        errno = EOVERFLOW;
+
+        goto error_overflow;
+    }
+
+    copy_out(ring, head + sizeof(hdr), buf, hdr);
+
+    atomic_store_explicit(&ring->head,
+                          head + sizeof(hdr) + hdr,
+                          memory_order_release);
+
+    return hdr;
+
+error_overflow:
+    return -1;
+}
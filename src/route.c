@@ -27,16 +27,20 @@ patty_ax25_route *patty_ax25_route_new(patty_ax25_if *iface,
 
     memset(route, '\0', sizeof(*route));
 
-    route->iface = iface;
+    route->nexthops[0].iface  = iface;
+    route->nexthops[0].weight = 1;
+    route->n_nexthops         = 1;
 
     if (dest) {
         patty_ax25_addr_copy(&route->dest, dest, 0);
     }
 
     for (i=0; i<hops; i++) {
-        patty_ax25_addr_copy(&route->repeaters, &repeaters[i], 0);
+        patty_ax25_addr_copy(&route->repeaters[i], &repeaters[i], 0);
     }
 
+    route->hops = hops;
+
     return route;
 
 error_malloc_route:
@@ -47,6 +51,43 @@ error_max_hops:
 patty_ax25_route *patty_ax25_route_new_default(patty_ax25_if *iface) {
     return patty_ax25_route_new(iface, NULL, NULL, 0);
 }
+
+int patty_ax25_route_nexthop_add(patty_ax25_route *route,
+                                 patty_ax25_if *iface,
+                                 unsigned int weight) {
+    size_t i;
+
+    if (weight == 0) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    for (i=0; i<route->n_nexthops; i++) {
+        if (route->nexthops[i].iface == iface) {
+            route->nexthops[i].weight = weight;
+
+            return 0;
+        }
+    }
+
+    if (route->n_nexthops == PATTY_AX25_ROUTE_MAX_NEXTHOPS) {
+        errno = EOVERFLOW;
+
+        goto error_max_nexthops;
+    }
+
+    route->nexthops[i].iface  = iface;
+    route->nexthops[i].weight = weight;
+
+    route->n_nexthops++;
+
+    return 0;
+
+error_max_nexthops:
+error_invalid:
+    return -1;
+}
     
 patty_ax25_route_table *patty_ax25_route_table_new() {
     return patty_dict_new();
@@ -56,18 +97,22 @@ void patty_ax25_route_table_destroy(patty_ax25_route_table *table) {
     patty_dict_destroy(table);
 }
 
-patty_ax25_route *patty_ax25_route_table_find(patty_ax25_route_table *table,
-                                              patty_ax25_addr *dest) {
-    patty_ax25_route *route;
+patty_ax25_route *patty_ax25_route_table_get(patty_ax25_route_table *table,
+                                             patty_ax25_addr *dest) {
     uint32_t hash;
 
     patty_hash_init(&hash);
     patty_ax25_addr_hash(&hash, dest);
     patty_hash_end(&hash);
 
-    route = patty_dict_get(table, hash);
+    return patty_dict_get(table, hash);
+}
+
+patty_ax25_route *patty_ax25_route_table_find(patty_ax25_route_table *table,
+                                              patty_ax25_addr *dest) {
+    patty_ax25_route *route;
 
-    if (route) {
+    if ((route = patty_ax25_route_table_get(table, dest)) != NULL) {
         return route;
     }
 
@@ -118,7 +163,7 @@ int patty_ax25_route_table_add(patty_ax25_route_table *table,
     patty_ax25_addr_hash(&hash, &route->dest);
     patty_hash_end(&hash);
 
-    if (patty_ax25_route_table_find(table, &route->dest) != NULL) {
+    if (patty_ax25_route_table_get(table, &route->dest) != NULL) {
         errno = EEXIST;
 
         goto error_exists;
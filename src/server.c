@@ -17,10 +17,54 @@
 
 typedef int (*patty_ax25_server_call)(patty_ax25_server *, int);
 
+/*
+ * Maximum number of frames received from any one interface per event loop
+ * iteration; input left over is carried over to the next iteration
+ */
+#define RX_BUDGET 16
+
+/*
+ * Parameters last learned from the XID frames of a peer
+ */
+struct xid_entry {
+    patty_ax25_addr peer;
+    patty_ax25_params params;
+    time_t expires;
+};
+
+/*
+ * The interface a station was last heard on, as learned by the bridge
+ */
+struct bridge_entry {
+    patty_ax25_addr station;
+    patty_ax25_if *iface;
+    time_t expires;
+};
+
 typedef struct if_entry {
-    int fd;
+    int fd,
+        backlog;
+
     char name[10];
     patty_ax25_if *iface;
+
+    /*
+     * Interface to digipeat frames heard on this one out of, if any, and the
+     * greatest n of WIDEn-N hops to honour, or zero for none
+     */
+    patty_ax25_if *digi;
+    int digi_wide;
+
+    /*
+     * Whether frames heard on this interface are bridged to others
+     */
+    int bridged;
+
+    /*
+     * Whether raw sockets may set the channel access parameters of this
+     * interface
+     */
+    int param_allow;
 } if_entry;
 
 struct _patty_ax25_server {
@@ -30,9 +74,13 @@ struct _patty_ax25_server {
     struct timespec elapsed;
 
     fd_set fds_watch, /* fds to monitor with select() */
-           fds_r;     /* fds select()ed for reading */
+           fds_r,     /* fds select()ed for reading */
+           fds_w;     /* interface fds with output queued */
 
     patty_list *ifaces;
+    size_t if_next; /* interface to service first, for fairness */
+    int backlog;    /* number of interfaces with input left over */
+
     patty_ax25_route_table *routes;
 
     patty_dict *socks_by_fd,
@@ -42,6 +90,98 @@ struct _patty_ax25_server {
 
     patty_dict *clients,
                *clients_by_sock;
+
+    /*
+     * Identifier of the tagged request currently being handled, or -1
+     */
+    int64_t request;
+
+    /*
+     * Body of the framed request currently being handled, and the client
+     * whose batch of requests is being handled
+     */
+    const uint8_t *msg;
+    size_t msg_len,
+           msg_offset;
+
+    struct client *batch;
+
+    patty_dict *connects,    /* tagged connect requests, by sock fd */
+               *listeners,   /* accept queues of tagged listeners, by sock fd */
+               *subscribers, /* datagram socks subscribed to UI frames */
+               *held,        /* socks held back by a busy interface, by fd */
+               *groups;      /* socks sharing a listening address */
+
+    /*
+     * Limits on inbound links, the number of links open per peer address
+     * hash, and the tokens, in millionths, left for setting up new links
+     */
+    patty_ax25_server_limits limits;
+
+    patty_dict *peer_links;
+
+    uint64_t tokens;
+
+    /*
+     * XID parameters of peers by address hash, and the same entries from
+     * oldest to newest, along with the time on the monotonic clock
+     */
+    patty_dict *xid_cache;
+    patty_list *xid_order;
+
+    struct timespec now;
+
+    /*
+     * Fingerprints of frames recently digipeated, and of UI frames recently
+     * delivered to local sockets; either may be NULL when disabled
+     */
+    patty_ax25_dedup *dupes_digi,
+                     *dupes_ui;
+
+    /*
+     * Interfaces stations were last heard on, by address hash, and the same
+     * entries from oldest to newest, for bridging between interfaces, and
+     * fingerprints of frames recently bridged, by interface heard on
+     */
+    patty_dict *bridge;
+    patty_list *bridge_order;
+    patty_ax25_dedup *dupes_bridge;
+
+    /*
+     * Stations heard, and the interfaces and paths they were heard by
+     */
+    patty_ax25_mheard *mheard;
+};
+
+/*
+ * State of each client connection; clients sending framed requests have
+ * their input buffered until whole messages are available, and responses to
+ * each batch of messages are gathered into a single write
+ */
+struct client {
+    int fd,
+        framed,
+        last_sock;
+
+    uint8_t *rx_buf,
+            *tx_buf;
+
+    size_t rx_len,
+           tx_len;
+};
+
+/*
+ * Sockets listening on behalf of clients issuing tagged requests have their
+ * connections delivered over the control socket, in the order accept()
+ * requests are made; connections which arrive first wait in the ready queue.
+ * Datagram sockets likewise hold tagged recvfrom() requests until datagrams
+ * arrive for them.
+ */
+struct listener {
+    int client;
+
+    patty_list *requests,
+               *ready;
 };
 
 patty_ax25_server *patty_ax25_server_new() {
@@ -85,8 +225,103 @@ patty_ax25_server *patty_ax25_server_new() {
         goto error_dict_new_clients_by_sock;
     }
 
+    if ((server->connects = patty_dict_new()) == NULL) {
+        goto error_dict_new_connects;
+    }
+
+    if ((server->listeners = patty_dict_new()) == NULL) {
+        goto error_dict_new_listeners;
+    }
+
+    if ((server->subscribers = patty_dict_new()) == NULL) {
+        goto error_dict_new_subscribers;
+    }
+
+    if ((server->held = patty_dict_new()) == NULL) {
+        goto error_dict_new_held;
+    }
+
+    if ((server->groups = patty_dict_new()) == NULL) {
+        goto error_dict_new_groups;
+    }
+
+    if ((server->peer_links = patty_dict_new()) == NULL) {
+        goto error_dict_new_peer_links;
+    }
+
+    if ((server->xid_cache = patty_dict_new()) == NULL) {
+        goto error_dict_new_xid_cache;
+    }
+
+    if ((server->xid_order = patty_list_new()) == NULL) {
+        goto error_list_new_xid_order;
+    }
+
+    if ((server->dupes_digi = patty_ax25_dedup_new(PATTY_AX25_DEDUP_DEFAULT_SIZE,
+                                                   PATTY_AX25_DEDUP_DEFAULT_WINDOW)) == NULL) {
+        goto error_dedup_new_dupes_digi;
+    }
+
+    if ((server->bridge = patty_dict_new()) == NULL) {
+        goto error_dict_new_bridge;
+    }
+
+    if ((server->bridge_order = patty_list_new()) == NULL) {
+        goto error_list_new_bridge_order;
+    }
+
+    if ((server->dupes_bridge = patty_ax25_dedup_new(PATTY_AX25_DEDUP_DEFAULT_SIZE,
+                                                     PATTY_AX25_SERVER_BRIDGE_DEDUP_WINDOW)) == NULL) {
+        goto error_dedup_new_dupes_bridge;
+    }
+
+    if ((server->mheard = patty_ax25_mheard_new(PATTY_AX25_MHEARD_DEFAULT_SIZE)) == NULL) {
+        goto error_mheard_new;
+    }
+
+    server->request = -1;
+
     return server;
 
+error_mheard_new:
+    patty_ax25_dedup_destroy(server->dupes_bridge);
+
+error_dedup_new_dupes_bridge:
+    patty_list_destroy(server->bridge_order);
+
+error_list_new_bridge_order:
+    patty_dict_destroy(server->bridge);
+
+error_dict_new_bridge:
+    patty_ax25_dedup_destroy(server->dupes_digi);
+
+error_dedup_new_dupes_digi:
+    patty_list_destroy(server->xid_order);
+
+error_list_new_xid_order:
+    patty_dict_destroy(server->xid_cache);
+
+error_dict_new_xid_cache:
+    patty_dict_destroy(server->peer_links);
+
+error_dict_new_peer_links:
+    patty_dict_destroy(server->groups);
+
+error_dict_new_groups:
+    patty_dict_destroy(server->held);
+
+error_dict_new_held:
+    patty_dict_destroy(server->subscribers);
+
+error_dict_new_subscribers:
+    patty_dict_destroy(server->listeners);
+
+error_dict_new_listeners:
+    patty_dict_destroy(server->connects);
+
+error_dict_new_connects:
+    patty_dict_destroy(server->clients_by_sock);
+
 error_dict_new_clients_by_sock:
     patty_dict_destroy(server->clients);
 
@@ -115,6 +350,65 @@ error_malloc_server:
     return NULL;
 }
 
+int patty_ax25_server_limits_set(patty_ax25_server *server,
+                                 const patty_ax25_server_limits *limits) {
+    memcpy(&server->limits, limits, sizeof(server->limits));
+
+    if (server->limits.burst == 0) {
+        server->limits.burst = server->limits.rate;
+    }
+
+    server->tokens = (uint64_t)server->limits.burst * 1000000;
+
+    return 0;
+}
+
+static int dedup_replace(patty_ax25_dedup **dedup, time_t window) {
+    patty_ax25_dedup *replacement = NULL;
+
+    if (window > 0) {
+        if ((replacement = patty_ax25_dedup_new(PATTY_AX25_DEDUP_DEFAULT_SIZE,
+                                                window)) == NULL) {
+            goto error_dedup_new;
+        }
+    }
+
+    if (*dedup) {
+        patty_ax25_dedup_destroy(*dedup);
+    }
+
+    *dedup = replacement;
+
+    return 0;
+
+error_dedup_new:
+    return -1;
+}
+
+int patty_ax25_server_dedup_set(patty_ax25_server *server,
+                                time_t digi,
+                                time_t ui) {
+    if (digi < 0 || ui < 0) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    if (dedup_replace(&server->dupes_digi, digi) < 0) {
+        goto error_dedup_replace;
+    }
+
+    if (dedup_replace(&server->dupes_ui, ui) < 0) {
+        goto error_dedup_replace;
+    }
+
+    return 0;
+
+error_dedup_replace:
+error_invalid:
+    return -1;
+}
+
 static void destroy_ifaces(patty_list *ifaces) {
     patty_list_item *item = ifaces->first;
 
@@ -138,9 +432,95 @@ static int destroy_socks_by_client_entry(uint32_t key, void *value, void *ctx) {
     return 0;
 }
 
+static void listener_destroy(struct listener *listener) {
+    patty_list_destroy(listener->requests);
+    patty_list_destroy(listener->ready);
+
+    free(listener);
+}
+
+static int destroy_listeners_entry(uint32_t key, void *value, void *ctx) {
+    listener_destroy(value);
+
+    return 0;
+}
+
+static void destroy_xid_entry(void *value, void *ctx) {
+    free(value);
+}
+
+static void destroy_bridge_entry(void *value, void *ctx) {
+    free(value);
+}
+
+static int destroy_groups_entry(uint32_t key, void *value, void *ctx) {
+    patty_list_destroy(value);
+
+    return 0;
+}
+
+static struct client *client_new(int fd) {
+    struct client *client;
+
+    if ((client = malloc(sizeof(*client))) == NULL) {
+        goto error_malloc_client;
+    }
+
+    memset(client, '\0', sizeof(*client));
+
+    client->fd        = fd;
+    client->last_sock = -1;
+
+    return client;
+
+error_malloc_client:
+    return NULL;
+}
+
+static void client_destroy(struct client *client) {
+    free(client->rx_buf);
+    free(client->tx_buf);
+    free(client);
+}
+
+static int destroy_clients_entry(uint32_t key, void *value, void *ctx) {
+    client_destroy(value);
+
+    return 0;
+}
+
 void patty_ax25_server_destroy(patty_ax25_server *server) {
+    patty_ax25_mheard_destroy(server->mheard);
+
+    patty_ax25_dedup_destroy(server->dupes_bridge);
+    patty_list_each(server->bridge_order, destroy_bridge_entry, NULL);
+    patty_list_destroy(server->bridge_order);
+    patty_dict_destroy(server->bridge);
+
+    if (server->dupes_ui) {
+        patty_ax25_dedup_destroy(server->dupes_ui);
+    }
+
+    if (server->dupes_digi) {
+        patty_ax25_dedup_destroy(server->dupes_digi);
+    }
+
+    patty_list_each(server->xid_order, destroy_xid_entry, NULL);
+    patty_list_destroy(server->xid_order);
+    patty_dict_destroy(server->xid_cache);
+    patty_dict_destroy(server->peer_links);
+    patty_dict_each(server->groups, destroy_groups_entry, NULL);
+    patty_dict_destroy(server->groups);
+    patty_dict_destroy(server->held);
+    patty_dict_destroy(server->subscribers);
+    patty_dict_each(server->listeners, destroy_listeners_entry, NULL);
+    patty_dict_destroy(server->listeners);
+    patty_dict_destroy(server->connects);
+
     patty_dict_destroy(server->clients_by_sock);
+    patty_dict_each(server->clients, destroy_clients_entry, NULL);
     patty_dict_destroy(server->clients);
+
     patty_dict_destroy(server->socks_remote);
     patty_dict_destroy(server->socks_local);
     patty_dict_each(server->socks_by_client, destroy_socks_by_client_entry, NULL);
@@ -167,13 +547,15 @@ static inline void fd_clear(patty_ax25_server *server, int fd) {
     FD_CLR(fd, &server->fds_watch);
 
     if (server->fd_max == fd + 1) {
-        for (i=0; i<8*sizeof(&server->fds_watch); i++) {
+        server->fd_max = 0;
+
+        for (i=fd; i--;) {
             if (FD_ISSET(i, &server->fds_watch)) {
-                server->fd_max = i;
+                server->fd_max = i + 1;
+
+                break;
             }
         }
-
-        server->fd_max++;
     }
 }
 
@@ -193,9 +575,8 @@ static patty_ax25_sock *sock_by_addr(patty_dict *dict,
     return patty_dict_get(dict, hash);
 }
 
-static patty_ax25_sock *sock_by_addrpair(patty_dict *dict,
-                                         patty_ax25_addr *local,
-                                         patty_ax25_addr *remote) {
+static inline uint32_t hash_addrpair(patty_ax25_addr *local,
+                                     patty_ax25_addr *remote) {
     uint32_t hash;
 
     patty_hash_init(&hash);
@@ -203,7 +584,14 @@ static patty_ax25_sock *sock_by_addrpair(patty_dict *dict,
     patty_ax25_addr_hash(&hash, remote);
     patty_hash_end(&hash);
 
-    return patty_dict_get(dict, hash);
+    return hash;
+}
+
+static patty_ax25_sock *sock_by_addrpair(patty_ax25_server *server,
+                                         patty_ax25_addr *local,
+                                         patty_ax25_addr *remote) {
+    return patty_dict_get(server->socks_remote,
+                          hash_addrpair(local, remote));
 }
 
 static int sock_save_by_fd(patty_dict *dict, patty_ax25_sock *sock) {
@@ -237,7 +625,7 @@ static inline int client_save_by_sock(patty_ax25_server *server,
                                       patty_ax25_sock *sock) {
     if (patty_dict_set(server->clients_by_sock,
                        (uint32_t)sock->fd,
-                       NULL + client) == NULL) {
+                       (void *)(intptr_t)client) == NULL) {
         goto error_dict_set;
     }
 
@@ -263,18 +651,6 @@ static inline uint32_t hash_addr(patty_ax25_addr *addr) {
     return hash;
 }
 
-static inline uint32_t hash_addrpair(patty_ax25_addr *local,
-                                     patty_ax25_addr *remote) {
-    uint32_t hash;
-
-    patty_hash_init(&hash);
-    patty_ax25_addr_hash(&hash, local);
-    patty_ax25_addr_hash(&hash, remote);
-    patty_hash_end(&hash);
-
-    return hash;
-}
-
 static int sock_save_local(patty_ax25_server *server,
                            patty_ax25_sock *sock) {
     uint32_t hash = hash_addr(&sock->local);
@@ -303,438 +679,1861 @@ static int sock_delete_remote(patty_ax25_server *server,
     return patty_dict_delete(server->socks_remote, hash);
 }
 
-static int sock_shutdown(patty_ax25_server *server,
-                         patty_ax25_sock *sock) {
-    fd_clear(server, sock->fd);
+static inline int addr_equal(const patty_ax25_addr *a,
+                             const patty_ax25_addr *b) {
+    return memcmp(a->callsign, b->callsign, sizeof(a->callsign)) == 0
+        && PATTY_AX25_ADDR_SSID_NUMBER(a->ssid)
+        == PATTY_AX25_ADDR_SSID_NUMBER(b->ssid);
+}
 
-    if (sock->type != PATTY_AX25_SOCK_STREAM) {
-        return 0;
-    }
+/*
+ * Listening sockets sharing a local address by way of PATTY_AX25_SOCK_REUSE
+ * are grouped by the hash of that address, while socks_local holds whichever
+ * of them has been listening the longest
+ */
+static patty_list *group_get(patty_ax25_server *server,
+                             patty_ax25_addr *addr) {
+    patty_list *group;
+    patty_ax25_sock *first;
 
-    if (sock->state != PATTY_AX25_SOCK_ESTABLISHED) {
-        return 0;
+    if ((group = patty_dict_get(server->groups, hash_addr(addr))) == NULL
+     || group->first == NULL) {
+        return group;
     }
 
-    sock->state   = PATTY_AX25_SOCK_PENDING_DISCONNECT;
-    sock->retries = sock->n_retry;
-
-    patty_timer_start(&sock->timer_t1);
+    first = group->first->value;
 
-    return patty_ax25_sock_send_disc(sock, PATTY_AX25_FRAME_POLL);
+    return addr_equal(&first->local, addr)? group: NULL;
 }
 
-static int sock_save(patty_ax25_server *server,
-                     int client,
-                     patty_ax25_sock *sock) {
-    patty_dict *socks;
-
-    switch (sock->state) {
-        case PATTY_AX25_SOCK_LISTENING:
-            if (sock_save_local(server, sock) < 0) {
-                goto error_sock_save_local;
-            }
-
-            break;
-
-        case PATTY_AX25_SOCK_PENDING_ACCEPT:
-        case PATTY_AX25_SOCK_PENDING_CONNECT:
-        case PATTY_AX25_SOCK_ESTABLISHED:
-            if (sock_save_remote(server, sock) < 0) {
-                goto error_sock_save_remote;
-            }
+static int group_join(patty_ax25_server *server,
+                      patty_ax25_sock *sock) {
+    uint32_t hash = hash_addr(&sock->local);
+    patty_list *group;
+    patty_list_item *item;
 
-            break;
+    if ((group = group_get(server, &sock->local)) == NULL) {
+        if ((group = patty_list_new()) == NULL) {
+            goto error_list_new;
+        }
 
-        case PATTY_AX25_SOCK_PENDING_DISCONNECT:
-        case PATTY_AX25_SOCK_CLOSED:
-        case PATTY_AX25_SOCK_PROMISC:
-            break;
+        if (patty_dict_set(server->groups, hash, group) == NULL) {
+            goto error_dict_set;
+        }
     }
 
-    if (client_save_by_sock(server, client, sock) < 0) {
-        goto error_client_save_by_sock;
+    for (item = group->first; item; item = item->next) {
+        if (item->value == sock) {
+            return 0;
+        }
     }
 
-    if ((socks = patty_dict_get(server->socks_by_client, client)) == NULL) {
-        goto error_dict_get_socks_by_client;
+    if (patty_list_append(group, sock) == NULL) {
+        goto error_list_append;
     }
 
-    if (sock_save_by_fd(socks, sock) < 0) {
-        goto error_sock_save_by_fd;
+    if (sock_by_addr(server->socks_local, &sock->local) == NULL) {
+        return sock_save_local(server, sock);
     }
 
-    return sock_save_by_fd(server->socks_by_fd, sock);
+    return 0;
 
-error_sock_save_by_fd:
-error_dict_get_socks_by_client:
-error_client_save_by_sock:
-error_sock_save_remote:
-error_sock_save_local:
+error_dict_set:
+    patty_list_destroy(group);
+
+error_list_new:
+error_list_append:
     return -1;
 }
 
-static int sock_close(patty_ax25_server *server,
-                      patty_ax25_sock *sock) {
-    int client;
-    patty_dict *socks;
+static int group_leave(patty_ax25_server *server,
+                       patty_ax25_sock *sock) {
+    patty_list *group;
 
-    switch (sock->state) {
-        case PATTY_AX25_SOCK_LISTENING:
-            if (sock_delete_local(server, sock) < 0) {
-                goto error_sock_delete_local;
-            }
+    if ((group = group_get(server, &sock->local)) == NULL) {
+        return sock_delete_local(server, sock);
+    }
 
-            break;
+    (void)patty_list_remove(group, sock);
 
-        case PATTY_AX25_SOCK_PENDING_ACCEPT:
-        case PATTY_AX25_SOCK_PENDING_CONNECT:
-        case PATTY_AX25_SOCK_PENDING_DISCONNECT:
-        case PATTY_AX25_SOCK_ESTABLISHED:
-            if (sock_delete_remote(server, sock) < 0) {
-                goto error_sock_delete_remote;
-            }
+    if (patty_list_length(group) == 0) {
+        (void)patty_dict_delete(server->groups, hash_addr(&sock->local));
 
-            break;
+        patty_list_destroy(group);
 
-        case PATTY_AX25_SOCK_CLOSED:
-        case PATTY_AX25_SOCK_PROMISC:
-            break;
+        return sock_delete_local(server, sock);
     }
 
-    if ((client = client_by_sock(server, sock)) < 0) {
-        goto error_client_by_sock;
+    if (sock_by_addr(server->socks_local, &sock->local) == sock) {
+        return sock_save_local(server, group->first->value);
     }
 
-    if ((socks = patty_dict_get(server->socks_by_client, client)) == NULL) {
-        goto error_dict_get_socks_by_client;
-    }
+    return 0;
+}
 
-    if (patty_dict_delete(socks, (uint32_t)sock->fd) < 0) {
-        goto error_dict_delete_by_fd_socks;
+static int count_socks_entry(uint32_t key, void *value, void *ctx) {
+    size_t *count = ctx;
+
+    (*count)++;
+
+    return 0;
+}
+
+static int group_member_full(patty_ax25_server *server,
+                             patty_ax25_sock *sock) {
+    struct listener *listener;
+
+    if ((listener = patty_dict_get(server->listeners,
+                                   (uint32_t)sock->fd)) == NULL) {
+        return 0;
     }
 
-    if (patty_dict_delete(server->socks_by_fd, (uint32_t)sock->fd) < 0) {
-        goto error_dict_delete_by_fd_socks_by_fd;
+    return patty_list_length(listener->ready) >= (size_t)sock->backlog;
+}
+
+/*
+ * Choose the member of the group listening on the address of local to take
+ * a connection from peer, passing over members whose backlog is full; a
+ * connection already begun by an XID exchange stays with the client it was
+ * handed to then
+ */
+static patty_ax25_sock *group_select(patty_ax25_server *server,
+                                     patty_ax25_sock *local,
+                                     patty_ax25_addr *peer,
+                                     patty_ax25_sock *remote) {
+    patty_list *group;
+    patty_list_item *item;
+
+    patty_ax25_sock *best = local;
+    size_t best_load = SIZE_MAX;
+
+    if (local->reuse == PATTY_AX25_SOCK_REUSE_NONE
+     || (group = group_get(server, &local->local)) == NULL
+     || patty_list_length(group) == 0) {
+        return local;
+    }
+
+    if (remote != NULL) {
+        int client = client_by_sock(server, remote);
+
+        for (item = group->first; item; item = item->next) {
+            if (client_by_sock(server, item->value) == client) {
+                return item->value;
+            }
+        }
+
+        return local;
     }
 
-    (void)client_delete_by_sock(server, sock);
+    if (local->reuse == PATTY_AX25_SOCK_REUSE_HASH) {
+        size_t length = patty_list_length(group),
+               start  = hash_addr(peer) % length,
+               i;
 
-    fd_clear(server, sock->fd);
+        for (i=0; i<length; i++) {
+            patty_ax25_sock *sock = patty_list_index(group,
+                                                     (start + i) % length);
 
-    patty_ax25_sock_destroy(sock);
+            if (!group_member_full(server, sock)) {
+                return sock;
+            }
+        }
 
-    return 0;
+        return local;
+    }
 
-error_dict_delete_by_fd_socks_by_fd:
-error_dict_delete_by_fd_socks:
-error_dict_get_socks_by_client:
-error_client_by_sock:
-error_sock_delete_remote:
-error_sock_delete_local:
-    return -1;
-}
+    for (item = group->first; item; item = item->next) {
+        patty_ax25_sock *sock = item->value;
+        patty_dict *socks;
+        size_t load = 0;
 
-static inline void sock_flow_stop(patty_ax25_server *server,
-                                  patty_ax25_sock *sock) {
-    fd_clear(server, sock->fd);
+        if (group_member_full(server, sock)) {
+            continue;
+        }
 
-    sock->flow = PATTY_AX25_SOCK_WAIT;
+        if ((socks = patty_dict_get(server->socks_by_client,
+                                    client_by_sock(server, sock))) != NULL) {
+            (void)patty_dict_each(socks, count_socks_entry, &load);
+        }
+
+        if (load < best_load) {
+            best      = sock;
+            best_load = load;
+        }
+    }
+
+    return best;
 }
 
-static inline void sock_flow_start(patty_ax25_server *server,
-                                   patty_ax25_sock *sock) {
-    fd_watch(server, sock->fd);
+static inline size_t peer_links(patty_ax25_server *server,
+                                patty_ax25_addr *peer) {
+    return (size_t)((intptr_t)patty_dict_get(server->peer_links,
+                                             hash_addr(peer)));
 }
 
-int patty_ax25_server_if_add(patty_ax25_server *server,
-                             patty_ax25_if *iface,
-                             const char *name) {
-    struct if_entry *entry;
+/*
+ * Determine whether a SABM or XID frame from peer may set up a new link to
+ * the listening socket local, taking a token if so; frames refused here are
+ * answered with DM without anything having been allocated for them
+ */
+static int link_admit(patty_ax25_server *server,
+                      patty_ax25_sock *local,
+                      patty_ax25_addr *peer) {
+    if (server->limits.links && local->links >= server->limits.links) {
+        return 0;
+    }
 
-    if ((entry = malloc(sizeof(*entry))) == NULL) {
-        goto error_malloc_entry;
+    if (server->limits.peer_links
+     && peer_links(server, peer) >= server->limits.peer_links) {
+        return 0;
     }
 
-    if ((entry->fd = patty_ax25_if_fd(iface)) < 0) {
-        goto error_if_fd;
+    if (server->limits.rate) {
+        if (server->tokens < 1000000) {
+            return 0;
+        }
+
+        server->tokens -= 1000000;
     }
 
-    patty_strlcpy(entry->name, name, sizeof(entry->name));
+    return 1;
+}
 
-    entry->iface = iface;
+static void tokens_tick(patty_ax25_server *server) {
+    int64_t us   = (int64_t)server->elapsed.tv_sec * 1000000
+                 + (int64_t)server->elapsed.tv_nsec / 1000;
+    uint64_t max = (uint64_t)server->limits.burst * 1000000;
 
-    if (patty_list_append(server->ifaces, entry) == NULL) {
-        goto error_list_append;
+    if (server->limits.rate == 0 || us <= 0) {
+        return;
     }
 
-    fd_watch(server, entry->fd);
+    server->tokens += (uint64_t)us * server->limits.rate;
 
-    return 0;
+    if (server->tokens > max) {
+        server->tokens = max;
+    }
+}
 
-error_list_append:
-error_if_fd:
-    free(entry);
+/*
+ * Count a newly set up link against the listening socket which admitted it,
+ * and against its peer
+ */
+static int link_open(patty_ax25_server *server,
+                     patty_ax25_sock *local,
+                     patty_ax25_sock *remote) {
+    if (patty_dict_set(server->peer_links,
+                       hash_addr(&remote->remote),
+                       (void *)(intptr_t)(peer_links(server, &remote->remote) + 1)) == NULL) {
+        goto error_dict_set;
+    }
 
-error_malloc_entry:
+    local->links++;
+
+    remote->listener = local;
+    remote->admitted = 1;
+
+    return 0;
+
+error_dict_set:
     return -1;
 }
 
-int patty_ax25_server_if_delete(patty_ax25_server *server,
-                                const char *ifname) {
-    patty_list_item *item = server->ifaces->first;
-
-    int i = 0;
+static void link_close(patty_ax25_server *server,
+                       patty_ax25_sock *sock) {
+    size_t count;
 
-    while (item) {
-        struct if_entry *entry = item->value;
+    if (!sock->admitted) {
+        return;
+    }
 
-        if (strncmp(entry->name, ifname, sizeof(entry->name)) == 0) {
-            fd_clear(server, entry->fd);
+    if (sock->listener) {
+        sock->listener->links--;
+    }
 
-            if (patty_list_splice(server->ifaces, i) == NULL) {
-                goto error_list_splice;
-            }
+    if ((count = peer_links(server, &sock->remote)) > 1) {
+        (void)patty_dict_set(server->peer_links,
+                             hash_addr(&sock->remote),
+                             (void *)(intptr_t)(count - 1));
+    } else {
+        (void)patty_dict_delete(server->peer_links, hash_addr(&sock->remote));
+    }
 
-            free(entry);
+    sock->listener = NULL;
+    sock->admitted = 0;
+}
 
-            return 0;
-        }
+static int orphan_link_entry(uint32_t key, void *value, void *ctx) {
+    patty_ax25_sock *sock = value;
 
-        item = item->next;
-        i++;
+    if (sock->listener == ctx) {
+        sock->listener = NULL;
     }
 
     return 0;
+}
 
-error_list_splice:
-    return -1;
+static struct xid_entry *xid_cache_get(patty_ax25_server *server,
+                                       patty_ax25_addr *peer) {
+    struct xid_entry *entry;
+
+    if ((entry = patty_dict_get(server->xid_cache, hash_addr(peer))) == NULL) {
+        return NULL;
+    }
+
+    if (!addr_equal(&entry->peer, peer)
+     || entry->expires <= server->now.tv_sec) {
+        return NULL;
+    }
+
+    return entry;
 }
 
-patty_ax25_if *patty_ax25_server_if_get(patty_ax25_server *server,
-                                        const char *name) {
-    patty_list_item *item = server->ifaces->first;
+/*
+ * Remember the parameters a peer gave in an XID frame; once the cache is
+ * full, the entry made longest ago is evicted
+ */
+static int xid_cache_put(patty_ax25_server *server,
+                         patty_ax25_addr *peer,
+                         patty_ax25_params *params) {
+    uint32_t hash = hash_addr(peer);
+    struct xid_entry *entry;
 
-    while (item) {
-        struct if_entry *entry = item->value;
+    if ((entry = patty_dict_get(server->xid_cache, hash)) != NULL
+     && addr_equal(&entry->peer, peer)) {
+        memcpy(&entry->params, params, sizeof(entry->params));
 
-        if (strncmp(entry->name, name, sizeof(entry->name)) == 0) {
-            return entry->iface;
+        entry->expires = server->now.tv_sec + PATTY_AX25_SERVER_XID_CACHE_TTL;
+
+        return 0;
+    }
+
+    if (patty_list_length(server->xid_order) >= PATTY_AX25_SERVER_XID_CACHE_MAX) {
+        struct xid_entry *oldest = patty_list_shift(server->xid_order);
+
+        if (patty_dict_get(server->xid_cache, hash_addr(&oldest->peer)) == oldest) {
+            (void)patty_dict_delete(server->xid_cache, hash_addr(&oldest->peer));
         }
 
-        item = item->next;
+        free(oldest);
     }
 
-    return NULL;
-}
+    if ((entry = malloc(sizeof(*entry))) == NULL) {
+        goto error_malloc_entry;
+    }
 
-int patty_ax25_server_if_each(patty_ax25_server *server,
-                              int (*callback)(char *, patty_ax25_if *, void *),
-                              void *ctx) {
-    patty_list_item *item = server->ifaces->first;
+    memcpy(&entry->peer,   peer,   sizeof(entry->peer));
+    memcpy(&entry->params, params, sizeof(entry->params));
 
-    while (item) {
-        struct if_entry *entry = item->value;
+    entry->expires = server->now.tv_sec + PATTY_AX25_SERVER_XID_CACHE_TTL;
 
-        if (callback(entry->name, entry->iface, ctx) < 0) {
-            goto error_callback;
-        }
+    if (patty_list_append(server->xid_order, entry) == NULL) {
+        goto error_list_append;
+    }
 
-        item = item->next;
+    if (patty_dict_set(server->xid_cache, hash, entry) == NULL) {
+        goto error_dict_set;
     }
 
     return 0;
 
-error_callback:
+error_dict_set:
+    /*
+     * The entry is freed once evicted from the list
+     */
+    entry->expires = 0;
+
+    return -1;
+
+error_list_append:
+    free(entry);
+
+error_malloc_entry:
     return -1;
 }
 
-int patty_ax25_server_route_add(patty_ax25_server *server,
-                                patty_ax25_route *route) {
-    return patty_ax25_route_table_add(server->routes, route);
+/*
+ * Entries are only ever freed upon eviction, so one which has proven wrong is
+ * simply made to expire
+ */
+static void xid_cache_forget(patty_ax25_server *server,
+                             patty_ax25_addr *peer) {
+    struct xid_entry *entry;
+
+    if ((entry = xid_cache_get(server, peer)) != NULL) {
+        entry->expires = 0;
+    }
 }
 
-int patty_ax25_server_route_delete(patty_ax25_server *server,
-                                   patty_ax25_addr *dest) {
-    return patty_ax25_route_table_delete(server->routes, dest);
+/*
+ * Begin an outbound connection with an XID exchange, to negotiate AX.25
+ * v2.2 and its parameters from scratch
+ */
+static int connect_xid(patty_ax25_server *server,
+                       patty_ax25_sock *sock) {
+    sock->xid_cached = 0;
+
+    if (patty_ax25_sock_send_xid(sock, PATTY_AX25_FRAME_COMMAND) < 0) {
+        return -1;
+    }
+
+    /*
+     * At this point, we will wait for a DM, FRMR or XID response, which will
+     * help us determine what version of AX.25 to apply for this socket, or
+     * whether the peer is not accepting connections.
+     */
+    sock->retries = sock->n_retry;
+
+    patty_timer_start(&sock->timer_t1);
+
+    return 0;
 }
 
-patty_ax25_route *patty_ax25_server_route_find(patty_ax25_server *server,
-                                               patty_ax25_addr *dest) {
-    return patty_ax25_route_table_find(server->routes, dest);
+/*
+ * Begin an outbound connection to a peer whose parameters are remembered
+ * from an earlier XID exchange straight away with SABM or SABME; lacking an
+ * XID frame from us, the peer will assume the defaults for the mode chosen,
+ * so the remembered parameters serve only to choose the mode
+ */
+static int connect_cached(patty_ax25_server *server,
+                          patty_ax25_sock *sock,
+                          struct xid_entry *entry) {
+    if (entry->params.hdlc & PATTY_AX25_PARAM_HDLC_MODULO_128) {
+        patty_ax25_sock_params_upgrade(sock);
+
+        sock->mode = PATTY_AX25_SOCK_SABME;
+    }
+
+    sock->xid_cached = 1;
+    sock->retries    = sock->n_retry;
+
+    patty_timer_start(&sock->timer_t1);
+
+    return patty_ax25_sock_send_sabm(sock, PATTY_AX25_FRAME_POLL);
 }
 
-patty_ax25_route *patty_ax25_server_route_default(patty_ax25_server *server) {
-    return patty_ax25_route_table_default(server->routes);
+/*
+ * A connection begun with remembered parameters which the peer refuses
+ * falls back to negotiating them afresh
+ */
+static int connect_renegotiate(patty_ax25_server *server,
+                               patty_ax25_sock *sock) {
+    xid_cache_forget(server, &sock->remote);
+
+    patty_ax25_sock_init(sock);
+
+    sock->state      = PATTY_AX25_SOCK_PENDING_CONNECT;
+    sock->version    = PATTY_AX25_2_0;
+    sock->flags_hdlc = PATTY_AX25_SOCK_DEFAULT_HDLC;
+
+    return connect_xid(server, sock);
 }
 
-int patty_ax25_server_route_each(patty_ax25_server *server,
-                                 int (*callback)(patty_ax25_route *, void *),
-                                 void *ctx) {
-    return patty_ax25_route_table_each(server->routes, callback, ctx);
+/*
+ * A connection begun with remembered parameters which the peer ignores until
+ * T1 expires is retried with SABM and the AX.25 v2.0 defaults, as the peer
+ * may no longer be the station it once was; the parameters are forgotten
+ */
+static void connect_fallback(patty_ax25_server *server,
+                             patty_ax25_sock *sock) {
+    xid_cache_forget(server, &sock->remote);
+
+    sock->xid_cached  = 0;
+    sock->mode        = PATTY_AX25_SOCK_SABM;
+    sock->version     = PATTY_AX25_2_0;
+    sock->flags_hdlc  = PATTY_AX25_SOCK_DEFAULT_HDLC;
+    sock->n_maxlen_tx = PATTY_AX25_SOCK_DEFAULT_I_LEN;
+    sock->n_maxlen_rx = PATTY_AX25_SOCK_DEFAULT_I_LEN;
+    sock->n_window_tx = PATTY_AX25_SOCK_DEFAULT_WINDOW;
+    sock->n_window_rx = PATTY_AX25_SOCK_DEFAULT_WINDOW;
 }
 
-static int respond_accept(int client,
-                          int ret,
-                          int eno) {
-    patty_client_accept_response response = {
-        .ret = ret,
-        .eno = eno
-    };
+static int sock_shutdown(patty_ax25_server *server,
+                         patty_ax25_sock *sock) {
+    fd_clear(server, sock->fd);
+
+    if (sock->type != PATTY_AX25_SOCK_STREAM) {
+        return 0;
+    }
+
+    if (sock->state != PATTY_AX25_SOCK_ESTABLISHED) {
+        return 0;
+    }
+
+    sock->state   = PATTY_AX25_SOCK_PENDING_DISCONNECT;
+    sock->retries = sock->n_retry;
 
-    return write(client, &response, sizeof(response));
+    patty_timer_start(&sock->timer_t1);
+
+    return patty_ax25_sock_send_disc(sock, PATTY_AX25_FRAME_POLL);
 }
 
-static int notify_accept(int local,
-                         int remote,
-                         patty_ax25_addr *peer,
-                         char *path) {
-    patty_client_accept_message message;
+static int sock_save(patty_ax25_server *server,
+                     int client,
+                     patty_ax25_sock *sock) {
+    patty_dict *socks;
+
+    switch (sock->state) {
+        case PATTY_AX25_SOCK_LISTENING:
+            if (sock_save_local(server, sock) < 0) {
+                goto error_sock_save_local;
+            }
+
+            break;
+
+        case PATTY_AX25_SOCK_PENDING_ACCEPT:
+        case PATTY_AX25_SOCK_PENDING_CONNECT:
+        case PATTY_AX25_SOCK_ESTABLISHED:
+            if (sock_save_remote(server, sock) < 0) {
+                goto error_sock_save_remote;
+            }
+
+            break;
+
+        case PATTY_AX25_SOCK_PENDING_DISCONNECT:
+        case PATTY_AX25_SOCK_CLOSED:
+        case PATTY_AX25_SOCK_PROMISC:
+            break;
+    }
+
+    if (client_save_by_sock(server, client, sock) < 0) {
+        goto error_client_save_by_sock;
+    }
+
+    if ((socks = patty_dict_get(server->socks_by_client, client)) == NULL) {
+        goto error_dict_get_socks_by_client;
+    }
+
+    if (sock_save_by_fd(socks, sock) < 0) {
+        goto error_sock_save_by_fd;
+    }
+
+    return sock_save_by_fd(server->socks_by_fd, sock);
+
+error_sock_save_by_fd:
+error_dict_get_socks_by_client:
+error_client_save_by_sock:
+error_sock_save_remote:
+error_sock_save_local:
+    return -1;
+}
+
+/*
+ * Send a response to a client; responses to tagged requests, for which id is
+ * not negative, are preceded by a header bearing the request identifier along
+ * with the return value and errno of the call
+ */
+static ssize_t reply(int client,
+                     int64_t id,
+                     int ret,
+                     int eno,
+                     const void *buf,
+                     size_t len,
+                     const int *fds,
+                     size_t n_fds) {
+    uint8_t msg[sizeof(patty_client_reply) + PATTY_CLIENT_REPLY_MAX];
+
+    patty_client_reply header = {
+        .id  = (uint32_t)id,
+        .ret = ret,
+        .eno = eno,
+        .len = len
+    };
+
+    if (id < 0) {
+        return n_fds? patty_send_fds(client, buf, len, fds, n_fds):
+                      write(client, buf, len);
+    }
+
+    if (len > PATTY_CLIENT_REPLY_MAX) {
+        errno = EMSGSIZE;
+
+        goto error_toobig;
+    }
+
+    memcpy(msg, &header, sizeof(header));
+    memcpy(msg + sizeof(header), buf, len);
+
+    return patty_send_fds(client, msg, sizeof(header) + len, fds, n_fds);
+
+error_toobig:
+    return -1;
+}
+
+static int client_flush(struct client *client) {
+    ssize_t wrlen;
+
+    if (client->tx_len == 0) {
+        return 0;
+    }
+
+    wrlen = send(client->fd, client->tx_buf, client->tx_len, MSG_NOSIGNAL);
+
+    client->tx_len = 0;
+
+    return wrlen < 0? -1: 0;
+}
+
+/*
+ * Respond to the request currently being handled; responses to a batch of
+ * framed requests are gathered and written together once the batch has been
+ * handled, unless file descriptors must accompany them
+ */
+static ssize_t respond_fds(patty_ax25_server *server,
+                           int client,
+                           int ret,
+                           int eno,
+                           const void *buf,
+                           size_t len,
+                           const int *fds,
+                           size_t n_fds) {
+    struct client *batch = server->batch;
+
+    patty_client_reply header = {
+        .id  = (uint32_t)server->request,
+        .ret = ret,
+        .eno = eno,
+        .len = len
+    };
+
+    if (batch == NULL || batch->fd != client || n_fds || server->request < 0) {
+        return reply(client, server->request, ret, eno, buf, len, fds, n_fds);
+    }
+
+    if (len > PATTY_CLIENT_REPLY_MAX) {
+        errno = EMSGSIZE;
+
+        goto error_toobig;
+    }
+
+    if (batch->tx_len + sizeof(header) + len > PATTY_CLIENT_BATCH_MAX) {
+        if (client_flush(batch) < 0) {
+            goto error_flush;
+        }
+    }
+
+    memcpy(batch->tx_buf + batch->tx_len, &header, sizeof(header));
+    memcpy(batch->tx_buf + batch->tx_len + sizeof(header), buf, len);
+
+    batch->tx_len += sizeof(header) + len;
+
+    return sizeof(header) + len;
+
+error_flush:
+error_toobig:
+    return -1;
+}
+
+static inline ssize_t respond(patty_ax25_server *server,
+                              int client,
+                              int ret,
+                              int eno,
+                              const void *buf,
+                              size_t len) {
+    return respond_fds(server, client, ret, eno, buf, len, NULL, 0);
+}
+
+/*
+ * Read the structure or payload of the request currently being handled,
+ * from the body of a framed message or else from the client socket itself
+ */
+static ssize_t request_read(patty_ax25_server *server,
+                            int client,
+                            void *buf,
+                            size_t len) {
+    size_t left;
+
+    if (server->msg == NULL) {
+        return read(client, buf, len);
+    }
+
+    left = server->msg_len - server->msg_offset;
+
+    /*
+     * Treat a truncated message as a short read, leaving the rest of the
+     * destination zeroed
+     */
+    if (len > left) {
+        memset((uint8_t *)buf + left, '\0', len - left);
+
+        len = left;
+    }
+
+    memcpy(buf, server->msg + server->msg_offset, len);
+
+    server->msg_offset += len;
+
+    return len;
+}
+
+/*
+ * Consume the payload of an unframed request which is not to be acted upon,
+ * so as to stay in step with the client; framed requests need no such care
+ */
+static int request_discard(patty_ax25_server *server,
+                           int client,
+                           size_t len) {
+    while (server->msg == NULL && len) {
+        uint8_t buf[256];
+
+        ssize_t readlen;
+
+        if ((readlen = read(client,
+                            buf,
+                            len < sizeof(buf)? len: sizeof(buf))) <= 0) {
+            return -1;
+        }
+
+        len -= readlen;
+    }
+
+    return 0;
+}
+
+/*
+ * Look up the socket a request refers to, resolving PATTY_CLIENT_FD_LAST to
+ * the socket most recently created by the client
+ */
+static patty_ax25_sock *request_sock(patty_ax25_server *server,
+                                     int client,
+                                     int fd) {
+    if (fd == PATTY_CLIENT_FD_LAST) {
+        struct client *state;
+
+        if ((state = patty_dict_get(server->clients, (uint32_t)client)) == NULL) {
+            return NULL;
+        }
+
+        fd = state->last_sock;
+    }
+
+    return sock_by_fd(server->socks_by_fd, fd);
+}
+
+static int respond_accept(patty_ax25_server *server,
+                          int client,
+                          int ret,
+                          int eno) {
+    patty_client_accept_response response = {
+        .ret = ret,
+        .eno = eno
+    };
+
+    return respond(server, client, ret, eno, &response, sizeof(response));
+}
+
+static void accept_message(patty_ax25_sock *remote,
+                           patty_client_accept_message *message) {
+    memset(message, '\0', sizeof(*message));
+
+    message->fd = remote->fd;
+
+    memcpy(&message->peer, &remote->remote, sizeof(message->peer));
+
+    if (remote->chan == PATTY_AX25_SOCK_CHAN_PTY) {
+        patty_strlcpy(message->path, remote->pty, sizeof(message->path));
+    }
+}
+
+/*
+ * Complete a tagged accept() request with a connection from the ready queue
+ */
+static int deliver_accept(struct listener *listener,
+                          uint32_t id,
+                          patty_ax25_sock *remote) {
+    patty_client_accept_message message;
+    ssize_t ret;
+
+    accept_message(remote, &message);
+
+    if (remote->peer_fd < 0) {
+        return reply(listener->client, id, 0, 0, &message, sizeof(message), NULL, 0);
+    }
+
+    ret = reply(listener->client,
+                id,
+                0,
+                0,
+                &message,
+                sizeof(message),
+                &remote->peer_fd,
+                1);
+
+    (void)close(remote->peer_fd);
+
+    remote->peer_fd = -1;
+
+    return ret;
+}
+
+/*
+ * Pair outstanding tagged accept() requests with ready connections
+ */
+static int listener_drain(patty_ax25_server *server,
+                          struct listener *listener) {
+    while (patty_list_length(listener->requests)
+        && patty_list_length(listener->ready)) {
+        patty_ax25_sock *remote = patty_list_shift(listener->ready);
+
+        uint32_t id = (uint32_t)((intptr_t)patty_list_shift(listener->requests) - 1);
+
+        if (deliver_accept(listener, id, remote) < 0) {
+            goto error_deliver_accept;
+        }
+    }
+
+    return 0;
+
+error_deliver_accept:
+    return -1;
+}
+
+static inline size_t listener_pending(struct listener *listener) {
+    return patty_list_length(listener->ready);
+}
+
+/*
+ * Remove a connection closed before it could be accepted from the ready
+ * queue it waits in, if any, so that the socket taking up its descriptor
+ * next is never mistaken for it
+ */
+static int listener_forget(uint32_t key, void *value, void *ctx) {
+    struct listener *listener = value;
+
+    (void)patty_list_remove(listener->ready, ctx);
+
+    return 0;
+}
+
+static struct listener *listener_get(patty_ax25_server *server,
+                                     int client,
+                                     patty_ax25_sock *sock) {
+    struct listener *listener;
+
+    if ((listener = patty_dict_get(server->listeners,
+                                   (uint32_t)sock->fd)) != NULL) {
+        return listener;
+    }
+
+    if ((listener = malloc(sizeof(*listener))) == NULL) {
+        goto error_malloc_listener;
+    }
+
+    listener->client = client;
+
+    if ((listener->requests = patty_list_new()) == NULL) {
+        goto error_list_new_requests;
+    }
+
+    if ((listener->ready = patty_list_new()) == NULL) {
+        goto error_list_new_ready;
+    }
+
+    if (patty_dict_set(server->listeners,
+                       (uint32_t)sock->fd,
+                       listener) == NULL) {
+        goto error_dict_set;
+    }
+
+    return listener;
+
+error_dict_set:
+    patty_list_destroy(listener->ready);
+
+error_list_new_ready:
+    patty_list_destroy(listener->requests);
+
+error_list_new_requests:
+    free(listener);
+
+error_malloc_listener:
+    return NULL;
+}
+
+/*
+ * Fail any tagged accept() requests outstanding on a listening socket which
+ * is being closed
+ */
+static void listener_close(patty_ax25_server *server,
+                           patty_ax25_sock *sock) {
+    patty_client_accept_response response = {
+        .ret = -1,
+        .eno = ECONNABORTED
+    };
+
+    struct listener *listener;
+
+    if ((listener = patty_dict_get(server->listeners,
+                                   (uint32_t)sock->fd)) == NULL) {
+        return;
+    }
+
+    while (patty_list_length(listener->requests)) {
+        uint32_t id = (uint32_t)((intptr_t)patty_list_shift(listener->requests) - 1);
+
+        (void)reply(listener->client,
+                    id,
+                    response.ret,
+                    response.eno,
+                    &response,
+                    sizeof(response),
+                    NULL,
+                    0);
+    }
+
+    (void)patty_dict_delete(server->listeners, (uint32_t)sock->fd);
+
+    listener_destroy(listener);
+}
+
+static int sock_close(patty_ax25_server *server,
+                      patty_ax25_sock *sock) {
+    int client;
+    patty_dict *socks;
+
+    /*
+     * Datagram sockets take up their local address once bound, whether or
+     * not they are later connected
+     */
+    if (sock->type == PATTY_AX25_SOCK_DGRAM
+     && sock_by_addr(server->socks_local, &sock->local) == sock) {
+        if (sock_delete_local(server, sock) < 0) {
+            goto error_sock_delete_local;
+        }
+    }
+
+    listener_close(server, sock);
+
+    (void)patty_dict_each(server->listeners, listener_forget, sock);
+
+    link_close(server, sock);
+
+    switch (sock->state) {
+        case PATTY_AX25_SOCK_LISTENING:
+            if (group_leave(server, sock) < 0) {
+                goto error_sock_delete_local;
+            }
+
+            /*
+             * Links admitted by this socket outlive it
+             */
+            (void)patty_dict_each(server->socks_by_fd,
+                                  orphan_link_entry,
+                                  sock);
+
+            break;
+
+        case PATTY_AX25_SOCK_PENDING_ACCEPT:
+        case PATTY_AX25_SOCK_PENDING_CONNECT:
+        case PATTY_AX25_SOCK_PENDING_DISCONNECT:
+        case PATTY_AX25_SOCK_ESTABLISHED:
+            if (sock_delete_remote(server, sock) < 0) {
+                goto error_sock_delete_remote;
+            }
+
+            break;
+
+        case PATTY_AX25_SOCK_CLOSED:
+        case PATTY_AX25_SOCK_PROMISC:
+            break;
+    }
+
+    if ((client = client_by_sock(server, sock)) < 0) {
+        goto error_client_by_sock;
+    }
+
+    if ((socks = patty_dict_get(server->socks_by_client, client)) == NULL) {
+        goto error_dict_get_socks_by_client;
+    }
+
+    if (patty_dict_delete(socks, (uint32_t)sock->fd) < 0) {
+        goto error_dict_delete_by_fd_socks;
+    }
+
+    if (patty_dict_delete(server->socks_by_fd, (uint32_t)sock->fd) < 0) {
+        goto error_dict_delete_by_fd_socks_by_fd;
+    }
+
+    (void)client_delete_by_sock(server, sock);
+    (void)patty_dict_delete(server->connects, (uint32_t)sock->fd);
+    (void)patty_dict_delete(server->subscribers, (uint32_t)sock->fd);
+    (void)patty_dict_delete(server->held, (uint32_t)sock->fd);
+
+    fd_clear(server, sock->fd);
+
+    patty_ax25_sock_destroy(sock);
+
+    return 0;
+
+error_dict_delete_by_fd_socks_by_fd:
+error_dict_delete_by_fd_socks:
+error_dict_get_socks_by_client:
+error_client_by_sock:
+error_sock_delete_remote:
+error_sock_delete_local:
+    return -1;
+}
+
+/*
+ * A socket whose peer is busy is no longer held back by its interface, but
+ * is watched again once the peer is ready
+ */
+static inline void sock_flow_stop(patty_ax25_server *server,
+                                  patty_ax25_sock *sock) {
+    fd_clear(server, sock->fd);
+
+    (void)patty_dict_delete(server->held, (uint32_t)sock->fd);
+
+    sock->flow = PATTY_AX25_SOCK_WAIT;
+}
+
+static inline void sock_flow_start(patty_ax25_server *server,
+                                   patty_ax25_sock *sock) {
+    if (patty_dict_get(server->held, (uint32_t)sock->fd) == NULL) {
+        fd_watch(server, sock->fd);
+    }
+}
+
+int patty_ax25_server_if_add(patty_ax25_server *server,
+                             patty_ax25_if *iface,
+                             const char *name) {
+    struct if_entry *entry;
+
+    if ((entry = malloc(sizeof(*entry))) == NULL) {
+        goto error_malloc_entry;
+    }
+
+    if ((entry->fd = patty_ax25_if_fd(iface)) < 0) {
+        goto error_if_fd;
+    }
+
+    patty_strlcpy(entry->name, name, sizeof(entry->name));
+
+    entry->iface       = iface;
+    entry->backlog     = 0;
+    entry->digi        = NULL;
+    entry->digi_wide   = 0;
+    entry->bridged     = 0;
+    entry->param_allow = 0;
+
+    if (patty_list_append(server->ifaces, entry) == NULL) {
+        goto error_list_append;
+    }
+
+    fd_watch(server, entry->fd);
+
+    return 0;
+
+error_list_append:
+error_if_fd:
+    free(entry);
+
+error_malloc_entry:
+    return -1;
+}
+
+int patty_ax25_server_if_delete(patty_ax25_server *server,
+                                const char *ifname) {
+    patty_list_item *item = server->ifaces->first;
+
+    int i = 0;
+
+    while (item) {
+        struct if_entry *entry = item->value;
+
+        if (strncmp(entry->name, ifname, sizeof(entry->name)) == 0) {
+            patty_list_item *other;
+
+            fd_clear(server, entry->fd);
+
+            /*
+             * Stop digipeating out of the interface being removed
+             */
+            for (other = server->ifaces->first; other; other = other->next) {
+                struct if_entry *e = other->value;
+
+                if (e->digi == entry->iface) {
+                    e->digi = NULL;
+                }
+            }
+
+            /*
+             * Forget stations the bridge learned were heard on it
+             */
+            for (other = server->bridge_order->first; other; other = other->next) {
+                struct bridge_entry *e = other->value;
+
+                if (e->iface == entry->iface) {
+                    e->iface   = NULL;
+                    e->expires = 0;
+                }
+            }
+
+            patty_ax25_mheard_forget_if(server->mheard, entry->iface);
+
+            if (patty_list_splice(server->ifaces, i) == NULL) {
+                goto error_list_splice;
+            }
+
+            free(entry);
+
+            return 0;
+        }
+
+        item = item->next;
+        i++;
+    }
+
+    return 0;
+
+error_list_splice:
+    return -1;
+}
+
+static struct if_entry *if_entry_get(patty_ax25_server *server,
+                                     const char *name) {
+    patty_list_item *item = server->ifaces->first;
+
+    while (item) {
+        struct if_entry *entry = item->value;
+
+        if (strncmp(entry->name, name, sizeof(entry->name)) == 0) {
+            return entry;
+        }
+
+        item = item->next;
+    }
+
+    return NULL;
+}
+
+static int if_param_allowed(patty_ax25_server *server,
+                            patty_ax25_if *iface) {
+    patty_list_item *item;
+
+    for (item = server->ifaces->first; item; item = item->next) {
+        struct if_entry *entry = item->value;
+
+        if (entry->iface == iface) {
+            return entry->param_allow;
+        }
+    }
+
+    return 0;
+}
+
+patty_ax25_if *patty_ax25_server_if_get(patty_ax25_server *server,
+                                        const char *name) {
+    struct if_entry *entry;
+
+    if ((entry = if_entry_get(server, name)) == NULL) {
+        return NULL;
+    }
+
+    return entry->iface;
+}
+
+int patty_ax25_server_digi_set(patty_ax25_server *server,
+                               const char *ifname,
+                               const char *outname,
+                               int wide) {
+    struct if_entry *entry;
+    patty_ax25_if *out;
+
+    if ((entry = if_entry_get(server, ifname)) == NULL) {
+        errno = ENODEV;
+
+        goto error_invalid;
+    }
+
+    if (outname == NULL) {
+        out = entry->iface;
+    } else if ((out = patty_ax25_server_if_get(server, outname)) == NULL) {
+        errno = ENODEV;
+
+        goto error_invalid;
+    }
+
+    if (wide < 0 || wide > 7) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    entry->digi      = out;
+    entry->digi_wide = wide;
+
+    return 0;
+
+error_invalid:
+    return -1;
+}
+
+int patty_ax25_server_if_param_allow(patty_ax25_server *server,
+                                     const char *ifname) {
+    struct if_entry *entry;
+
+    if ((entry = if_entry_get(server, ifname)) == NULL) {
+        errno = ENODEV;
+
+        return -1;
+    }
+
+    entry->param_allow = 1;
+
+    return 0;
+}
+
+int patty_ax25_server_bridge_add(patty_ax25_server *server,
+                                 const char *ifname) {
+    struct if_entry *entry;
+
+    if ((entry = if_entry_get(server, ifname)) == NULL) {
+        errno = ENODEV;
+
+        goto error_invalid;
+    }
+
+    entry->bridged = 1;
+
+    return 0;
+
+error_invalid:
+    return -1;
+}
+
+int patty_ax25_server_if_each(patty_ax25_server *server,
+                              int (*callback)(char *, patty_ax25_if *, void *),
+                              void *ctx) {
+    patty_list_item *item = server->ifaces->first;
+
+    while (item) {
+        struct if_entry *entry = item->value;
+
+        if (callback(entry->name, entry->iface, ctx) < 0) {
+            goto error_callback;
+        }
+
+        item = item->next;
+    }
+
+    return 0;
+
+error_callback:
+    return -1;
+}
+
+int patty_ax25_server_route_add(patty_ax25_server *server,
+                                patty_ax25_route *route) {
+    return patty_ax25_route_table_add(server->routes, route);
+}
+
+int patty_ax25_server_route_delete(patty_ax25_server *server,
+                                   patty_ax25_addr *dest) {
+    return patty_ax25_route_table_delete(server->routes, dest);
+}
+
+patty_ax25_route *patty_ax25_server_route_find(patty_ax25_server *server,
+                                               patty_ax25_addr *dest) {
+    return patty_ax25_route_table_find(server->routes, dest);
+}
+
+patty_ax25_route *patty_ax25_server_route_get(patty_ax25_server *server,
+                                              patty_ax25_addr *dest) {
+    return patty_ax25_route_table_get(server->routes, dest);
+}
+
+patty_ax25_route *patty_ax25_server_route_default(patty_ax25_server *server) {
+    return patty_ax25_route_table_default(server->routes);
+}
+
+int patty_ax25_server_route_each(patty_ax25_server *server,
+                                 int (*callback)(patty_ax25_route *, void *),
+                                 void *ctx) {
+    return patty_ax25_route_table_each(server->routes, callback, ctx);
+}
+
+int patty_ax25_server_mheard_each(patty_ax25_server *server,
+                                  int (*callback)(patty_ax25_mheard_entry *, void *),
+                                  void *ctx) {
+    return patty_ax25_mheard_each(server->mheard, callback, ctx);
+}
+
+static int notify_accept(patty_ax25_server *server,
+                         patty_ax25_sock *local,
+                         patty_ax25_sock *remote) {
+    patty_client_accept_message message;
+    struct listener *listener;
+
+    if ((listener = patty_dict_get(server->listeners,
+                                   (uint32_t)local->fd)) != NULL) {
+        if (patty_list_append(listener->ready, remote) == NULL) {
+            goto error_list_append;
+        }
+
+        /*
+         * Make the listening socket readable for clients polling it, unless
+         * the connection is about to be taken by an accept() in waiting
+         */
+        if (patty_list_length(listener->requests) == 0) {
+            uint8_t notice = 0;
+
+            if (write(local->fd, &notice, sizeof(notice)) < 0) {
+                goto error_write;
+            }
+        }
+
+        return listener_drain(server, listener);
+    }
+
+    accept_message(remote, &message);
+
+    if (remote->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET) {
+        ssize_t ret;
+
+        /*
+         * Hand the client end of the new socket's channel to the client by
+         * way of the listening socket's own channel
+         */
+        ret = patty_send_fd(local->fd, &message, sizeof(message), remote->peer_fd);
+
+        (void)close(remote->peer_fd);
+
+        remote->peer_fd = -1;
+
+        return ret;
+    }
+
+    return write(local->fd, &message, sizeof(message));
+
+error_write:
+error_list_append:
+    return -1;
+}
+
+/*
+ * Sockets created upon accepting a connection use the same type of channel
+ * as the listening socket
+ */
+static inline int accept_type(patty_ax25_sock *local) {
+    return local->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET?
+        local->type | PATTY_AX25_SOCK_SEQPACKET: local->type;
+}
+
+/*
+ * Read outbound data from a socket; frames on SOCK_SEQPACKET channels too
+ * large for the socket are discarded, and EMSGSIZE returned
+ */
+static ssize_t sock_read(patty_ax25_sock *sock, void *buf, size_t len) {
+    ssize_t ret;
+
+    if (sock->chan != PATTY_AX25_SOCK_CHAN_SEQPACKET) {
+        return read(sock->fd, buf, len);
+    }
+
+    if ((ret = recv(sock->fd, buf, len, MSG_TRUNC)) > (ssize_t)len) {
+        errno = EMSGSIZE;
+
+        return -1;
+    }
+
+    return ret;
+}
+
+/*
+ * Respond to a connect() request, either immediately or once the outcome of
+ * connecting is known; in the latter case, the identifier of a tagged request
+ * is recalled from when the request was made
+ */
+static int respond_connect(patty_ax25_server *server,
+                           int client,
+                           patty_ax25_sock *sock,
+                           int ret,
+                           int eno) {
+    patty_client_connect_response response = {
+        .ret = ret,
+        .eno = eno
+    };
+
+    int64_t id = server->request;
+
+    void *value;
+
+    if (sock && (value = patty_dict_get(server->connects,
+                                        (uint32_t)sock->fd)) != NULL) {
+        id = (intptr_t)value - 1;
+
+        (void)patty_dict_delete(server->connects, (uint32_t)sock->fd);
+    }
+
+    return reply(client, id, ret, eno, &response, sizeof(response), NULL, 0);
+}
+
+static int server_ping(patty_ax25_server *server, int client) {
+    int pong = 1;
+
+    return respond(server, client, pong, 0, &pong, sizeof(pong));
+}
+
+static int server_socket(patty_ax25_server *server, int client) {
+    patty_client_socket_request request;
+    patty_client_socket_response response;
+
+    patty_ax25_sock *sock;
+    struct client *state;
+
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
+        goto error_read;
+    }
+
+    if ((sock = patty_ax25_sock_new(request.proto, request.type)) == NULL) {
+        goto error_sock_new;
+    }
+
+    if (sock_save(server, client, sock) < 0) {
+        goto error_sock_save;
+    }
+
+    if ((state = patty_dict_get(server->clients, (uint32_t)client)) != NULL) {
+        state->last_sock = sock->fd;
+    }
+
+    /*
+     * Addressed datagrams may be sent on SOCK_SEQPACKET channels straight
+     * away, without first connecting
+     */
+    if (sock->type == PATTY_AX25_SOCK_DGRAM
+     && sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET) {
+        fd_watch(server, sock->fd);
+    }
+
+    response.fd  = sock->fd;
+    response.eno = 0;
+
+    memcpy(response.path, patty_ax25_sock_pty(sock), sizeof(response.path));
+
+    if (sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET) {
+        ssize_t ret = reply(client,
+                            server->request,
+                            sock->fd,
+                            0,
+                            &response,
+                            sizeof(response),
+                            &sock->peer_fd,
+                            1);
+
+        (void)close(sock->peer_fd);
+
+        sock->peer_fd = -1;
+
+        return ret;
+    }
+
+    return respond(server, client, sock->fd, 0, &response, sizeof(response));
+
+error_sock_save:
+    patty_ax25_sock_destroy(sock);
+
+error_sock_new:
+error_read:
+    return -1;
+}
+
+static int server_setsockopt(patty_ax25_server *server,
+                             int client) {
+    patty_client_setsockopt_request request;
+    patty_client_setsockopt_response response;
+
+    patty_ax25_sock *sock;
+
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
+        goto error_read;
+    }
+
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
+        if (request_discard(server, client, request.len) < 0) {
+            goto error_read;
+        }
+
+        response.ret = -1;
+        response.eno = EBADF;
+
+        goto error_sock_by_fd;
+    }
+
+    switch (request.opt) {
+        case PATTY_AX25_SOCK_PARAMS: {
+            patty_client_setsockopt_params data;
+
+            if (request.len != sizeof(data)) {
+                if (request_discard(server, client, request.len) < 0) {
+                    goto error_read;
+                }
+
+                response.ret = -1;
+                response.eno = EINVAL;
+
+                goto error_invalid_type;
+            }
+
+            if (request_read(server, client, &data, sizeof(data)) < 0) {
+                goto error_read;
+            }
+
+            if (data.flags & PATTY_AX25_SOCK_PARAM_MTU)
+                patty_ax25_sock_mtu_set(sock, data.mtu);
+
+            if (data.flags & PATTY_AX25_SOCK_PARAM_WINDOW)
+                patty_ax25_sock_window_set(sock, data.window);
+
+            if (data.flags & PATTY_AX25_SOCK_PARAM_ACK)
+                patty_ax25_sock_ack_set(sock, data.ack);
+
+            if (data.flags & PATTY_AX25_SOCK_PARAM_RETRY)
+                patty_ax25_sock_retry_set(sock, data.retry);
+
+            if (data.flags & (PATTY_AX25_SOCK_PARAM_MTU
+                            | PATTY_AX25_SOCK_PARAM_WINDOW)) {
+                if (patty_ax25_sock_realloc_bufs(sock) < 0) {
+                    goto error_realloc_bufs;
+                }
+            }
+
+            break;
+        }
+
+        case PATTY_AX25_SOCK_IF: {
+            patty_client_setsockopt_if data;
+            patty_ax25_if *iface;
+
+            if (sock->type != PATTY_AX25_SOCK_RAW
+             || request.len != sizeof(data)) {
+                if (request_discard(server, client, request.len) < 0) {
+                    goto error_read;
+                }
+
+                response.ret = -1;
+                response.eno = EINVAL;
+
+                goto error_invalid_type;
+            }
+
+            if (request_read(server, client, &data, sizeof(data)) < 0) {
+                goto error_read;
+            }
+
+            if ((iface = patty_ax25_server_if_get(server, data.name)) == NULL) {
+                response.ret = -1;
+                response.eno = ENODEV;
+
+                goto error_get_if;
+            }
+
+            if (sock->tap_fd >= 0) {
+                response.ret = -1;
+                response.eno = EISCONN;
+
+                goto error_tapped;
+            }
+
+            if (data.state == PATTY_AX25_SOCK_PROMISC) {
+                sock->state = PATTY_AX25_SOCK_PROMISC;
+            }
+
+            patty_ax25_sock_bind_if(sock, iface);
+
+            fd_watch(server, sock->fd);
+
+            break;
+        }
+
+        case PATTY_AX25_SOCK_TAP: {
+            patty_client_setsockopt_if data;
+            patty_client_setsockopt_tap tapinfo;
+            patty_ax25_if *iface;
+
+            int fds[2];
+
+            if (sock->type != PATTY_AX25_SOCK_RAW
+             || request.len != sizeof(data)) {
+                if (request_discard(server, client, request.len) < 0) {
+                    goto error_read;
+                }
+
+                response.ret = -1;
+                response.eno = EINVAL;
+
+                goto error_invalid_type;
+            }
+
+            if (request_read(server, client, &data, sizeof(data)) < 0) {
+                goto error_read;
+            }
+
+            if (sock->iface != NULL) {
+                response.ret = -1;
+                response.eno = EISCONN;
+
+                goto error_tapped;
+            }
+
+            if ((iface = patty_ax25_server_if_get(server, data.name)) == NULL) {
+                response.ret = -1;
+                response.eno = ENODEV;
+
+                goto error_get_if;
+            }
+
+            if (patty_ax25_sock_tap(sock, iface) < 0) {
+                response.ret = -1;
+                response.eno = errno;
+
+                goto error_tap;
+            }
+
+            fd_watch(server, sock->fd);
+
+            /*
+             * Pass the tap's shared memory and the socket's wakeup eventfd
+             * along with the response
+             */
+            fds[0] = patty_ax25_tap_fd(iface->tap);
+            fds[1] = sock->tap_fd;
+
+            tapinfo.ret  = 0;
+            tapinfo.eno  = 0;
+            tapinfo.size = patty_ax25_tap_size(iface->tap);
+
+            return reply(client,
+                         server->request,
+                         0,
+                         0,
+                         &tapinfo,
+                         sizeof(tapinfo),
+                         fds,
+                         2);
+        }
+
+        case PATTY_AX25_SOCK_SUBSCRIBE: {
+            patty_ax25_sock_sub data;
+
+            if (sock->type != PATTY_AX25_SOCK_DGRAM
+             || request.len != sizeof(data)) {
+                if (request_discard(server, client, request.len) < 0) {
+                    goto error_read;
+                }
+
+                response.ret = -1;
+                response.eno = EINVAL;
+
+                goto error_invalid_type;
+            }
+
+            if (request_read(server, client, &data, sizeof(data)) < 0) {
+                goto error_read;
+            }
 
-    memset(&message, '\0', sizeof(message));
+            if (data.match == 0) {
+                (void)patty_dict_delete(server->subscribers, (uint32_t)sock->fd);
+            } else if (patty_ax25_sock_sub_init(sock) < 0
+                    || patty_dict_set(server->subscribers,
+                                      (uint32_t)sock->fd,
+                                      sock) == NULL) {
+                response.ret = -1;
+                response.eno = errno;
 
-    message.fd = remote;
+                goto error_subscribe;
+            }
 
-    if (peer) {
-        memcpy(&message.peer, peer, sizeof(message.peer));
-    }
+            memcpy(&sock->sub, &data, sizeof(sock->sub));
 
-    if (path) {
-        patty_strlcpy(message.path, path, sizeof(message.path));
-    }
+            break;
+        }
 
-    return write(local, &message, sizeof(message));
-}
+        case PATTY_AX25_SOCK_FILTER: {
+            patty_ax25_filter_insn insns[PATTY_AX25_FILTER_MAX_INSNS];
+            patty_ax25_filter *filter = NULL;
 
-static int respond_connect(int client, int ret, int eno) {
-    patty_client_connect_response response = {
-        .ret = ret,
-        .eno = eno
-    };
+            if (request.len > sizeof(insns)) {
+                if (request_discard(server, client, request.len) < 0) {
+                    goto error_read;
+                }
 
-    return write(client, &response, sizeof(response));
-}
+                response.ret = -1;
+                response.eno = EMSGSIZE;
 
-static int server_ping(patty_ax25_server *server, int client) {
-    int pong = 1;
+                goto error_invalid_type;
+            }
 
-    return write(client, &pong, sizeof(pong));
-}
+            if (request_read(server, client, insns, request.len) < 0) {
+                goto error_read;
+            }
 
-static int server_socket(patty_ax25_server *server, int client) {
-    patty_client_socket_request request;
-    patty_client_socket_response response;
+            if (sock->type != PATTY_AX25_SOCK_RAW
+             || request.len % sizeof(insns[0]) != 0) {
+                response.ret = -1;
+                response.eno = EINVAL;
 
-    patty_ax25_sock *sock;
+                goto error_invalid_type;
+            }
 
-    if (read(client, &request, sizeof(request)) < 0) {
-        goto error_read;
-    }
+            /*
+             * An empty program removes the filter
+             */
+            if (request.len > 0) {
+                if ((filter = patty_ax25_filter_new(insns,
+                                                    request.len / sizeof(insns[0]))) == NULL) {
+                    response.ret = -1;
+                    response.eno = errno;
 
-    if ((sock = patty_ax25_sock_new(request.proto, request.type)) == NULL) {
-        goto error_sock_new;
-    }
+                    goto error_filter_new;
+                }
+            }
 
-    if (sock_save(server, client, sock) < 0) {
-        goto error_sock_save;
-    }
+            patty_ax25_sock_filter(sock, filter);
 
-    response.fd  = sock->fd;
-    response.eno = 0;
+            break;
+        }
 
-    memcpy(response.path, patty_ax25_sock_pty(sock), sizeof(response.path));
+        case PATTY_AX25_SOCK_REUSE: {
+            patty_client_setsockopt_reuse data;
 
-    return write(client, &response, sizeof(response));
+            if (request.len != sizeof(data)) {
+                if (request_discard(server, client, request.len) < 0) {
+                    goto error_read;
+                }
 
-error_sock_save:
-    patty_ax25_sock_destroy(sock);
+                response.ret = -1;
+                response.eno = EINVAL;
 
-error_sock_new:
-error_read:
-    return -1;
-}
+                goto error_invalid_type;
+            }
 
-static int server_setsockopt(patty_ax25_server *server,
-                             int client) {
-    patty_client_setsockopt_request request;
-    patty_client_setsockopt_response response;
+            if (request_read(server, client, &data, sizeof(data)) < 0) {
+                goto error_read;
+            }
 
-    patty_ax25_sock *sock;
+            /*
+             * Only stream sockets yet to be bound may join a group
+             */
+            if (sock->type != PATTY_AX25_SOCK_STREAM
+             || sock->local.callsign[0] != '\0'
+             || data.mode < PATTY_AX25_SOCK_REUSE_NONE
+             || data.mode > PATTY_AX25_SOCK_REUSE_LEAST) {
+                response.ret = -1;
+                response.eno = EINVAL;
 
-    if (read(client, &request, sizeof(request)) < 0) {
-        goto error_read;
-    }
+                goto error_invalid_type;
+            }
 
-    if ((sock = sock_by_fd(server->socks_by_fd, request.fd)) == NULL) {
-        response.ret = -1;
-        response.eno = EBADF;
+            sock->reuse = data.mode;
 
-        goto error_sock_by_fd;
-    }
+            break;
+        }
 
-    switch (request.opt) {
-        case PATTY_AX25_SOCK_PARAMS: {
-            patty_client_setsockopt_params data;
+        case PATTY_AX25_SOCK_NOTICES: {
+            patty_client_setsockopt_notices data;
 
-            if (read(client, &data, request.len) < 0) {
-                goto error_read;
-            }
+            if (request.len != sizeof(data)) {
+                if (request_discard(server, client, request.len) < 0) {
+                    goto error_read;
+                }
 
-            if (data.flags & PATTY_AX25_SOCK_PARAM_MTU)
-                patty_ax25_sock_mtu_set(sock, data.mtu);
+                response.ret = -1;
+                response.eno = EINVAL;
 
-            if (data.flags & PATTY_AX25_SOCK_PARAM_WINDOW)
-                patty_ax25_sock_window_set(sock, data.window);
+                goto error_invalid_type;
+            }
 
-            if (data.flags & PATTY_AX25_SOCK_PARAM_ACK)
-                patty_ax25_sock_ack_set(sock, data.ack);
+            if (request_read(server, client, &data, sizeof(data)) < 0) {
+                goto error_read;
+            }
 
-            if (data.flags & PATTY_AX25_SOCK_PARAM_RETRY)
-                patty_ax25_sock_retry_set(sock, data.retry);
+            if (sock->type != PATTY_AX25_SOCK_RAW) {
+                response.ret = -1;
+                response.eno = EINVAL;
 
-            if (data.flags & (PATTY_AX25_SOCK_PARAM_MTU
-                            | PATTY_AX25_SOCK_PARAM_WINDOW)) {
-                if (patty_ax25_sock_realloc_bufs(sock) < 0) {
-                    goto error_realloc_bufs;
-                }
+                goto error_invalid_type;
             }
 
+            patty_ax25_sock_notices(sock, data.enable != 0);
+
             break;
         }
 
-        case PATTY_AX25_SOCK_IF: {
-            patty_client_setsockopt_if data;
-            patty_ax25_if *iface;
+        case PATTY_AX25_SOCK_IF_PARAM: {
+            patty_client_setsockopt_if_param data;
+
+            if (request.len != sizeof(data)) {
+                if (request_discard(server, client, request.len) < 0) {
+                    goto error_read;
+                }
 
-            if (sock->type != PATTY_AX25_SOCK_RAW) {
                 response.ret = -1;
                 response.eno = EINVAL;
 
                 goto error_invalid_type;
             }
 
-            if (read(client, &data, request.len) < 0) {
+            if (request_read(server, client, &data, sizeof(data)) < 0) {
                 goto error_read;
             }
 
-            if ((iface = patty_ax25_server_if_get(server, data.name)) == NULL) {
+            if (sock->type != PATTY_AX25_SOCK_RAW || sock->iface == NULL) {
                 response.ret = -1;
-                response.eno = ENODEV;
+                response.eno = sock->type == PATTY_AX25_SOCK_RAW?
+                                   ENOTCONN: EINVAL;
 
-                goto error_get_if;
+                goto error_invalid_type;
             }
 
-            if (data.state == PATTY_AX25_SOCK_PROMISC) {
-                sock->state = PATTY_AX25_SOCK_PROMISC;
+            /*
+             * Channel access is the business of whoever configures the
+             * daemon, unless they allow otherwise for the interface
+             */
+            if (!if_param_allowed(server, sock->iface)) {
+                response.ret = -1;
+                response.eno = EPERM;
+
+                goto error_invalid_type;
             }
 
-            patty_ax25_sock_bind_if(sock, iface);
+            /*
+             * Parameters are checked here, as those for interfaces with an
+             * I/O thread are only passed on to the TNC later
+             */
+            if (data.param < PATTY_AX25_IF_PARAM_TXDELAY
+             || data.param > PATTY_AX25_IF_PARAM_FULL_DUPLEX) {
+                response.ret = -1;
+                response.eno = EINVAL;
 
-            fd_watch(server, sock->fd);
+                goto error_invalid_type;
+            }
+
+            if (data.value > 0xff) {
+                response.ret = -1;
+                response.eno = ERANGE;
+
+                goto error_invalid_type;
+            }
+
+            if (patty_ax25_if_param_set(sock->iface,
+                                        data.param,
+                                        data.value) < 0) {
+                response.ret = -1;
+                response.eno = errno;
+
+                goto error_if_param_set;
+            }
 
             break;
         }
 
         default:
+            if (request_discard(server, client, request.len) < 0) {
+                goto error_read;
+            }
+
             response.ret = -1;
             response.eno = EINVAL;
 
@@ -748,7 +2547,17 @@ error_sock_by_fd:
 error_get_if:
 error_invalid_type:
 error_invalid_opt:
-    return write(client, &response, sizeof(response));
+error_tapped:
+error_tap:
+error_filter_new:
+error_subscribe:
+error_if_param_set:
+    return respond(server,
+                   client,
+                   response.ret,
+                   response.eno,
+                   &response,
+                   sizeof(response));
 
 error_realloc_bufs:
 error_read:
@@ -760,13 +2569,13 @@ static int server_bind(patty_ax25_server *server,
     patty_client_bind_request request;
     patty_client_bind_response response;
 
-    patty_ax25_sock *sock;
+    patty_ax25_sock *sock, *other;
 
-    if (read(client, &request, sizeof(request)) < 0) {
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
         goto error_io;
     }
 
-    if ((sock = sock_by_fd(server->socks_by_fd, request.fd)) == NULL) {
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
         response.ret = -1;
         response.eno = EBADF;
 
@@ -780,7 +2589,12 @@ static int server_bind(patty_ax25_server *server,
         goto error_bound;
     }
 
-    if (sock_by_addr(server->socks_local, &request.addr) != NULL) {
+    /*
+     * An address may only be shared by sockets which all allow it
+     */
+    if ((other = sock_by_addr(server->socks_local, &request.addr)) != NULL
+     && (sock->reuse == PATTY_AX25_SOCK_REUSE_NONE
+      || other->reuse == PATTY_AX25_SOCK_REUSE_NONE)) {
         response.ret = -1;
         response.eno = EADDRINUSE;
 
@@ -789,13 +2603,28 @@ static int server_bind(patty_ax25_server *server,
 
     memcpy(&sock->local, &request.addr, sizeof(request.addr));
 
+    /*
+     * Datagram sockets receive datagrams sent to their local address from
+     * any peer, so long as they are not connected
+     */
+    if (sock->type == PATTY_AX25_SOCK_DGRAM) {
+        if (sock_save_local(server, sock) < 0) {
+            goto error_io;
+        }
+    }
+
     response.ret = 0;
     response.eno = 0;
 
 error_exists:
 error_bound:
 error_sock_by_fd:
-    return write(client, &response, sizeof(response));
+    return respond(server,
+                   client,
+                   response.ret,
+                   response.eno,
+                   &response,
+                   sizeof(response));
 
 error_io:
     return -1;
@@ -806,13 +2635,13 @@ static int server_listen(patty_ax25_server *server,
     patty_client_listen_request request;
     patty_client_listen_response response;
 
-    patty_ax25_sock *sock;
+    patty_ax25_sock *sock, *other;
 
-    if (read(client, &request, sizeof(request)) < 0) {
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
         goto error_io;
     }
 
-    if ((sock = sock_by_fd(server->socks_by_fd, request.fd)) == NULL) {
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
         response.ret = -1;
         response.eno = EBADF;
 
@@ -820,54 +2649,268 @@ static int server_listen(patty_ax25_server *server,
     }
 
     if (sock->local.callsign[0] == '\0') {
+        response.ret = -1;
         response.eno = EINVAL;
 
         goto error_invalid_fd;
     }
 
-    sock->state = PATTY_AX25_SOCK_LISTENING;
+    if ((other = sock_by_addr(server->socks_local, &sock->local)) != NULL
+     && other != sock
+     && (sock->reuse == PATTY_AX25_SOCK_REUSE_NONE
+      || other->reuse == PATTY_AX25_SOCK_REUSE_NONE)) {
+        response.ret = -1;
+        response.eno = EADDRINUSE;
+
+        goto error_invalid_fd;
+    }
+
+    /*
+     * Groups are keyed by the hash of their address, which may be taken by
+     * the group of another address
+     */
+    if (sock->reuse != PATTY_AX25_SOCK_REUSE_NONE
+     && group_get(server, &sock->local) == NULL
+     && patty_dict_get(server->groups, hash_addr(&sock->local)) != NULL) {
+        response.ret = -1;
+        response.eno = EADDRINUSE;
+
+        goto error_invalid_fd;
+    }
+
+    sock->state   = PATTY_AX25_SOCK_LISTENING;
+    sock->backlog = request.backlog <= 0?
+                        PATTY_AX25_SOCK_DEFAULT_BACKLOG:
+                    request.backlog > PATTY_AX25_SOCK_MAX_BACKLOG?
+                        PATTY_AX25_SOCK_MAX_BACKLOG: request.backlog;
 
-    if (sock_save_local(server, sock) < 0) {
+    if (sock->reuse != PATTY_AX25_SOCK_REUSE_NONE) {
+        if (group_join(server, sock) < 0) {
+            goto error_sock_save_local;
+        }
+    } else if (sock_save_local(server, sock) < 0) {
         goto error_sock_save_local;
     }
 
+    /*
+     * Connections to sockets listening on behalf of clients using tagged
+     * requests are handed over the control socket
+     */
+    if (server->request >= 0) {
+        if (listener_get(server, client, sock) == NULL) {
+            goto error_listener_get;
+        }
+    }
+
     response.ret = 0;
     response.eno = 0;
 
-error_invalid_fd:
-error_sock_by_fd:
-    return write(client, &response, sizeof(response));
+error_invalid_fd:
+error_sock_by_fd:
+    return respond(server,
+                   client,
+                   response.ret,
+                   response.eno,
+                   &response,
+                   sizeof(response));
+
+error_listener_get:
+error_sock_save_local:
+error_io:
+    return -1;
+}
+
+static int server_accept(patty_ax25_server *server,
+                         int client) {
+    patty_client_accept_request request;
+    patty_ax25_sock *sock;
+
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
+        goto error_io;
+    }
+
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
+        return respond_accept(server, client, -1, EBADF);
+    }
+
+    if (sock->type != PATTY_AX25_SOCK_STREAM) {
+        return respond_accept(server, client, -1, EOPNOTSUPP);
+    }
+
+    if (sock->state != PATTY_AX25_SOCK_LISTENING) {
+        return respond_accept(server, client, -1, EINVAL);
+    }
+
+    /*
+     * Tagged accept() requests are only responded to once a connection is
+     * available
+     */
+    if (server->request >= 0) {
+        struct listener *listener;
+
+        if ((listener = listener_get(server, client, sock)) == NULL) {
+            goto error_listener_get;
+        }
+
+        /*
+         * Non-blocking requests only succeed if a connection is waiting for
+         * them, after those already claimed by earlier requests
+         */
+        if ((request.flags & PATTY_CLIENT_ACCEPT_NONBLOCK)
+         && listener_pending(listener)
+              <= patty_list_length(listener->requests)) {
+            return respond_accept(server, client, -1, EAGAIN);
+        }
+
+        if (patty_list_append(listener->requests,
+                              (void *)(intptr_t)(server->request + 1)) == NULL) {
+            goto error_list_append;
+        }
+
+        if (listener_drain(server, listener) < 0) {
+            goto error_listener_drain;
+        }
+
+        /*
+         * Clients clear the notices on the listening socket before each
+         * accept(), so make it readable again while connections remain
+         */
+        if (listener_pending(listener)
+              > patty_list_length(listener->requests)) {
+            uint8_t notice = 0;
+
+            if (write(sock->fd, &notice, sizeof(notice)) < 0) {
+                goto error_write;
+            }
+        }
+
+        return 0;
+    }
+
+    return respond_accept(server, client, 0, 0);
+
+error_write:
+error_listener_drain:
+error_list_append:
+error_listener_get:
+error_io:
+    return -1;
+}
+
+struct iface_links {
+    patty_ax25_if *iface;
+    size_t links;
+};
+
+static int count_iface_links(uint32_t key, void *value, void *ctx) {
+    patty_ax25_sock *sock = value;
+    struct iface_links *count = ctx;
+
+    if (sock->iface == count->iface
+     && sock->type  == PATTY_AX25_SOCK_STREAM
+     && sock->state != PATTY_AX25_SOCK_CLOSED
+     && sock->state != PATTY_AX25_SOCK_LISTENING) {
+        count->links++;
+    }
+
+    return 0;
+}
+
+/*
+ * Load on an interface, in links open or being opened on it, and frames'
+ * worth of output waiting to be sent
+ */
+static size_t iface_load(patty_ax25_server *server, patty_ax25_if *iface) {
+    struct iface_links count = {
+        .iface = iface,
+        .links = 0
+    };
+
+    ssize_t queued = patty_ax25_if_queued(iface);
+
+    (void)patty_dict_each(server->socks_by_fd, count_iface_links, &count);
+
+    if (queued > 0 && iface->mtu) {
+        count.links += (size_t)queued / iface->mtu;
+    }
+
+    return count.links;
+}
+
+/*
+ * Pick the interface of a route bearing the least load for its weight, among
+ * those up; interfaces which are down or in error are passed over, so that
+ * traffic fails over to the others.  Returns NULL if none are up.
+ */
+static patty_ax25_if *route_iface(patty_ax25_server *server,
+                                  patty_ax25_route *route) {
+    patty_ax25_if *best = NULL;
+    size_t best_load   = 0,
+           best_weight = 1,
+           i;
+
+    if (route->n_nexthops == 1) {
+        return route->nexthops[0].iface;
+    }
+
+    for (i=0; i<route->n_nexthops; i++) {
+        patty_ax25_route_nexthop *nexthop = &route->nexthops[i];
+        size_t load;
+
+        if (nexthop->iface->status != PATTY_AX25_IF_UP) {
+            continue;
+        }
+
+        load = iface_load(server, nexthop->iface) + 1;
 
-error_sock_save_local:
-error_io:
-    return -1;
+        /*
+         * Compare load / weight without dividing
+         */
+        if (best == NULL || load * best_weight < best_load * nexthop->weight) {
+            best        = nexthop->iface;
+            best_load   = load;
+            best_weight = nexthop->weight;
+        }
+    }
+
+    return best;
 }
 
-static int server_accept(patty_ax25_server *server,
-                         int client) {
-    patty_client_accept_request request;
-    patty_ax25_sock *sock;
+/*
+ * Lacking a static route to a peer, find the interface and path it was last
+ * heard by, provided it was heard recently enough
+ */
+static patty_ax25_mheard_entry *heard_route(patty_ax25_server *server,
+                                            patty_ax25_addr *peer) {
+    patty_ax25_route *route;
+    patty_ax25_mheard_entry *heard;
 
-    if (read(client, &request, sizeof(request)) < 0) {
-        goto error_io;
+    if ((route = patty_ax25_route_table_get(server->routes, peer)) != NULL) {
+        return NULL;
     }
 
-    if ((sock = sock_by_fd(server->socks_by_fd, request.fd)) == NULL) {
-        return respond_accept(client, -1, EBADF);
+    if ((heard = patty_ax25_mheard_find(server->mheard, peer)) == NULL) {
+        return NULL;
     }
 
-    if (sock->type != PATTY_AX25_SOCK_STREAM) {
-        return respond_accept(client, -1, EOPNOTSUPP);
+    if (server->now.tv_sec - heard->last >= PATTY_AX25_MHEARD_MAX_AGE
+     || heard->iface->status != PATTY_AX25_IF_UP) {
+        return NULL;
     }
 
-    if (sock->state != PATTY_AX25_SOCK_LISTENING) {
-        return respond_accept(client, -1, EINVAL);
-    }
+    return heard;
+}
 
-    return respond_accept(client, 0, 0);
+static int route_has_iface(patty_ax25_route *route, patty_ax25_if *iface) {
+    size_t i;
 
-error_io:
-    return -1;
+    for (i=0; i<route->n_nexthops; i++) {
+        if (route->nexthops[i].iface == iface) {
+            return 1;
+        }
+    }
+
+    return 0;
 }
 
 static int server_connect(patty_ax25_server *server,
@@ -876,26 +2919,28 @@ static int server_connect(patty_ax25_server *server,
 
     patty_ax25_sock *sock;
     patty_ax25_route *route;
+    patty_ax25_mheard_entry *heard;
     patty_ax25_if *iface;
+    struct xid_entry *entry;
 
-    if (read(client, &request, sizeof(request)) < 0) {
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
         goto error_io;
     }
 
-    if ((sock = sock_by_fd(server->socks_by_fd, request.fd)) == NULL) {
-        return respond_connect(client, -1, EBADF);
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
+        return respond_connect(server, client, NULL, -1, EBADF);
     }
 
     if (sock->type == PATTY_AX25_SOCK_RAW) {
-        return respond_connect(client, -1, ENOTSUP);
+        return respond_connect(server, client, NULL, -1, ENOTSUP);
     }
 
     switch (sock->state) {
         case PATTY_AX25_SOCK_LISTENING:
-            return respond_connect(client, -1, EINVAL);
+            return respond_connect(server, client, NULL, -1, EINVAL);
 
         case PATTY_AX25_SOCK_ESTABLISHED:
-            return respond_connect(client, -1, EISCONN);
+            return respond_connect(server, client, NULL, -1, EISCONN);
 
         default:
             break;
@@ -914,15 +2959,26 @@ static int server_connect(patty_ax25_server *server,
         route = patty_ax25_route_table_default(server->routes);
     }
 
-    /*
-     * If no route could be found, then assume the network is down or not
-     * configured.
-     */
-    if (route == NULL) {
-        return respond_connect(client, -1, ENETDOWN);
+    if ((heard = heard_route(server, &request.peer)) != NULL) {
+        /*
+         * If the peer has been heard recently, reach it by the interface
+         * it was heard on, or by whichever of the interfaces sharing a
+         * route with that one bears the least load.
+         */
+        iface = heard->iface;
+
+        if (route && route_has_iface(route, iface)) {
+            iface = route_iface(server, route);
+        }
+    } else if (route == NULL || (iface = route_iface(server, route)) == NULL) {
+        /*
+         * If no route could be found, or none of the interfaces it may use
+         * are up, then assume the network is down or not configured.
+         */
+        return respond_connect(server, client, NULL, -1, ENETDOWN);
     }
 
-    patty_ax25_sock_bind_if(sock, iface = route->iface);
+    patty_ax25_sock_bind_if(sock, iface);
 
     /*
      * If there is no local address bound to this sock, then bind the
@@ -937,6 +2993,21 @@ static int server_connect(patty_ax25_server *server,
      */
     memcpy(&sock->remote, &request.peer, sizeof(request.peer));
 
+    /*
+     * Reply by way of the path the peer was heard by, in reverse.
+     */
+    if (heard) {
+        unsigned int i;
+
+        for (i=0; i<heard->hops; i++) {
+            memcpy(&sock->repeaters[i],
+                   &heard->path[heard->hops-1-i],
+                   sizeof(patty_ax25_addr));
+        }
+
+        sock->hops = heard->hops;
+    }
+
     if (sock_save_remote(server, sock) < 0) {
         goto error_sock_save_remote;
     }
@@ -949,27 +3020,37 @@ static int server_connect(patty_ax25_server *server,
         case PATTY_AX25_SOCK_DGRAM:
             sock->state = PATTY_AX25_SOCK_ESTABLISHED;
 
-            break;
+            fd_watch(server, sock->fd);
+
+            return respond_connect(server, client, NULL, 0, 0);
 
         case PATTY_AX25_SOCK_STREAM:
             sock->state = PATTY_AX25_SOCK_PENDING_CONNECT;
 
             /*
-             * Send an XID frame, to attempt to negotiate AX.25 v2.2 and its
-             * default parameters.
+             * Recall the identifier of a tagged request until the outcome
+             * of connecting is known
              */
-            if (patty_ax25_sock_send_xid(sock, PATTY_AX25_FRAME_COMMAND) < 0) {
-                return respond_connect(client, -1, errno);
+            if (server->request >= 0) {
+                if (patty_dict_set(server->connects,
+                                   (uint32_t)sock->fd,
+                                   (void *)(intptr_t)(server->request + 1)) == NULL) {
+                    goto error_dict_set_connects;
+                }
             }
 
             /*
-             * At this point, we will wait for a DM, FRMR or XID response, which
-             * will help us determine what version of AX.25 to apply for this
-             * socket, or whether the peer is not accepting connections.
+             * Skip the XID exchange with peers whose parameters are already
+             * known; otherwise, send an XID frame, to attempt to negotiate
+             * AX.25 v2.2 and its default parameters.
              */
-            sock->retries = sock->n_retry;
-
-            patty_timer_start(&sock->timer_t1);
+            if ((entry = xid_cache_get(server, &sock->remote)) != NULL) {
+                if (connect_cached(server, sock, entry) < 0) {
+                    return respond_connect(server, client, sock, -1, errno);
+                }
+            } else if (connect_xid(server, sock) < 0) {
+                return respond_connect(server, client, sock, -1, errno);
+            }
 
         default:
             break;
@@ -977,6 +3058,7 @@ static int server_connect(patty_ax25_server *server,
 
     return 0;
 
+error_dict_set_connects:
 error_client_save_by_sock:
 error_sock_save_remote:
 error_io:
@@ -991,11 +3073,11 @@ static int server_close(patty_ax25_server *server,
     patty_ax25_sock *sock;
     patty_dict *socks;
 
-    if (read(client, &request, sizeof(request)) < 0) {
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
         goto error_io;
     }
 
-    if ((sock = sock_by_fd(server->socks_by_fd, request.fd)) == NULL) {
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
         response.ret = -1;
         response.eno = EBADF;
 
@@ -1030,12 +3112,265 @@ error_sock_close:
 error_sock_shutdown:
 error_dict_get_socks_by_client:
 error_sock_by_fd:
-    return write(client, &response, sizeof(response));
+    return respond(server,
+                   client,
+                   response.ret,
+                   response.eno,
+                   &response,
+                   sizeof(response));
+
+error_io:
+    return -1;
+}
+
+/*
+ * Send a datagram to the peer and by way of the path given, or by the route
+ * to the peer when no path is given
+ */
+static ssize_t dgram_send(patty_ax25_server *server,
+                          patty_ax25_sock *sock,
+                          patty_client_dgram *dgram,
+                          void *buf,
+                          size_t len) {
+    patty_ax25_route *route;
+    patty_ax25_if *iface;
+
+    if ((route = patty_ax25_route_table_find(server->routes,
+                                             &dgram->peer)) == NULL
+     || (iface = route_iface(server, route)) == NULL) {
+        errno = ENETDOWN;
+
+        goto error_route_table_find;
+    }
+
+    if (dgram->path.hops > 0) {
+        return patty_ax25_sock_sendto(sock,
+                                      iface,
+                                      &dgram->peer,
+                                      dgram->path.repeaters,
+                                      dgram->path.hops,
+                                      buf,
+                                      len);
+    }
+
+    return patty_ax25_sock_sendto(sock,
+                                  iface,
+                                  &dgram->peer,
+                                  route->repeaters,
+                                  route->hops,
+                                  buf,
+                                  len);
+
+error_route_table_find:
+    return -1;
+}
+
+static int server_sendto(patty_ax25_server *server,
+                         int client) {
+    patty_client_sendto_request request;
+    patty_client_sendto_response response;
+
+    patty_ax25_sock *sock;
+
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
+        goto error_io;
+    }
+
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
+        response.ret = -1;
+        response.eno = EBADF;
+
+        goto error_sock_by_fd;
+    }
+
+    if (sock->type != PATTY_AX25_SOCK_DGRAM) {
+        response.ret = -1;
+        response.eno = EOPNOTSUPP;
+
+        goto error_invalid_type;
+    }
+
+    if (request.dgram.len > sock->n_maxlen_tx) {
+        response.ret = -1;
+        response.eno = EMSGSIZE;
+
+        goto error_toobig;
+    }
+
+    if (request_read(server, client, sock->io_buf, request.dgram.len) < 0) {
+        goto error_io;
+    }
+
+    if (dgram_send(server,
+                   sock,
+                   &request.dgram,
+                   sock->io_buf,
+                   request.dgram.len) < 0) {
+        response.ret = -1;
+        response.eno = errno;
+    } else {
+        response.ret = request.dgram.len;
+        response.eno = 0;
+    }
+
+    return respond(server,
+                   client,
+                   response.ret,
+                   response.eno,
+                   &response,
+                   sizeof(response));
+
+error_toobig:
+error_invalid_type:
+error_sock_by_fd:
+    /*
+     * Consume the payload of an unframed request, so as to stay in step
+     * with the client
+     */
+    while (server->msg == NULL && request.dgram.len) {
+        uint8_t buf[256];
+
+        ssize_t readlen;
+
+        if ((readlen = read(client,
+                            buf,
+                            request.dgram.len < sizeof(buf)?
+                            request.dgram.len: sizeof(buf))) <= 0) {
+            goto error_io;
+        }
+
+        request.dgram.len -= readlen;
+    }
+
+    return respond(server,
+                   client,
+                   response.ret,
+                   response.eno,
+                   &response,
+                   sizeof(response));
+
+error_io:
+    return -1;
+}
+
+/*
+ * Hold a tagged recvfrom() request until a datagram arrives for the socket
+ */
+static int server_recvfrom(patty_ax25_server *server,
+                           int client) {
+    patty_client_recvfrom_request request;
+    patty_client_sendto_response response;
+
+    patty_ax25_sock *sock;
+    struct listener *listener;
+
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
+        goto error_io;
+    }
+
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
+        response.ret = -1;
+        response.eno = EBADF;
+
+        goto error_sock_by_fd;
+    }
+
+    if (sock->type != PATTY_AX25_SOCK_DGRAM) {
+        response.ret = -1;
+        response.eno = EOPNOTSUPP;
+
+        goto error_invalid_type;
+    }
+
+    if (server->request < 0) {
+        response.ret = -1;
+        response.eno = EINVAL;
+
+        goto error_untagged;
+    }
+
+    if ((listener = listener_get(server, client, sock)) == NULL) {
+        goto error_io;
+    }
+
+    if (patty_list_append(listener->requests,
+                          (void *)(intptr_t)(server->request + 1)) == NULL) {
+        goto error_io;
+    }
+
+    return 0;
+
+error_untagged:
+error_invalid_type:
+error_sock_by_fd:
+    return respond(server,
+                   client,
+                   response.ret,
+                   response.eno,
+                   &response,
+                   sizeof(response));
 
 error_io:
     return -1;
 }
 
+static int server_getsockopt(patty_ax25_server *server,
+                             int client) {
+    patty_client_getsockopt_request request;
+    patty_client_getsockopt_response response = {
+        .ret = 0,
+        .eno = 0,
+        .len = 0
+    };
+
+    uint8_t buf[sizeof(response) + sizeof(size_t)];
+
+    patty_ax25_sock *sock;
+
+    if (request_read(server, client, &request, sizeof(request)) < 0) {
+        return -1;
+    }
+
+    if ((sock = request_sock(server, client, request.fd)) == NULL) {
+        response.ret = -1;
+        response.eno = EBADF;
+
+        goto error_sock_by_fd;
+    }
+
+    switch (request.opt) {
+        case PATTY_AX25_SOCK_SUB_DROPPED:
+            if (sock->type != PATTY_AX25_SOCK_DGRAM) {
+                response.ret = -1;
+                response.eno = EINVAL;
+
+                break;
+            }
+
+            response.len = sizeof(sock->sub_dropped);
+
+            memcpy(buf + sizeof(response),
+                   &sock->sub_dropped,
+                   sizeof(sock->sub_dropped));
+
+            break;
+
+        default:
+            response.ret = -1;
+            response.eno = EINVAL;
+    }
+
+error_sock_by_fd:
+    memcpy(buf, &response, sizeof(response));
+
+    return respond(server,
+                   client,
+                   response.ret,
+                   response.eno,
+                   buf,
+                   sizeof(response) + response.len);
+}
+
 static patty_ax25_server_call server_calls[PATTY_CLIENT_CALL_COUNT] = {
     NULL,
     server_ping,
@@ -1046,8 +3381,9 @@ static patty_ax25_server_call server_calls[PATTY_CLIENT_CALL_COUNT] = {
     server_accept,
     server_connect,
     server_close,
-    NULL,
-    NULL
+    server_sendto,
+    server_recvfrom,
+    server_getsockopt
 };
 
 static int listen_unix(patty_ax25_server *server, const char *path) {
@@ -1098,6 +3434,7 @@ static int accept_client(patty_ax25_server *server) {
     struct sockaddr addr;
     socklen_t addrlen = sizeof(addr);
     patty_dict *socks;
+    struct client *client;
 
     memset(&addr, '\0', addrlen);
 
@@ -1113,7 +3450,11 @@ static int accept_client(patty_ax25_server *server) {
         goto error_dict_new;
     }
 
-    if (patty_dict_set(server->clients, (uint32_t)fd, NULL + fd) == NULL) {
+    if ((client = client_new(fd)) == NULL) {
+        goto error_client_new;
+    }
+
+    if (patty_dict_set(server->clients, (uint32_t)fd, client) == NULL) {
         goto error_dict_set_clients;
     }
 
@@ -1127,7 +3468,12 @@ done:
     return 0;
 
 error_dict_set_socks_by_client:
+    (void)patty_dict_delete(server->clients, (uint32_t)fd);
+
 error_dict_set_clients:
+    client_destroy(client);
+
+error_client_new:
     patty_dict_destroy(socks);
 
 error_dict_new:
@@ -1151,61 +3497,214 @@ error_sock_shutdown:
     return -1;
 }
 
+static int client_drop(patty_ax25_server *server, struct client *client) {
+    patty_dict *socks;
+    int fd = client->fd;
+
+    fd_clear(server, fd);
+
+    if ((socks = patty_dict_get(server->socks_by_client, fd)) != NULL) {
+        (void)patty_dict_each(socks, client_sock_close, server);
+        (void)patty_dict_destroy(socks);
+    }
+
+    if (patty_dict_delete(server->socks_by_client, (uint32_t)fd) < 0) {
+        goto error_dict_delete_socks_by_client;
+    }
+
+    if (patty_dict_delete(server->clients, (uint32_t)fd) < 0) {
+        goto error_dict_delete_clients;
+    }
+
+    client_destroy(client);
+
+    if (close(fd) < 0) {
+        goto error_close;
+    }
+
+    return 0;
+
+error_dict_delete_socks_by_client:
+error_dict_delete_clients:
+error_close:
+    return -1;
+}
+
+static int handle_call(patty_ax25_server *server, int client, int call) {
+    if (call <= PATTY_CLIENT_NONE || call >= PATTY_CLIENT_CALL_COUNT) {
+        return 0;
+    }
+
+    if (server_calls[call] == NULL) {
+        return 0;
+    }
+
+    return server_calls[call](server, client);
+}
+
+/*
+ * Handle every complete framed message received from a client so far; any
+ * trailing partial message is kept until the rest of it arrives
+ */
+static int handle_batch(patty_ax25_server *server, struct client *client) {
+    size_t offset = 0;
+    int ret = 0;
+
+    server->batch = client;
+
+    while (client->rx_len - offset >= sizeof(patty_client_message)) {
+        patty_client_message header;
+
+        memcpy(&header, client->rx_buf + offset, sizeof(header));
+
+        /*
+         * A client which violates the framing cannot be resynchronised, so
+         * drop it, along with all of its sockets
+         */
+        if (header.magic != PATTY_CLIENT_MAGIC
+         || header.len > PATTY_CLIENT_BATCH_MAX - sizeof(header)) {
+            goto error_proto;
+        }
+
+        if (client->rx_len - offset < sizeof(header) + header.len) {
+            break;
+        }
+
+        server->request    = header.id;
+        server->msg        = client->rx_buf + offset + sizeof(header);
+        server->msg_len    = header.len;
+        server->msg_offset = 0;
+
+        if (header.version != PATTY_CLIENT_VERSION) {
+            ret = respond(server, client->fd, -1, EPROTONOSUPPORT, NULL, 0);
+        } else {
+            ret = handle_call(server, client->fd, header.call);
+        }
+
+        offset += sizeof(header) + header.len;
+
+        if (ret < 0) {
+            break;
+        }
+    }
+
+    memmove(client->rx_buf, client->rx_buf + offset, client->rx_len - offset);
+
+    client->rx_len -= offset;
+
+    server->batch   = NULL;
+    server->request = -1;
+    server->msg     = NULL;
+
+    if (client_flush(client) < 0) {
+        return -1;
+    }
+
+    return ret < 0? -1: 0;
+
+error_proto:
+    server->batch   = NULL;
+    server->request = -1;
+    server->msg     = NULL;
+
+    return client_drop(server, client);
+}
+
+/*
+ * Take in as much as the client has sent without waiting for more, then
+ * handle it as a single batch
+ */
+static int handle_framed(patty_ax25_server *server, struct client *client) {
+    ssize_t readlen;
+
+    if ((readlen = recv(client->fd,
+                        client->rx_buf + client->rx_len,
+                        PATTY_CLIENT_BATCH_MAX - client->rx_len,
+                        MSG_DONTWAIT)) < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            goto error_recv;
+        }
+    } else if (readlen == 0) {
+        return client_drop(server, client);
+    } else {
+        client->rx_len += readlen;
+    }
+
+    return handle_batch(server, client);
+
+error_recv:
+    return -1;
+}
+
 static int handle_client(uint32_t key,
                          void *value,
                          void *ctx) {
     patty_ax25_server *server = ctx;
+    struct client *state = value;
     int client = (int)key;
 
     ssize_t readlen;
-    enum patty_client_call call;
+    int call;
+
+    int ret;
 
     if (!FD_ISSET(client, &server->fds_r)) {
         goto done;
     }
 
+    if (state->framed) {
+        return handle_framed(server, state);
+    }
+
     if ((readlen = read(client, &call, sizeof(call))) < 0) {
         goto error_io;
     } else if (readlen == 0) {
-        patty_dict *socks;
-
-        fd_clear(server, client);
+        return client_drop(server, state);
+    }
 
-        if ((socks = patty_dict_get(server->socks_by_client, client)) != NULL) {
-            (void)patty_dict_each(socks, client_sock_close, server);
-            (void)patty_dict_destroy(socks);
+    /*
+     * A connection whose first word is the framing magic number carries
+     * only framed messages from then on; the magic number read here is the
+     * start of the first message
+     */
+    if (call == PATTY_CLIENT_MAGIC) {
+        if ((state->rx_buf = malloc(PATTY_CLIENT_BATCH_MAX)) == NULL) {
+            goto error_io;
         }
 
-        if (patty_dict_delete(server->socks_by_client, key) < 0) {
-            goto error_dict_delete_socks_by_client;
+        if ((state->tx_buf = malloc(PATTY_CLIENT_BATCH_MAX)) == NULL) {
+            goto error_io;
         }
 
-        if (patty_dict_delete(server->clients, key) < 0) {
-            goto error_dict_delete_clients;
-        }
+        memcpy(state->rx_buf, &call, sizeof(call));
+
+        state->framed = 1;
+        state->rx_len = sizeof(call);
+
+        return handle_framed(server, state);
+    }
+
+    if (call & PATTY_CLIENT_TAGGED) {
+        uint32_t id;
 
-        if (close(client) < 0) {
+        if (read(client, &id, sizeof(id)) < 0) {
             goto error_io;
         }
 
-        goto done;
-    }
+        call &= ~PATTY_CLIENT_TAGGED;
 
-    if (call <= PATTY_CLIENT_NONE || call >= PATTY_CLIENT_CALL_COUNT) {
-        goto done;
+        server->request = id;
     }
 
-    if (server_calls[call] == NULL) {
-        goto done;
-    }
+    ret = handle_call(server, client, call);
 
-    return server_calls[call](server, client);
+    server->request = -1;
+
+    return ret;
 
 done:
     return 0;
 
-error_dict_delete_socks_by_client:
-error_dict_delete_clients:
 error_io:
     return -1;
 }
@@ -1218,7 +3717,7 @@ static void save_reply_addr(patty_ax25_sock *sock,
                             patty_ax25_frame *frame) {
     unsigned int i,
                  hops = frame->hops > PATTY_AX25_MAX_HOPS?
-                                      PATTY_AX25_MAX_HOPS: sock->hops;
+                                      PATTY_AX25_MAX_HOPS: frame->hops;
 
     memcpy(&sock->remote, &frame->src,  sizeof(patty_ax25_addr));
     memcpy(&sock->local,  &frame->dest, sizeof(patty_ax25_addr));
@@ -1355,6 +3854,10 @@ static int handle_frmr(patty_ax25_server *server,
 
     switch (sock->state) {
         case PATTY_AX25_SOCK_PENDING_CONNECT:
+            if (sock->xid_cached) {
+                return connect_renegotiate(server, sock);
+            }
+
             if (sock->state == PATTY_AX25_SOCK_PENDING_CONNECT) {
                 sock->retries = sock->n_retry;
 
@@ -1382,6 +3885,7 @@ static int handle_sabm(patty_ax25_server *server,
         created = 0;
 
     patty_ax25_sock *local, *remote;
+    struct listener *listener;
 
     if ((local = sock_by_addr(server->socks_local,
                               &frame->dest)) == NULL
@@ -1390,22 +3894,39 @@ static int handle_sabm(patty_ax25_server *server,
         goto reply_dm;
     }
 
+    remote = sock_by_addrpair(server, &frame->dest, &frame->src);
+
+    local = group_select(server, local, &frame->src, remote);
+
     if ((client = client_by_sock(server, local)) < 0) {
         goto error_client_by_sock;
     }
 
+    /*
+     * Once the backlog is full, ignore new connections rather than refuse
+     * them, so that their peers retry once the backlog has room
+     */
+    if ((remote == NULL || remote->state == PATTY_AX25_SOCK_PENDING_ACCEPT)
+     && (listener = patty_dict_get(server->listeners,
+                                   (uint32_t)local->fd)) != NULL
+     && listener_pending(listener) >= (size_t)local->backlog) {
+        return 0;
+    }
+
     /*
      * Look to see if there is already a remote socket created based on an XID
      * packet previously received.
      */
-    if ((remote = sock_by_addrpair(server->socks_remote,
-                                   &frame->dest,
-                                   &frame->src)) == NULL) {
+    if (remote == NULL) {
+        if (!link_admit(server, local, &frame->src)) {
+            goto reply_dm;
+        }
+
         /*
          * If there is no existing remote socket, we should create one, and
          * associate it with the client.
          */
-        if ((remote = patty_ax25_sock_new(local->proto, local->type)) == NULL) {
+        if ((remote = patty_ax25_sock_new(local->proto, accept_type(local))) == NULL) {
             goto error_sock_new;
         }
 
@@ -1446,6 +3967,10 @@ static int handle_sabm(patty_ax25_server *server,
     patty_ax25_sock_bind_if(remote, iface);
 
     if (created) {
+        if (link_open(server, local, remote) < 0) {
+            goto error_link_open;
+        }
+
         if (sock_save(server, client, remote) < 0) {
             goto error_sock_save;
         }
@@ -1453,7 +3978,7 @@ static int handle_sabm(patty_ax25_server *server,
 
     fd_watch(server, remote->fd);
 
-    if (notify_accept(local->fd, remote->fd, &remote->remote, remote->pty) < 0) {
+    if (notify_accept(server, local, remote) < 0) {
         goto error_notify_accept;
     }
 
@@ -1465,8 +3990,11 @@ reply_dm:
     return reply_dm(iface, frame, PATTY_AX25_FRAME_FINAL);
 
 error_notify_accept:
-error_sock_realloc_bufs:
 error_sock_save:
+    link_close(server, remote);
+
+error_link_open:
+error_sock_realloc_bufs:
     patty_ax25_sock_destroy(remote);
 
 error_sock_new:
@@ -1531,7 +4059,7 @@ static int handle_ua(patty_ax25_server *server,
 
     fd_watch(server, sock->fd);
 
-    return respond_connect(client, 0, 0);
+    return respond_connect(server, client, sock, 0, 0);
 
 error_sock_save:
 error_sock_realloc_bufs:
@@ -1551,13 +4079,25 @@ static int handle_dm(patty_ax25_server *server,
         case PATTY_AX25_SOCK_PENDING_CONNECT: {
             int client;
 
+            if (sock->xid_cached) {
+                return connect_renegotiate(server, sock);
+            }
+
             if ((client = client_by_sock(server, sock)) < 0) {
                 goto error_client_by_sock;
             }
 
+            /*
+             * Parameters taken from an XID exchange may call for a larger
+             * window than the buffers were last sized for
+             */
+            if (patty_ax25_sock_realloc_bufs(sock) < 0) {
+                goto error_sock_realloc_bufs;
+            }
+
             patty_ax25_sock_reset(sock);
 
-            return respond_connect(client, -1, ECONNREFUSED);
+            return respond_connect(server, client, sock, -1, ECONNREFUSED);
         }
 
         case PATTY_AX25_SOCK_PENDING_DISCONNECT:
@@ -1571,6 +4111,7 @@ static int handle_dm(patty_ax25_server *server,
 
     return 0;
 
+error_sock_realloc_bufs:
 error_client_by_sock:
     return -1;
 }
@@ -1658,14 +4199,26 @@ static int handle_i(patty_ax25_server *server,
 
     frame_ack(server, sock, frame);
 
-    if (frame->ns == sock->vr) {
-        patty_ax25_sock_vr_incr(sock);
-    } else if (frame->ns == sock->vr + 1) {
-        return patty_ax25_sock_send_srej(sock, PATTY_AX25_FRAME_RESPONSE);
-    } else if (frame->ns > sock->vr + 1) {
-        return patty_ax25_sock_send_rej(sock, PATTY_AX25_FRAME_RESPONSE, 1);
+    if (frame->ns != sock->vr) {
+        unsigned int mask  = sock->mode == PATTY_AX25_SOCK_SABM? 0x07: 0x7f,
+                     ahead = (frame->ns - sock->vr) & mask;
+
+        if (ahead == 1) {
+            return patty_ax25_sock_send_srej(sock, PATTY_AX25_FRAME_RESPONSE);
+        } else if (ahead <= sock->n_window_rx) {
+            return patty_ax25_sock_send_rej(sock, PATTY_AX25_FRAME_RESPONSE, 1);
+        }
+
+        /*
+         * The frame was received already, and its acknowledgement lost;
+         * discard it rather than deliver its contents twice
+         */
+        return frame->pf?
+            patty_ax25_sock_send_rr(sock, PATTY_AX25_FRAME_RESPONSE, 1): 0;
     }
 
+    patty_ax25_sock_vr_incr(sock);
+
     if (frame->proto == PATTY_AX25_PROTO_FRAGMENT) {
         if (handle_segment(server, iface, sock, frame) < 0) {
             goto error_handle_segment;
@@ -1714,19 +4267,171 @@ error_write:
     return -1;
 }
 
+static void dgram_header(patty_client_dgram *dgram,
+                         patty_ax25_frame *frame) {
+    unsigned int hops = frame->hops > PATTY_AX25_MAX_HOPS?
+                                      PATTY_AX25_MAX_HOPS: frame->hops;
+
+    memset(dgram, '\0', sizeof(*dgram));
+
+    memcpy(&dgram->peer, &frame->src, sizeof(dgram->peer));
+    memcpy(dgram->path.repeaters,
+           frame->repeaters,
+           hops * sizeof(patty_ax25_addr));
+
+    dgram->path.hops = hops;
+    dgram->len       = frame->infolen;
+}
+
+/*
+ * Hand a datagram to the oldest outstanding recvfrom() request, or else
+ * write it to the socket's data channel; sockets with a SOCK_SEQPACKET
+ * channel which are not connected receive each datagram as a single message
+ * prefixed with its addressing, gathered straight from the received frame
+ */
+static int dgram_deliver(patty_ax25_server *server,
+                         patty_ax25_sock *sock,
+                         patty_ax25_frame *frame) {
+    patty_client_dgram dgram;
+    struct listener *listener;
+
+    dgram_header(&dgram, frame);
+
+    if ((listener = patty_dict_get(server->listeners,
+                                   (uint32_t)sock->fd)) != NULL
+     && patty_list_length(listener->requests)) {
+        uint8_t msg[PATTY_CLIENT_REPLY_MAX];
+
+        uint32_t id = (uint32_t)((intptr_t)patty_list_shift(listener->requests) - 1);
+
+        size_t len = frame->infolen < sizeof(msg) - sizeof(dgram)?
+                     frame->infolen: sizeof(msg) - sizeof(dgram);
+
+        memcpy(msg, &dgram, sizeof(dgram));
+        memcpy(msg + sizeof(dgram), frame->info, len);
+
+        (void)reply(listener->client,
+                    id,
+                    frame->infolen,
+                    0,
+                    msg,
+                    sizeof(dgram) + len,
+                    NULL,
+                    0);
+
+        return 0;
+    }
+
+    if (sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET
+     && sock->remote.callsign[0] == '\0') {
+        struct iovec iov[2] = {
+            { .iov_base = &dgram,       .iov_len = sizeof(dgram)  },
+            { .iov_base = frame->info,  .iov_len = frame->infolen }
+        };
+
+        struct msghdr msg = {
+            .msg_iov    = iov,
+            .msg_iovlen = 2
+        };
+
+        /*
+         * Datagrams are dropped, rather than waited on, when the client
+         * falls behind
+         */
+        if (sendmsg(sock->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0
+         && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            sock->sub_dropped++;
+        }
+
+        return 0;
+    }
+
+    /*
+     * As are datagrams for subscribers, which may otherwise stop the daemon
+     * for every UI frame received for as long as they stop reading
+     */
+    if (sock->sub_buf) {
+        return patty_ax25_sock_sub_send(sock, frame->info, frame->infolen);
+    }
+
+    if (sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET) {
+        if (send(sock->fd,
+                 frame->info,
+                 frame->infolen,
+                 MSG_DONTWAIT | MSG_NOSIGNAL) < 0
+         && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            sock->sub_dropped++;
+        }
+
+        return 0;
+    }
+
+    return write(sock->fd, frame->info, frame->infolen);
+}
+
+struct fanout {
+    patty_ax25_server *server;
+    patty_ax25_sock *addressed;
+    patty_ax25_frame *frame;
+};
+
+static int fanout_sock(uint32_t key, void *value, void *ctx) {
+    struct fanout *fanout = ctx;
+    patty_ax25_sock *sock = value;
+
+    /*
+     * The socket the frame is addressed to, if any, receives it only once
+     */
+    if (sock == fanout->addressed
+     || !patty_ax25_sock_sub_match(sock, fanout->frame)) {
+        return 0;
+    }
+
+    (void)dgram_deliver(fanout->server, sock, fanout->frame);
+
+    return 0;
+}
+
 static int handle_ui(patty_ax25_server *server,
                      patty_ax25_if *iface,
                      patty_ax25_sock *sock,
                      patty_ax25_frame *frame) {
-    if (sock == NULL || sock->type != PATTY_AX25_SOCK_DGRAM) {
-        return 0;
-    }
+    struct fanout fanout = {
+        .server = server,
+        .frame  = frame
+    };
 
+    /*
+     * Reassembly of segmented datagrams is only supported for connected
+     * sockets
+     */
     if (frame->proto == PATTY_AX25_PROTO_FRAGMENT) {
-        return handle_segment(server, iface, sock, frame);
+        return sock && sock->type == PATTY_AX25_SOCK_DGRAM?
+            handle_segment(server, iface, sock, frame): 0;
     }
 
-    return write(sock->fd, frame->info, frame->infolen);
+    if (sock == NULL) {
+        /*
+         * Otherwise, look for a datagram socket bound to the destination
+         * which is not connected to any one peer
+         */
+        if ((sock = sock_by_addr(server->socks_local, &frame->dest)) != NULL
+         && (sock->type != PATTY_AX25_SOCK_DGRAM
+          || sock->remote.callsign[0] != '\0')) {
+            sock = NULL;
+        }
+    } else if (sock->type != PATTY_AX25_SOCK_DGRAM) {
+        sock = NULL;
+    }
+
+    /*
+     * Dispatch the frame, decoded only the once, to every subscriber
+     */
+    fanout.addressed = sock;
+
+    (void)patty_dict_each(server->subscribers, fanout_sock, &fanout);
+
+    return sock? dgram_deliver(server, sock, frame): 0;
 }
 
 static int handle_disc(patty_ax25_server *server,
@@ -1873,7 +4578,7 @@ static int handle_xid(patty_ax25_server *server,
      * First, check if this XID packet is a response to an XID used to initiate
      * an outbound connection.
      */
-    if ((remote = sock_by_addrpair(server->socks_remote,
+    if ((remote = sock_by_addrpair(server,
                                    &frame->dest,
                                    &frame->src)) != NULL) {
         if (remote->state != PATTY_AX25_SOCK_PENDING_CONNECT) {
@@ -1896,9 +4601,11 @@ static int handle_xid(patty_ax25_server *server,
             patty_ax25_sock_init(remote);
             patty_ax25_sock_reset(remote);
 
-            return respond_connect(client, -1, errno);
+            return respond_connect(server, client, remote, -1, errno);
         }
 
+        (void)xid_cache_put(server, &frame->src, &params);
+
         /*
          * Since this XID frame is for a socket that is awaiting outbound
          * connection, we can send an SABM or SABME packet, as necessary.
@@ -1928,11 +4635,17 @@ static int handle_xid(patty_ax25_server *server,
             goto reply_dm;
         }
 
+        local = group_select(server, local, &frame->src, NULL);
+
+        if (!link_admit(server, local, &frame->src)) {
+            goto reply_dm;
+        }
+
         if ((client = client_by_sock(server, local)) < 0) {
             goto error_client_by_sock;
         }
 
-        if ((remote = patty_ax25_sock_new(local->proto, local->type)) == NULL) {
+        if ((remote = patty_ax25_sock_new(local->proto, accept_type(local))) == NULL) {
             goto error_sock_new;
         }
 
@@ -1950,8 +4663,14 @@ static int handle_xid(patty_ax25_server *server,
             goto error_sock_params_negotiate;
         }
 
+        (void)xid_cache_put(server, &frame->src, &params);
+
         save_reply_addr(remote, frame);
 
+        if (link_open(server, local, remote) < 0) {
+            goto error_link_open;
+        }
+
         if (sock_save(server, client, remote) < 0) {
             goto error_sock_save;
         }
@@ -1968,20 +4687,315 @@ static int handle_xid(patty_ax25_server *server,
 reply_dm:
     return reply_dm(iface, frame, PATTY_AX25_FRAME_FINAL);
 
-error_sock_save:
-error_sock_params_negotiate:
-    patty_ax25_sock_destroy(remote);
+error_sock_save:
+    link_close(server, remote);
+
+error_link_open:
+error_sock_params_negotiate:
+    patty_ax25_sock_destroy(remote);
+
+error_sock_new:
+error_client_by_sock:
+error_io:
+    return -1;
+}
+
+/*
+ * Whether a repeater address is a WIDEn-N hop, with n no greater than wide,
+ * and N remaining no greater than n
+ */
+static int digi_wide_hop(patty_ax25_addr *hop, int wide) {
+    const uint8_t *callsign = (const uint8_t *)hop->callsign;
+    const char *prefix = "WIDE";
+    int i, n, remaining;
+
+    for (i=0; i<4; i++) {
+        if ((callsign[i] >> 1) != prefix[i]) {
+            return 0;
+        }
+    }
+
+    n         = (callsign[4] >> 1) - '0';
+    remaining = PATTY_AX25_ADDR_SSID_NUMBER(hop->ssid);
+
+    if ((callsign[5] >> 1) != ' ') {
+        return 0;
+    }
+
+    return n >= 1 && n <= wide && remaining >= 1 && remaining <= n;
+}
+
+/*
+ * Digipeat a frame whose next hop yet to repeat it names the interface it
+ * was heard on, by one of its addresses or aliases, or is a WIDEn-N hop it
+ * honours.  The address field of that hop is rewritten in place: a hop
+ * naming this station takes on the address of the interface and is marked
+ * as repeated, whereas a WIDEn-N hop has N decremented, and is only marked
+ * as repeated once N reaches zero.  Returns 1 if the frame was repeated, or
+ * dropped as a duplicate, or 0 if it is not for this station to repeat.
+ */
+static int handle_digi(patty_ax25_server *server,
+                       struct if_entry *entry,
+                       patty_ax25_frame *frame,
+                       uint8_t *buf,
+                       size_t len) {
+    patty_ax25_addr *hop;
+    uint8_t *field;
+    size_t control = (2 + frame->hops) * sizeof(patty_ax25_addr);
+    unsigned int i;
+
+    if (entry->digi == NULL) {
+        return 0;
+    }
+
+    for (i=0; i<frame->hops; i++) {
+        if (!PATTY_AX25_ADDR_SSID_REPEATED(frame->repeaters[i].ssid)) {
+            break;
+        }
+    }
+
+    if (i == frame->hops) {
+        return 0;
+    }
+
+    hop   = &frame->repeaters[i];
+    field = buf + (2 + i) * sizeof(patty_ax25_addr);
+
+    if (digi_wide_hop(hop, entry->digi_wide)) {
+        uint8_t remaining = PATTY_AX25_ADDR_SSID_NUMBER(hop->ssid) - 1;
+
+        field[6] = (field[6] & ~0x1e) | (remaining << 1);
+
+        if (remaining == 0) {
+            field[6] |= 0x80;
+        }
+    } else if (patty_ax25_if_addr_match(entry->iface, hop)) {
+        memcpy(field,
+               entry->iface->addr.callsign,
+               sizeof(entry->iface->addr.callsign));
+
+        field[6] = (field[6] & 0x61)
+                 | (entry->iface->addr.ssid & 0x1e)
+                 | 0x80;
+    } else {
+        return 0;
+    }
+
+    /*
+     * Copies of a UI frame heard once already, whether directly or by way of
+     * another digipeater, are not repeated again within the window; frames
+     * of connected mode links are left alone, lest retransmissions be lost
+     */
+    if (server->dupes_digi && len > control
+                           && (buf[control] & ~0x10) == 0x03
+                           && patty_ax25_dedup_seen(server->dupes_digi,
+                                                    buf,
+                                                    len) == 1) {
+        return 1;
+    }
+
+    if (patty_ax25_if_send(entry->digi, buf, len) < 0) {
+        goto error_if_send;
+    }
+
+    return 1;
+
+error_if_send:
+    return -1;
+}
+
+static struct bridge_entry *bridge_get(patty_ax25_server *server,
+                                       patty_ax25_addr *station) {
+    struct bridge_entry *entry;
+
+    if ((entry = patty_dict_get(server->bridge, hash_addr(station))) == NULL) {
+        return NULL;
+    }
+
+    if (!addr_equal(&entry->station, station)
+     || entry->expires <= server->now.tv_sec) {
+        return NULL;
+    }
+
+    return entry;
+}
+
+/*
+ * Remember the interface a station was heard on; once the table is full, the
+ * entry made longest ago is evicted
+ */
+static int bridge_learn(patty_ax25_server *server,
+                        patty_ax25_addr *station,
+                        patty_ax25_if *iface) {
+    uint32_t hash = hash_addr(station);
+    struct bridge_entry *entry;
+
+    if ((entry = patty_dict_get(server->bridge, hash)) != NULL
+     && addr_equal(&entry->station, station)) {
+        entry->iface   = iface;
+        entry->expires = server->now.tv_sec + PATTY_AX25_SERVER_BRIDGE_TTL;
+
+        return 0;
+    }
+
+    if (patty_list_length(server->bridge_order) >= PATTY_AX25_SERVER_BRIDGE_MAX) {
+        struct bridge_entry *oldest = patty_list_shift(server->bridge_order);
+
+        if (patty_dict_get(server->bridge, hash_addr(&oldest->station)) == oldest) {
+            (void)patty_dict_delete(server->bridge, hash_addr(&oldest->station));
+        }
+
+        free(oldest);
+    }
+
+    if ((entry = malloc(sizeof(*entry))) == NULL) {
+        goto error_malloc_entry;
+    }
+
+    memcpy(&entry->station, station, sizeof(entry->station));
+
+    entry->iface   = iface;
+    entry->expires = server->now.tv_sec + PATTY_AX25_SERVER_BRIDGE_TTL;
+
+    if (patty_list_append(server->bridge_order, entry) == NULL) {
+        goto error_list_append;
+    }
+
+    if (patty_dict_set(server->bridge, hash, entry) == NULL) {
+        goto error_dict_set;
+    }
+
+    return 0;
+
+error_dict_set:
+    /*
+     * The entry is freed once evicted from the list
+     */
+    entry->expires = 0;
+
+    return -1;
+
+error_list_append:
+    free(entry);
+
+error_malloc_entry:
+    return -1;
+}
+
+/*
+ * Whether a destination is served by this station, by the address or alias
+ * of any interface, or by a locally bound socket
+ */
+static int bridge_local(patty_ax25_server *server, patty_ax25_addr *dest) {
+    patty_list_item *item;
+
+    for (item = server->ifaces->first; item; item = item->next) {
+        struct if_entry *entry = item->value;
+
+        if (patty_ax25_if_addr_match(entry->iface, dest)) {
+            return 1;
+        }
+    }
+
+    return sock_by_addr(server->socks_local, dest) != NULL;
+}
+
+/*
+ * Whether a frame has been repeated by any digipeater on its path
+ */
+static int frame_repeated(patty_ax25_frame *frame) {
+    unsigned int i;
+
+    for (i=0; i<frame->hops; i++) {
+        if (PATTY_AX25_ADDR_SSID_REPEATED(frame->repeaters[i].ssid)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Learn the interface the source of a frame heard on a bridged interface was
+ * heard on, unless the frame was heard by way of a digipeater, and unless the
+ * frame is for this station, forward it to the interface its destination was
+ * last heard on, or flood it to all other bridged interfaces if the
+ * destination is not known.  Frames whose destination was last heard on the
+ * interface they arrived on are not forwarded at all, nor are copies of a
+ * frame heard again on the same interface within a short window, such as
+ * those looping back by way of another bridge.  Returns 1 if the frame is
+ * bridged for another station, or 0 if it is for this station to handle.
+ */
+static int handle_bridge(patty_ax25_server *server,
+                         struct if_entry *entry,
+                         patty_ax25_frame *frame,
+                         void *buf,
+                         size_t len) {
+    struct bridge_entry *dest;
+    patty_list_item *item;
+    uint32_t tag;
+
+    if (!entry->bridged) {
+        return 0;
+    }
+
+    if (!frame_repeated(frame)) {
+        if (bridge_learn(server, &frame->src, entry->iface) < 0) {
+            goto error_bridge_learn;
+        }
+    }
+
+    if (bridge_local(server, &frame->dest)) {
+        return 0;
+    }
+
+    patty_hash_init(&tag);
+    patty_hash_data(&tag, entry->name, strlen(entry->name));
+    patty_hash_end(&tag);
+
+    if (patty_ax25_dedup_seen_tagged(server->dupes_bridge,
+                                     tag,
+                                     buf,
+                                     len) == 1) {
+        return 1;
+    }
+
+    if ((dest = bridge_get(server, &frame->dest)) != NULL) {
+        if (dest->iface == entry->iface) {
+            return 1;
+        }
+
+        if (patty_ax25_if_send(dest->iface, buf, len) < 0) {
+            goto error_if_send;
+        }
+
+        return 1;
+    }
+
+    for (item = server->ifaces->first; item; item = item->next) {
+        struct if_entry *other = item->value;
+
+        if (other == entry || !other->bridged) {
+            continue;
+        }
+
+        if (patty_ax25_if_send(other->iface, buf, len) < 0) {
+            goto error_if_send;
+        }
+    }
+
+    return 1;
 
-error_sock_new:
-error_client_by_sock:
-error_io:
+error_if_send:
+error_bridge_learn:
     return -1;
 }
 
 static int handle_frame(patty_ax25_server *server,
-                        patty_ax25_if *iface,
+                        struct if_entry *entry,
                         void *buf,
                         size_t len) {
+    patty_ax25_if *iface = entry->iface;
     patty_ax25_frame frame;
     enum patty_ax25_frame_format format = PATTY_AX25_FRAME_NORMAL;
 
@@ -1990,13 +5004,35 @@ static int handle_frame(patty_ax25_server *server,
 
     patty_ax25_sock *sock;
 
+    int digipeated = 0,
+        bridged    = 0;
+
     if ((decoded = patty_ax25_frame_decode_address(&frame, buf, len)) < 0) {
         goto error_decode;
     } else {
         offset += decoded;
     }
 
-    if ((sock = sock_by_addrpair(server->socks_remote,
+    if (patty_ax25_mheard_update(server->mheard,
+                                 iface,
+                                 &frame,
+                                 server->now.tv_sec) < 0) {
+        goto error_mheard_update;
+    }
+
+    if (frame.hops) {
+        if ((digipeated = handle_digi(server, entry, &frame, buf, len)) < 0) {
+            goto error_digi;
+        }
+    }
+
+    if (!digipeated) {
+        if ((bridged = handle_bridge(server, entry, &frame, buf, len)) < 0) {
+            goto error_bridge;
+        }
+    }
+
+    if ((sock = sock_by_addrpair(server,
                                  &frame.dest,
                                  &frame.src)) != NULL) {
         if (sock->mode == PATTY_AX25_SOCK_SABME) {
@@ -2010,6 +5046,24 @@ static int handle_frame(patty_ax25_server *server,
         offset += decoded;
     }
 
+    /*
+     * Of frames repeated by this station, or bridged for other stations, only
+     * UI frames are of interest to local sockets
+     */
+    if ((digipeated || bridged) && frame.type != PATTY_AX25_FRAME_UI) {
+        return 0;
+    }
+
+    /*
+     * Drop UI frames already delivered within the window, such as copies
+     * heard once directly and again by way of a digipeater
+     */
+    if (frame.type == PATTY_AX25_FRAME_UI && server->dupes_ui) {
+        if (patty_ax25_dedup_seen(server->dupes_ui, buf, len) == 1) {
+            return 0;
+        }
+    }
+
     switch (frame.type) {
         case PATTY_AX25_FRAME_I:     return handle_i(server, iface, sock, &frame);
         case PATTY_AX25_FRAME_UI:    return handle_ui(server, iface, sock, &frame);
@@ -2033,55 +5087,98 @@ error_decode:
     patty_ax25_if_drop(iface);
 
     return 0;
+
+error_bridge:
+error_digi:
+error_mheard_update:
+    return -1;
 }
 
 static int handle_iface(patty_ax25_server *server, struct if_entry *entry) {
     patty_ax25_if *iface = entry->iface;
 
+    int budget = RX_BUDGET;
+
     ssize_t len;
 
-    if (!patty_ax25_if_ready(entry->iface, &server->fds_r)) {
-        goto done;
+    if (FD_ISSET(entry->fd, &server->fds_w)) {
+        if (patty_ax25_if_transmit(iface) < 0) {
+            goto error_io;
+        }
     }
 
-    if ((len = patty_ax25_if_fill(entry->iface)) < 0) {
-        int fd;
-
-        fd_clear(server, entry->fd);
+    if (entry->backlog) {
+        entry->backlog = 0;
 
-        if ((fd = patty_ax25_if_reset(entry->iface)) < 0) {
-            goto error_io;
+        if (iface->status != PATTY_AX25_IF_UP) {
+            goto done;
+        }
+    } else {
+        if (!patty_ax25_if_ready(entry->iface, &server->fds_r)) {
+            goto done;
         }
 
-        fd_watch(server, entry->fd = fd);
-    } else if (len == 0) {
-        close(entry->fd);
+        if ((len = patty_ax25_if_fill(entry->iface)) < 0) {
+            int fd;
 
-        fd_clear(server, entry->fd);
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                goto done;
+            }
 
-        goto done;
+            fd_clear(server, entry->fd);
+
+            /*
+             * An interface which cannot be reset is left out of service,
+             * rather than bringing down the daemon
+             */
+            if ((fd = patty_ax25_if_reset(entry->iface)) < 0) {
+                goto done;
+            }
+
+            fd_watch(server, entry->fd = fd);
+        } else if (len == 0) {
+            close(entry->fd);
+
+            fd_clear(server, entry->fd);
+
+            goto done;
+        }
     }
 
-    while (1) {
-        ssize_t len;
+    while (budget) {
+        ssize_t drained;
 
-        if ((len = patty_ax25_if_drain(iface, iface->rx_buf, iface->mru)) < 0) {
+        if ((drained = patty_ax25_if_drain(iface, iface->rx_buf, iface->mru)) < 0) {
             goto error_io;
         }
 
         if (!patty_ax25_if_pending(iface)) {
-            break;
+            if (drained == 0) {
+                goto done;
+            }
+
+            continue;
         }
 
         if ((len = patty_ax25_if_flush(iface)) < 0) {
             goto error_io;
         }
 
-        if (handle_frame(server, iface, iface->rx_buf, len) < 0) {
+        if (handle_frame(server, entry, iface->rx_buf, len) < 0) {
             goto error_handle_frame;
         }
+
+        budget--;
     }
 
+    /*
+     * The frame budget for this interface is spent; carry over any input not
+     * yet processed to the next event loop iteration
+     */
+    entry->backlog = 1;
+
+    server->backlog++;
+
 done:
     return 0;
 
@@ -2093,7 +5190,27 @@ error_io:
 static int handle_ifaces(patty_ax25_server *server) {
     patty_list_item *item = server->ifaces->first;
 
-    while (item) {
+    size_t len = patty_list_length(server->ifaces),
+           start,
+           i;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    /*
+     * Rotate the interface serviced first on each iteration, so that no one
+     * interface is consistently favoured over the others
+     */
+    start = server->if_next++ % len;
+
+    for (i=0; i<start; i++) {
+        item = item->next;
+    }
+
+    server->backlog = 0;
+
+    for (i=0; i<len; i++) {
         struct if_entry *entry = item->value;
 
         if (handle_iface(server, entry) < 0) {
@@ -2106,7 +5223,9 @@ static int handle_ifaces(patty_ax25_server *server) {
             }
         }
 
-        item = item->next;
+        if ((item = item->next) == NULL) {
+            item = server->ifaces->first;
+        }
     }
 
     return 0;
@@ -2115,16 +5234,112 @@ error_io:
     return -1;
 }
 
+/*
+ * Defer reading outbound data from a socket while the output queue of its
+ * interface is backed up, leaving the data to back up towards the client.
+ * The socket is not watched in the meantime, lest select() return at once
+ * for as long as the interface is busy.
+ */
+static int sock_iface_busy(patty_ax25_server *server,
+                           patty_ax25_sock *sock) {
+    if (sock->iface == NULL
+     || patty_ax25_if_queued(sock->iface) < PATTY_AX25_IF_QUEUE_HIGH) {
+        return 0;
+    }
+
+    if (patty_dict_set(server->held, (uint32_t)sock->fd, sock) != NULL) {
+        fd_clear(server, sock->fd);
+    }
+
+    return 1;
+}
+
+/*
+ * Watch held back sockets again once the output queue of their interface
+ * has drained below the low watermark
+ */
+static int sock_release(uint32_t key, void *value, void *ctx) {
+    patty_ax25_server *server = ctx;
+    patty_ax25_sock *sock = value;
+
+    if (patty_ax25_if_queued(sock->iface) < PATTY_AX25_IF_QUEUE_LOW) {
+        (void)patty_dict_delete(server->held, key);
+
+        fd_watch(server, sock->fd);
+    }
+
+    return 0;
+}
+
+/*
+ * Read a single addressed datagram from a SOCK_SEQPACKET channel, scattering
+ * its addressing and payload, and send it on its way
+ */
+static int handle_sock_dgram_addressed(patty_ax25_server *server,
+                                       patty_ax25_sock *sock) {
+    patty_client_dgram dgram;
+
+    struct iovec iov[2] = {
+        { .iov_base = &dgram,        .iov_len = sizeof(dgram)     },
+        { .iov_base = sock->io_buf,  .iov_len = sock->n_maxlen_tx }
+    };
+
+    struct msghdr msg = {
+        .msg_iov    = iov,
+        .msg_iovlen = 2
+    };
+
+    ssize_t len;
+
+    if ((len = recvmsg(sock->fd, &msg, 0)) < 0) {
+        goto error_recvmsg;
+    } else if (len == 0) {
+        (void)sock_close(server, sock);
+
+        return 0;
+    }
+
+    /*
+     * Silently drop malformed or oversized datagrams, as a network would
+     */
+    if ((size_t)len < sizeof(dgram) || (msg.msg_flags & MSG_TRUNC)) {
+        return 0;
+    }
+
+    (void)dgram_send(server, sock, &dgram, sock->io_buf, len - sizeof(dgram));
+
+    return 0;
+
+error_recvmsg:
+    return -1;
+}
+
 static int handle_sock_dgram(patty_ax25_server *server,
                              patty_ax25_sock *sock) {
     ssize_t len;
 
-    if (!FD_ISSET(sock->fd, &server->fds_r)) {
+    if (FD_ISSET(sock->fd, &server->fds_w)
+     && patty_ax25_sock_sub_queued(sock) > 0) {
+        if (patty_ax25_sock_sub_flush(sock) < 0) {
+            (void)sock_close(server, sock);
+
+            return 0;
+        }
+    }
+
+    if (!FD_ISSET(sock->fd, &server->fds_r) || sock_iface_busy(server, sock)) {
         return 0;
     }
 
-    if ((len = read(sock->fd, sock->io_buf, sock->n_maxlen_tx)) < 0) {
-        if (errno == EIO) {
+    if (sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET
+     && sock->remote.callsign[0] == '\0') {
+        return handle_sock_dgram_addressed(server, sock);
+    }
+
+    if ((len = sock_read(sock, sock->io_buf, sock->n_maxlen_tx)) < 0) {
+        if (errno == EMSGSIZE || errno == EAGAIN) {
+            return 0;
+        } else if (errno == EIO) {
             (void)sock_close(server, sock);
         } else {
             goto error_unknown;
@@ -2150,10 +5365,45 @@ static int handle_sock_raw(patty_ax25_server *server,
 
     ssize_t len;
 
-    if (!FD_ISSET(sock->fd, &server->fds_r) || raw == NULL || iface == NULL) {
+    if (iface == NULL) {
+        return 0;
+    }
+
+    if (sock->state == PATTY_AX25_SOCK_PROMISC
+     && FD_ISSET(sock->fd, &server->fds_w)) {
+        if (patty_ax25_if_promisc_transmit(iface, sock->fd) < 0) {
+            (void)sock_close(server, sock);
+
+            goto done;
+        }
+    }
+
+    if (!FD_ISSET(sock->fd, &server->fds_r)) {
+        return 0;
+    }
+
+    if (sock_iface_busy(server, sock)) {
         return 0;
     }
 
+    if (raw == NULL) {
+        /*
+         * Raw sockets on SOCK_SEQPACKET channels carry exactly one unframed
+         * packet per message
+         */
+        if ((len = recv(sock->fd, iface->tx_buf, iface->mtu, MSG_TRUNC)) < 0) {
+            goto error_io;
+        } else if (len == 0) {
+            (void)sock_close(server, sock);
+        } else if ((size_t)len <= iface->mtu) {
+            if (patty_ax25_if_send(iface, iface->tx_buf, len) < 0) {
+                goto error_io;
+            }
+        }
+
+        goto done;
+    }
+
     if ((len = patty_kiss_tnc_fill(raw)) < 0) {
         goto error_io;
     } else if (len == 0) {
@@ -2216,6 +5466,8 @@ static int handle_sock(uint32_t key,
         case PATTY_AX25_SOCK_PENDING_ACCEPT:
             if (patty_timer_expired(&sock->timer_t1)) {
                 if (sock->retries--) {
+                    patty_ax25_if_retry(sock->iface);
+
                     patty_timer_start(&sock->timer_t1);
 
                     return patty_ax25_sock_send_xid(sock, PATTY_AX25_FRAME_RESPONSE);
@@ -2228,7 +5480,13 @@ static int handle_sock(uint32_t key,
 
         case PATTY_AX25_SOCK_PENDING_CONNECT:
             if (patty_timer_expired(&sock->timer_t1)) {
+                if (sock->xid_cached) {
+                    connect_fallback(server, sock);
+                }
+
                 if (sock->retries--) {
+                    patty_ax25_if_retry(sock->iface);
+
                     patty_timer_start(&sock->timer_t1);
 
                     return patty_ax25_sock_send_sabm(sock, PATTY_AX25_FRAME_POLL);
@@ -2239,10 +5497,18 @@ static int handle_sock(uint32_t key,
                         goto error_client_by_sock;
                     }
 
+                    /*
+                     * Respond before closing the socket, while any tagged
+                     * request identifier is still known
+                     */
+                    if (respond_connect(server, client, sock, -1, ETIMEDOUT) < 0) {
+                        goto error_respond_connect;
+                    }
+
                     (void)sock_shutdown(server, sock);
                     (void)sock_close(server, sock);
 
-                    return respond_connect(client, -1, ETIMEDOUT);
+                    return 0;
                 }
             }
 
@@ -2251,6 +5517,8 @@ static int handle_sock(uint32_t key,
         case PATTY_AX25_SOCK_ESTABLISHED:
             if (patty_timer_expired(&sock->timer_t1)) {
                 if (sock->retries--) {
+                    patty_ax25_if_retry(sock->iface);
+
                     patty_timer_start(&sock->timer_t1);
 
                     return patty_ax25_sock_resend_pending(sock)
@@ -2289,6 +5557,8 @@ static int handle_sock(uint32_t key,
         case PATTY_AX25_SOCK_PENDING_DISCONNECT:
             if (patty_timer_expired(&sock->timer_t1)) {
                 if (sock->retries--) {
+                    patty_ax25_if_retry(sock->iface);
+
                     patty_timer_start(&sock->timer_t1);
 
                     return patty_ax25_sock_send_disc(sock, PATTY_AX25_FRAME_POLL);
@@ -2301,7 +5571,7 @@ static int handle_sock(uint32_t key,
             break;
     }
 
-    if (!FD_ISSET(sock->fd, &server->fds_r)) {
+    if (!FD_ISSET(sock->fd, &server->fds_r) || sock_iface_busy(server, sock)) {
         return 0;
     }
 
@@ -2329,8 +5599,10 @@ static int handle_sock(uint32_t key,
         return 0;
     }
 
-    if ((len = read(sock->fd, sock->io_buf, sock->n_maxlen_tx)) < 0) {
-        if (errno == EIO) {
+    if ((len = sock_read(sock, sock->io_buf, sock->n_maxlen_tx)) < 0) {
+        if (errno == EMSGSIZE) {
+            return 0;
+        } else if (errno == EIO) {
             (void)sock_shutdown(server, sock);
         } else {
             goto error_unknown;
@@ -2348,6 +5620,7 @@ static int handle_sock(uint32_t key,
 
     return 0;
 
+error_respond_connect:
 error_client_by_sock:
 error_sock_resend_pending:
 error_unknown:
@@ -2358,31 +5631,161 @@ static int handle_socks(patty_ax25_server *server) {
     return patty_dict_each(server->socks_by_fd, handle_sock, server);
 }
 
+static void watch_ifaces_output(patty_ax25_server *server) {
+    patty_list_item *item = server->ifaces->first;
+
+    FD_ZERO(&server->fds_w);
+
+    while (item) {
+        struct if_entry *entry = item->value;
+
+        if (entry->iface->status == PATTY_AX25_IF_UP
+         && entry->iface->thread == NULL
+         && patty_ax25_if_queued(entry->iface) > 0) {
+            FD_SET(entry->fd, &server->fds_w);
+        }
+
+        item = item->next;
+    }
+}
+
+static int watch_sock_output(uint32_t key, void *value, void *ctx) {
+    patty_ax25_server *server = ctx;
+    patty_ax25_sock *sock = value;
+
+    if (sock->type == PATTY_AX25_SOCK_RAW
+     && sock->state == PATTY_AX25_SOCK_PROMISC
+     && sock->iface
+     && patty_ax25_if_promisc_queued(sock->iface, sock->fd) > 0) {
+        FD_SET(sock->fd, &server->fds_w);
+    }
+
+    if (sock->type == PATTY_AX25_SOCK_DGRAM
+     && patty_ax25_sock_sub_queued(sock) > 0) {
+        FD_SET(sock->fd, &server->fds_w);
+    }
+
+    return 0;
+}
+
+/*
+ * Wait for promiscuous listeners and subscribers to read frames queued for
+ * them, without ever blocking on them
+ */
+static void watch_socks_output(patty_ax25_server *server) {
+    (void)patty_dict_each(server->socks_by_fd, watch_sock_output, server);
+}
+
+static int tick_ifaces(patty_ax25_server *server) {
+    patty_list_item *item = server->ifaces->first;
+
+    while (item) {
+        struct if_entry *entry = item->value;
+
+        if (patty_ax25_if_adapt_tick(entry->iface, &server->elapsed) < 0) {
+            if (errno == EIO) {
+                patty_ax25_if_down(entry->iface);
+
+                fd_clear(server, entry->fd);
+            } else {
+                goto error_adapt_tick;
+            }
+        }
+
+        item = item->next;
+    }
+
+    return 0;
+
+error_adapt_tick:
+    return -1;
+}
+
 int patty_ax25_server_start(patty_ax25_server *server, const char *path) {
-    return listen_unix(server, path);
+    patty_list_item *item = server->ifaces->first;
+
+    if (listen_unix(server, path) < 0) {
+        goto error_listen_unix;
+    }
+
+    /*
+     * Interface I/O threads are started here, rather than at configuration
+     * time, so that they are started in the process that will run the event
+     * loop
+     */
+    while (item) {
+        struct if_entry *entry = item->value;
+
+        if (patty_ax25_if_thread_start(entry->iface) < 0) {
+            goto error_if_thread_start;
+        }
+
+        item = item->next;
+    }
+
+    return 0;
+
+error_if_thread_start:
+    (void)close(server->fd);
+
+error_listen_unix:
+    return -1;
 }
 
 int patty_ax25_server_stop(patty_ax25_server *server) {
     return close(server->fd);
 }
 
+/*
+ * Wake tap consumers once per event loop iteration, rather than once per
+ * frame
+ */
+static int signal_taps(patty_ax25_server *server) {
+    patty_list_item *item = server->ifaces->first;
+
+    while (item) {
+        struct if_entry *entry = item->value;
+
+        if (entry->iface->tap) {
+            if (patty_ax25_tap_signal(entry->iface->tap) < 0) {
+                goto error_tap_signal;
+            }
+        }
+
+        item = item->next;
+    }
+
+    return 0;
+
+error_tap_signal:
+    return -1;
+}
+
 int patty_ax25_server_event_handle(patty_ax25_server *server) {
     int nready;
 
-    struct timeval timeout = { 1, 0 };
+    /*
+     * Do not sleep while interfaces have input carried over
+     */
+    struct timeval timeout = { server->backlog? 0: 1, 0 };
 
     struct timespec before,
                     after;
 
+    (void)patty_dict_each(server->held, sock_release, server);
+
     memcpy(&server->fds_r, &server->fds_watch, sizeof(server->fds_r));
 
+    watch_ifaces_output(server);
+    watch_socks_output(server);
+
     if (clock_gettime(CLOCK_MONOTONIC, &before) < 0) {
         goto error_clock_gettime;
     }
 
     if ((nready = select( server->fd_max,
                          &server->fds_r,
-                         NULL,
+                         &server->fds_w,
                          NULL,
                          &timeout)) < 0) {
         goto error_io;
@@ -2394,11 +5797,29 @@ int patty_ax25_server_event_handle(patty_ax25_server *server) {
 
     patty_timer_sub(&after, &before, &server->elapsed);
 
+    memcpy(&server->now, &after, sizeof(server->now));
+
+    tokens_tick(server);
+
+    if (server->dupes_digi) {
+        patty_ax25_dedup_tick(server->dupes_digi, &server->elapsed);
+    }
+
+    if (server->dupes_ui) {
+        patty_ax25_dedup_tick(server->dupes_ui, &server->elapsed);
+    }
+
+    patty_ax25_dedup_tick(server->dupes_bridge, &server->elapsed);
+
     if (handle_socks(server) < 0) {
         goto error_io;
     }
 
-    if (nready > 0) {
+    if (tick_ifaces(server) < 0) {
+        goto error_io;
+    }
+
+    if (nready > 0 || server->backlog) {
         if (handle_clients(server) < 0) {
             goto error_io;
         }
@@ -2412,6 +5833,10 @@ int patty_ax25_server_event_handle(patty_ax25_server *server) {
         }
     }
 
+    if (signal_taps(server) < 0) {
+        goto error_io;
+    }
+
     return 0;
 
 error_clock_gettime:
@@ -6,6 +6,7 @@
 #include <sys/stat.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/eventfd.h>
 #include <fcntl.h>
 #include <errno.h>
 
@@ -53,6 +54,36 @@ error_openpty:
     return -1;
 }
 
+static int bind_seqpacket(patty_ax25_sock *sock) {
+    int fds[2];
+
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds) < 0) {
+        goto error_socketpair;
+    }
+
+    sock->fd      = fds[0];
+    sock->peer_fd = fds[1];
+
+    return 0;
+
+error_socketpair:
+    return -1;
+}
+
+static int bind_chan(patty_ax25_sock *sock) {
+    switch (sock->chan) {
+        case PATTY_AX25_SOCK_CHAN_PTY:
+            return bind_pty(sock);
+
+        case PATTY_AX25_SOCK_CHAN_SEQPACKET:
+            return bind_seqpacket(sock);
+    }
+
+    errno = EINVAL;
+
+    return -1;
+}
+
 static inline size_t tx_bufsz(patty_ax25_sock *sock) {
     return PATTY_AX25_FRAME_OVERHEAD + sock->n_maxlen_tx;
 }
@@ -132,10 +163,30 @@ error_realloc_tx_buf:
 
 static patty_ax25_sock *init_dgram(patty_ax25_sock *sock,
                                    enum patty_ax25_proto proto) {
-    sock->proto = proto;
-    sock->type  = PATTY_AX25_SOCK_DGRAM;
+    sock->proto       = proto;
+    sock->type        = PATTY_AX25_SOCK_DGRAM;
+    sock->n_maxlen_tx = PATTY_AX25_SOCK_DEFAULT_I_LEN;
+    sock->n_maxlen_rx = PATTY_AX25_SOCK_DEFAULT_I_LEN;
+
+    /*
+     * Datagrams are built in and read into the same buffers as I frames
+     */
+    if (init_bufs(sock) < 0) {
+        goto error_init_bufs;
+    }
 
     return sock;
+
+error_init_bufs:
+    if (sock->peer_fd >= 0) {
+        (void)close(sock->peer_fd);
+    }
+
+    (void)close(sock->fd);
+
+    free(sock);
+
+    return NULL;
 }
 
 static patty_ax25_sock *init_raw(patty_ax25_sock *sock) {
@@ -144,8 +195,14 @@ static patty_ax25_sock *init_raw(patty_ax25_sock *sock) {
         .fd    = sock->fd
     };
 
-    if ((sock->raw = patty_kiss_tnc_new(&info)) == NULL) {
-        goto error_kiss_tnc_new;
+    /*
+     * Frames are delimited by the channel itself when using SOCK_SEQPACKET,
+     * so KISS framing is only needed for ptys
+     */
+    if (sock->chan == PATTY_AX25_SOCK_CHAN_PTY) {
+        if ((sock->raw = patty_kiss_tnc_new(&info)) == NULL) {
+            goto error_kiss_tnc_new;
+        }
     }
 
     sock->proto = PATTY_AX25_PROTO_NONE;
@@ -155,8 +212,14 @@ static patty_ax25_sock *init_raw(patty_ax25_sock *sock) {
     return sock;
 
 error_kiss_tnc_new:
+    if (sock->peer_fd >= 0) {
+        (void)close(sock->peer_fd);
+    }
+
     (void)close(sock->fd);
 
+    free(sock);
+
     return NULL;
 }
 
@@ -170,8 +233,16 @@ patty_ax25_sock *patty_ax25_sock_new(enum patty_ax25_proto proto,
 
     memset(sock, '\0', sizeof(*sock));
 
-    if (bind_pty(sock) < 0) {
-        goto error_bind_pty;
+    sock->chan    = (type & PATTY_AX25_SOCK_SEQPACKET)?
+                        PATTY_AX25_SOCK_CHAN_SEQPACKET:
+                        PATTY_AX25_SOCK_CHAN_PTY;
+    sock->peer_fd = -1;
+    sock->tap_fd  = -1;
+
+    type &= PATTY_AX25_SOCK_TYPE_MASK;
+
+    if (bind_chan(sock) < 0) {
+        goto error_bind_chan;
     }
 
     switch (type) {
@@ -202,7 +273,13 @@ error_init_bufs:
     if (sock->io_buf)   free(sock->io_buf);
     if (sock->tx_buf)   free(sock->tx_buf);
 
-error_bind_pty:
+    if (sock->peer_fd >= 0) {
+        (void)close(sock->peer_fd);
+    }
+
+    (void)close(sock->fd);
+
+error_bind_chan:
     free(sock);
 
 error_malloc_sock:
@@ -215,17 +292,36 @@ void patty_ax25_sock_destroy(patty_ax25_sock *sock) {
             (void)patty_ax25_if_promisc_delete(sock->iface, sock->fd);
         }
 
-        patty_kiss_tnc_destroy(sock->raw);
+        if (sock->raw) {
+            patty_kiss_tnc_destroy(sock->raw);
+        }
+
+        if (sock->tap_fd >= 0) {
+            (void)patty_ax25_tap_unwatch(sock->iface->tap, sock->tap_fd);
+            (void)close(sock->tap_fd);
+        }
+
+        if (sock->filter) {
+            patty_ax25_filter_destroy(sock->filter);
+        }
     }
 
     if (sock->fd > 0) {
         (void)close(sock->fd);
     }
 
+    if (sock->peer_fd >= 0) {
+        (void)close(sock->peer_fd);
+    }
+
     if (sock->assembler) {
         free(sock->assembler);
     }
 
+    if (sock->sub_buf) {
+        free(sock->sub_buf);
+    }
+
     if (sock->tx_slots) {
         free(sock->tx_slots);
     }
@@ -427,9 +523,20 @@ int patty_ax25_sock_bind_if(patty_ax25_sock *sock,
     sock->flags_classes |= iface->flags_classes;
 
     if (sock->state == PATTY_AX25_SOCK_PROMISC) {
-        if (patty_ax25_if_promisc_add(iface, sock->fd) < 0) {
+        enum patty_ax25_if_promisc_framing framing =
+            sock->chan == PATTY_AX25_SOCK_CHAN_SEQPACKET?
+                PATTY_AX25_IF_PROMISC_PACKET:
+                PATTY_AX25_IF_PROMISC_KISS;
+
+        if (patty_ax25_if_promisc_add(iface, sock->fd, framing) < 0) {
             goto error_if_promisc_add;
         }
+
+        if (sock->filter) {
+            (void)patty_ax25_if_promisc_filter(iface, sock->fd, sock->filter);
+        }
+
+        (void)patty_ax25_if_promisc_notices(iface, sock->fd, sock->notices);
     }
 
     return 0;
@@ -438,6 +545,66 @@ error_if_promisc_add:
     return -1;
 }
 
+void patty_ax25_sock_filter(patty_ax25_sock *sock,
+                            patty_ax25_filter *filter) {
+    if (sock->iface && sock->state == PATTY_AX25_SOCK_PROMISC) {
+        (void)patty_ax25_if_promisc_filter(sock->iface, sock->fd, filter);
+    }
+
+    if (sock->filter) {
+        patty_ax25_filter_destroy(sock->filter);
+    }
+
+    sock->filter = filter;
+}
+
+void patty_ax25_sock_notices(patty_ax25_sock *sock, int enable) {
+    if (sock->iface && sock->state == PATTY_AX25_SOCK_PROMISC) {
+        (void)patty_ax25_if_promisc_notices(sock->iface, sock->fd, enable);
+    }
+
+    sock->notices = enable;
+}
+
+/*
+ * Attach a raw socket to the shared memory tap of an interface, in place of
+ * having frames written to the socket itself
+ */
+int patty_ax25_sock_tap(patty_ax25_sock *sock,
+                        patty_ax25_if *iface) {
+    patty_ax25_tap *tap;
+
+    if (sock->tap_fd >= 0) {
+        errno = EEXIST;
+
+        goto error_exists;
+    }
+
+    if ((tap = patty_ax25_if_tap(iface)) == NULL) {
+        goto error_if_tap;
+    }
+
+    if ((sock->tap_fd = eventfd(0, EFD_CLOEXEC)) < 0) {
+        goto error_eventfd;
+    }
+
+    if (patty_ax25_tap_watch(tap, sock->tap_fd) < 0) {
+        goto error_tap_watch;
+    }
+
+    return patty_ax25_sock_bind_if(sock, iface);
+
+error_tap_watch:
+    (void)close(sock->tap_fd);
+
+    sock->tap_fd = -1;
+
+error_eventfd:
+error_if_tap:
+error_exists:
+    return -1;
+}
+
 void patty_ax25_sock_vs_incr(patty_ax25_sock *sock) {
     if (sock->mode == PATTY_AX25_SOCK_SABM) {
         sock->vs = (sock->vs + 1) & 0x07;
@@ -558,7 +725,7 @@ int patty_ax25_sock_flow_left(patty_ax25_sock *sock) {
         return 1;
     }
 
-    return sock->vs - tx_seq(sock, sock->va + sock->n_window_tx);
+    return tx_seq(sock, sock->va + sock->n_window_tx + tx_slots(sock) - sock->vs);
 }
 
 static inline int toobig(patty_ax25_sock *sock,
@@ -566,10 +733,13 @@ static inline int toobig(patty_ax25_sock *sock,
     return infolen > PATTY_AX25_FRAME_OVERHEAD + sock->n_maxlen_tx;
 }
 
-static ssize_t encode_address(patty_ax25_sock *sock,
-                              enum patty_ax25_frame_cr cr,
-                              void *dest,
-                              size_t len) {
+static ssize_t encode_path(enum patty_ax25_frame_cr cr,
+                           patty_ax25_addr *local,
+                           patty_ax25_addr *remote,
+                           patty_ax25_addr *repeaters,
+                           unsigned int hops,
+                           void *dest,
+                           size_t len) {
     uint8_t *buf = (uint8_t *)dest;
     size_t offset = 0;
 
@@ -578,7 +748,8 @@ static ssize_t encode_address(patty_ax25_sock *sock,
 
     unsigned int i;
 
-    if ((2 + sock->hops) * sizeof(patty_ax25_addr) > len) {
+    if (hops > PATTY_AX25_MAX_HOPS
+     || (2 + hops) * sizeof(patty_ax25_addr) > len) {
         errno = EOVERFLOW;
 
         goto error_toobig;
@@ -590,11 +761,11 @@ static ssize_t encode_address(patty_ax25_sock *sock,
         case PATTY_AX25_FRAME_OLD: break;
     }
 
-    offset += patty_ax25_addr_copy(buf + offset, &sock->remote, flags_remote);
-    offset += patty_ax25_addr_copy(buf + offset, &sock->local,  flags_local);
+    offset += patty_ax25_addr_copy(buf + offset, remote, flags_remote);
+    offset += patty_ax25_addr_copy(buf + offset, local,  flags_local);
 
-    for (i=0; i<sock->hops; i++) {
-        offset += patty_ax25_addr_copy(buf + offset, &sock->repeaters[i], 0);
+    for (i=0; i<hops; i++) {
+        offset += patty_ax25_addr_copy(buf + offset, &repeaters[i], 0);
     }
 
     ((uint8_t *)buf)[offset-1] |= 1;
@@ -605,6 +776,19 @@ error_toobig:
     return -1;
 }
 
+static inline ssize_t encode_address(patty_ax25_sock *sock,
+                                     enum patty_ax25_frame_cr cr,
+                                     void *dest,
+                                     size_t len) {
+    return encode_path(cr,
+                       &sock->local,
+                       &sock->remote,
+                       sock->repeaters,
+                       sock->hops,
+                       dest,
+                       len);
+}
+
 ssize_t patty_ax25_sock_send(patty_ax25_sock *sock,
                              void *buf,
                              size_t len) {
@@ -636,6 +820,10 @@ ssize_t patty_ax25_sock_recv(patty_ax25_sock *sock,
         goto error_invalid_type;
     }
 
+    if (sock->raw == NULL) {
+        return read(sock->fd, buf, len);
+    }
+
     return patty_kiss_tnc_recv(sock->raw, buf, len);
 
 error_invalid_type:
@@ -730,7 +918,8 @@ static ssize_t frame_send(patty_ax25_sock *sock,
     }
 
     if (info && infolen) {
-        if (PATTY_AX25_FRAME_CONTROL_I(control)) {
+        if (PATTY_AX25_FRAME_CONTROL_I(control)
+         || PATTY_AX25_FRAME_CONTROL_UI(control)) {
             buf[offset++] = proto;
         }
 
@@ -1001,7 +1190,7 @@ static ssize_t write_segmented(patty_ax25_sock *sock,
             first = 0;
         }
 
-        tx_slot_save(sock, buf + i, copylen);
+        tx_slot_save(sock, (uint8_t *)buf + i, copylen);
 
         memcpy(dest + o, (uint8_t *)buf + i, copylen);
 
@@ -1029,10 +1218,67 @@ error_toobig:
     return -1;
 }
 
+/*
+ * Send a single UI frame to an arbitrary peer, by way of the given path,
+ * without regard to any peer the socket may be connected to
+ */
+ssize_t patty_ax25_sock_sendto(patty_ax25_sock *sock,
+                               patty_ax25_if *iface,
+                               patty_ax25_addr *remote,
+                               patty_ax25_addr *repeaters,
+                               unsigned int hops,
+                               void *buf,
+                               size_t len) {
+    uint8_t *frame = sock->tx_buf;
+
+    patty_ax25_addr *local = sock->local.callsign[0]?
+                             &sock->local: &iface->addr;
+
+    size_t offset = 0;
+    ssize_t encoded;
+
+    if (sock->type != PATTY_AX25_SOCK_DGRAM) {
+        errno = EINVAL;
+
+        goto error_invalid_type;
+    }
+
+    if (len > sock->n_maxlen_tx) {
+        errno = EMSGSIZE;
+
+        goto error_toobig;
+    }
+
+    if ((encoded = encode_path(PATTY_AX25_FRAME_COMMAND,
+                               local,
+                               remote,
+                               repeaters,
+                               hops,
+                               frame,
+                               tx_bufsz(sock))) < 0) {
+        goto error_encode_path;
+    } else {
+        offset += encoded;
+    }
+
+    frame[offset++] = control_ui(0);
+    frame[offset++] = sock->proto;
+
+    memcpy(frame + offset, buf, len);
+
+    return patty_ax25_if_send(iface, frame, offset + len);
+
+error_encode_path:
+error_toobig:
+error_invalid_type:
+    return -1;
+}
+
 ssize_t patty_ax25_sock_write(patty_ax25_sock *sock,
                               void *buf,
                               size_t len) {
-    if (sock->mode == PATTY_AX25_SOCK_DM) {
+    if (sock->type == PATTY_AX25_SOCK_STREAM
+     && sock->mode == PATTY_AX25_SOCK_DM) {
         errno = EBADF;
 
         goto error_invalid_mode;
@@ -1086,3 +1332,165 @@ error_frame_send:
 error_invalid_mode:
     return -1;
 }
+
+/*
+ * Determine whether a UI frame received matches the socket's subscription
+ */
+int patty_ax25_sock_sub_match(patty_ax25_sock *sock,
+                              patty_ax25_frame *frame) {
+    patty_ax25_sock_sub *sub = &sock->sub;
+
+    if (sub->match == 0) {
+        return 0;
+    }
+
+    if (sub->match & PATTY_AX25_SOCK_MATCH_DEST) {
+        if (memcmp(sub->dest.callsign,
+                   frame->dest.callsign,
+                   sizeof(sub->dest.callsign)) != 0
+         || (sub->dest.ssid & 0x1e) != (frame->dest.ssid & 0x1e)) {
+            return 0;
+        }
+    }
+
+    if (sub->match & PATTY_AX25_SOCK_MATCH_PROTO) {
+        if (sub->proto != frame->proto) {
+            return 0;
+        }
+    }
+
+    if (sub->match & PATTY_AX25_SOCK_MATCH_SRC) {
+        size_t i;
+
+        /*
+         * Callsigns are padded with spaces, shifted as on the wire
+         */
+        for (i=0; i<sizeof(sub->src.callsign); i++) {
+            if (sub->src.callsign[i] == (' ' << 1)) {
+                break;
+            }
+
+            if (sub->src.callsign[i] != frame->src.callsign[i]) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+/*
+ * Once subscribed, every datagram for the socket passes through the queue,
+ * so the pty is made non-blocking for good rather than for each flush
+ */
+int patty_ax25_sock_sub_init(patty_ax25_sock *sock) {
+    int flags;
+
+    if (sock->chan != PATTY_AX25_SOCK_CHAN_PTY || sock->sub_buf) {
+        return 0;
+    }
+
+    if ((flags = fcntl(sock->fd, F_GETFL)) < 0) {
+        goto error_fcntl;
+    }
+
+    if (fcntl(sock->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        goto error_fcntl;
+    }
+
+    if ((sock->sub_buf = malloc(PATTY_AX25_SOCK_SUB_BUFSZ)) == NULL) {
+        goto error_malloc;
+    }
+
+    sock->sub_head = 0;
+    sock->sub_len  = 0;
+
+    return 0;
+
+error_malloc:
+    (void)fcntl(sock->fd, F_SETFL, flags);
+
+error_fcntl:
+    return -1;
+}
+
+ssize_t patty_ax25_sock_sub_send(patty_ax25_sock *sock,
+                                 const void *buf,
+                                 size_t len) {
+    size_t i;
+
+    if (PATTY_AX25_SOCK_SUB_BUFSZ - sock->sub_len < len) {
+        if (patty_ax25_sock_sub_flush(sock) < 0) {
+            goto error_flush;
+        }
+
+        if (PATTY_AX25_SOCK_SUB_BUFSZ - sock->sub_len < len) {
+            sock->sub_dropped++;
+
+            return 0;
+        }
+    }
+
+    for (i=0; i<len; i++) {
+        size_t slot = (sock->sub_head + sock->sub_len++)
+                    % PATTY_AX25_SOCK_SUB_BUFSZ;
+
+        sock->sub_buf[slot] = ((uint8_t *)buf)[i];
+    }
+
+    if (patty_ax25_sock_sub_flush(sock) < 0) {
+        goto error_flush;
+    }
+
+    return len;
+
+error_flush:
+    return -1;
+}
+
+ssize_t patty_ax25_sock_sub_queued(patty_ax25_sock *sock) {
+    return sock->sub_buf? sock->sub_len: 0;
+}
+
+ssize_t patty_ax25_sock_sub_flush(patty_ax25_sock *sock) {
+    size_t total = 0;
+
+    if (sock->sub_len == 0) {
+        return 0;
+    }
+
+    while (sock->sub_len) {
+        size_t len = PATTY_AX25_SOCK_SUB_BUFSZ - sock->sub_head;
+        ssize_t wrlen;
+
+        if (len > sock->sub_len) {
+            len = sock->sub_len;
+        }
+
+        if ((wrlen = write(sock->fd, sock->sub_buf + sock->sub_head, len)) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            goto error_write;
+        }
+
+        sock->sub_head  = (sock->sub_head + wrlen) % PATTY_AX25_SOCK_SUB_BUFSZ;
+        sock->sub_len  -= wrlen;
+
+        total += wrlen;
+
+        if (wrlen < len) {
+            break;
+        }
+    }
+
+    if (sock->sub_len == 0) {
+        sock->sub_head = 0;
+    }
+
+    return total;
+
+error_write:
+    return -1;
+}
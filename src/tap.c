@@ -0,0 +1,401 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <errno.h>
+
+#include <patty/ax25.h>
+
+/*
+ * Shared memory layout; a header, followed by a fixed number of slots each
+ * large enough to hold one frame of the interface MTU
+ */
+struct header {
+    uint32_t magic,
+             version,
+             slots,
+             slot_size;
+
+    /*
+     * Sequence number of the next frame to be written; only ever written by
+     * the producer
+     */
+    _Atomic uint64_t head;
+};
+
+struct slot {
+    /*
+     * Sequence number of the frame held in this slot plus one, or zero while
+     * the slot is being rewritten
+     */
+    _Atomic uint64_t seq;
+
+    int64_t sec;
+    uint32_t nsec;
+    uint16_t dir,
+             len;
+
+    uint8_t data[];
+};
+
+struct _patty_ax25_tap {
+    struct header *header;
+    size_t size;
+
+    /*
+     * Geometry of the mapping as created or validated on open; the copy in
+     * the shared header is not consulted again
+     */
+    size_t slots,
+           slot_size;
+
+    int fd,
+        eventfd,
+        pending;
+
+    patty_dict *watchers;
+
+    uint64_t cursor;
+    size_t dropped;
+};
+
+static inline size_t header_size() {
+    return (sizeof(struct header) + 63) & ~63;
+}
+
+static inline struct slot *slot_at(patty_ax25_tap *tap, uint64_t seq) {
+    return (struct slot *)((uint8_t *)tap->header
+        + header_size()
+        + (seq % tap->slots) * tap->slot_size);
+}
+
+patty_ax25_tap *patty_ax25_tap_new(size_t slots, size_t mtu) {
+    patty_ax25_tap *tap;
+
+    size_t slot_size = (sizeof(struct slot) + mtu + 63) & ~63;
+
+    if (mtu > UINT16_MAX || slots == 0) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    if ((tap = malloc(sizeof(*tap))) == NULL) {
+        goto error_malloc_tap;
+    }
+
+    memset(tap, '\0', sizeof(*tap));
+
+    tap->size      = header_size() + slots * slot_size;
+    tap->slots     = slots;
+    tap->slot_size = slot_size;
+    tap->eventfd   = -1;
+
+    if ((tap->watchers = patty_dict_new()) == NULL) {
+        goto error_dict_new;
+    }
+
+    if ((tap->fd = memfd_create("patty-tap", MFD_CLOEXEC)) < 0) {
+        goto error_memfd_create;
+    }
+
+    if (ftruncate(tap->fd, tap->size) < 0) {
+        goto error_ftruncate;
+    }
+
+    if ((tap->header = mmap(NULL,
+                            tap->size,
+                            PROT_READ | PROT_WRITE,
+                            MAP_SHARED,
+                            tap->fd,
+                            0)) == MAP_FAILED) {
+        goto error_mmap;
+    }
+
+    tap->header->magic     = PATTY_AX25_TAP_MAGIC;
+    tap->header->version   = PATTY_AX25_TAP_VERSION;
+    tap->header->slots     = slots;
+    tap->header->slot_size = slot_size;
+
+    atomic_init(&tap->header->head, 0);
+
+    return tap;
+
+error_mmap:
+error_ftruncate:
+    (void)close(tap->fd);
+
+error_memfd_create:
+    patty_dict_destroy(tap->watchers);
+
+error_dict_new:
+    free(tap);
+
+error_malloc_tap:
+error_invalid:
+    return NULL;
+}
+
+patty_ax25_tap *patty_ax25_tap_open(int fd, size_t size, int eventfd) {
+    patty_ax25_tap *tap;
+    struct header *header;
+    size_t slots,
+           slot_size;
+
+    if (size < header_size()) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    if ((tap = malloc(sizeof(*tap))) == NULL) {
+        goto error_malloc_tap;
+    }
+
+    memset(tap, '\0', sizeof(*tap));
+
+    if ((header = mmap(NULL,
+                       size,
+                       PROT_READ,
+                       MAP_SHARED,
+                       fd,
+                       0)) == MAP_FAILED) {
+        goto error_mmap;
+    }
+
+    slots     = header->slots;
+    slot_size = header->slot_size;
+
+    if (header->magic != PATTY_AX25_TAP_MAGIC
+     || header->version != PATTY_AX25_TAP_VERSION
+     || slots == 0
+     || slot_size < sizeof(struct slot)
+     || header_size() + slots * slot_size > size) {
+        errno = EINVAL;
+
+        goto error_invalid_header;
+    }
+
+    tap->header    = header;
+    tap->size      = size;
+    tap->slots     = slots;
+    tap->slot_size = slot_size;
+    tap->fd        = fd;
+    tap->eventfd   = eventfd;
+
+    /*
+     * Consumers only see frames written after they attach
+     */
+    tap->cursor = atomic_load_explicit(&header->head, memory_order_acquire);
+
+    return tap;
+
+error_invalid_header:
+    (void)munmap(header, size);
+
+error_mmap:
+    free(tap);
+
+error_malloc_tap:
+error_invalid:
+    return NULL;
+}
+
+void patty_ax25_tap_destroy(patty_ax25_tap *tap) {
+    (void)munmap(tap->header, tap->size);
+
+    /*
+     * Watcher event descriptors belong to the sockets which registered them
+     */
+    if (tap->watchers) {
+        patty_dict_destroy(tap->watchers);
+    }
+
+    if (tap->eventfd >= 0) {
+        (void)close(tap->eventfd);
+    }
+
+    (void)close(tap->fd);
+
+    free(tap);
+}
+
+int patty_ax25_tap_fd(patty_ax25_tap *tap) {
+    return tap->fd;
+}
+
+size_t patty_ax25_tap_size(patty_ax25_tap *tap) {
+    return tap->size;
+}
+
+void patty_ax25_tap_push(patty_ax25_tap *tap,
+                         enum patty_ax25_tap_dir dir,
+                         const void *buf,
+                         size_t len) {
+    struct header *header = tap->header;
+    struct slot *slot;
+    struct timespec ts;
+
+    uint64_t seq = atomic_load_explicit(&header->head, memory_order_relaxed);
+
+    size_t max = tap->slot_size - sizeof(struct slot);
+
+    if (len > max) {
+        len = max;
+    }
+
+    (void)clock_gettime(CLOCK_REALTIME, &ts);
+
+    slot = slot_at(tap, seq);
+
+    /*
+     * Invalidate the slot before rewriting it, so that any consumer reading
+     * it concurrently will notice and discard what it read
+     */
+    atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    slot->sec  = ts.tv_sec;
+    slot->nsec = ts.tv_nsec;
+    slot->dir  = dir;
+    slot->len  = len;
+
+    memcpy(slot->data, buf, len);
+
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_release);
+    atomic_store_explicit(&header->head, seq + 1, memory_order_release);
+
+    tap->pending = 1;
+}
+
+int patty_ax25_tap_watch(patty_ax25_tap *tap, int eventfd) {
+    if (patty_dict_set(tap->watchers, (uint32_t)eventfd, tap) == NULL) {
+        return -1;
+    }
+
+    return 0;
+}
+
+int patty_ax25_tap_unwatch(patty_ax25_tap *tap, int eventfd) {
+    return patty_dict_delete(tap->watchers, (uint32_t)eventfd);
+}
+
+static int signal_watcher(uint32_t key, void *value, void *ctx) {
+    uint64_t one = 1;
+
+    if (write((int)key, &one, sizeof(one)) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*
+ * Wake every consumer, at most once per batch of frames pushed
+ */
+int patty_ax25_tap_signal(patty_ax25_tap *tap) {
+    if (!tap->pending) {
+        return 0;
+    }
+
+    tap->pending = 0;
+
+    return patty_dict_each(tap->watchers, signal_watcher, NULL);
+}
+
+int patty_ax25_tap_event_fd(patty_ax25_tap *tap) {
+    return tap->eventfd;
+}
+
+ssize_t patty_ax25_tap_read(patty_ax25_tap *tap,
+                            void *buf,
+                            size_t len,
+                            patty_ax25_tap_info *info) {
+    struct header *header = tap->header;
+
+    while (1) {
+        uint64_t head = atomic_load_explicit(&header->head,
+                                             memory_order_acquire);
+
+        struct slot *slot;
+        uint64_t seq;
+        size_t size,
+               copy;
+
+        if (tap->cursor == head) {
+            return 0;
+        }
+
+        /*
+         * Skip past any frames the producer has already lapped
+         */
+        if (head - tap->cursor > tap->slots) {
+            tap->dropped += head - tap->cursor - tap->slots;
+            tap->cursor   = head - tap->slots;
+        }
+
+        slot = slot_at(tap, tap->cursor);
+        seq  = atomic_load_explicit(&slot->seq, memory_order_acquire);
+
+        if (seq != tap->cursor + 1) {
+            goto overwritten;
+        }
+
+        /*
+         * The producer never writes more than a slot holds, so a greater
+         * length can only be a slot mangled by another writer to the
+         * mapping; read it once, and never trust it beyond the slot
+         */
+        size = slot->len;
+
+        if (size > tap->slot_size - sizeof(struct slot)) {
+            goto overwritten;
+        }
+
+        copy = size < len? size: len;
+
+        if (info) {
+            info->ts.tv_sec  = slot->sec;
+            info->ts.tv_nsec = slot->nsec;
+            info->dir        = slot->dir;
+        }
+
+        memcpy(buf, slot->data, copy);
+
+        atomic_thread_fence(memory_order_acquire);
+
+        if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != seq) {
+            goto overwritten;
+        }
+
+        tap->cursor++;
+
+        if (info) {
+            info->dropped = tap->dropped;
+        }
+
+        tap->dropped = 0;
+
+        return copy;
+
+overwritten:
+        tap->dropped++;
+        tap->cursor++;
+    }
+}
+
+/*
+ * Block until the producer signals that new frames may be available
+ */
+int patty_ax25_tap_wait(patty_ax25_tap *tap) {
+    uint64_t count;
+
+    if (read(tap->eventfd, &count, sizeof(count)) < 0) {
+        return -1;
+    }
+
+    return 0;
+}
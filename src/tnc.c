@@ -5,10 +5,15 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <termios.h>
+#include <netdb.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <errno.h>
 
 #include <patty/ax25.h>
@@ -20,7 +25,19 @@
 
 enum tnc_opts {
     TNC_NONE             = 0,
-    TNC_CLOSE_ON_DESTROY = 1 << 0
+    TNC_CLOSE_ON_DESTROY = 1 << 0,
+    TNC_TCP              = 1 << 1
+};
+
+/*
+ * State of the connection to a TNC reached over TCP; while waiting to
+ * reconnect, the file descriptor of the TNC is a timer which becomes readable
+ * once the next attempt is due
+ */
+enum tcp_state {
+    TCP_CONNECTING,
+    TCP_CONNECTED,
+    TCP_WAITING
 };
 
 enum state {
@@ -49,6 +66,40 @@ struct _patty_kiss_tnc {
            readlen,
            offset_i,
            offset_o;
+
+    /*
+     * Body of a dropped frame report currently being received
+     */
+    uint8_t notice[4];
+    size_t notice_len;
+
+    /*
+     * Output ring of encoded KISS frames awaiting transmission, used only
+     * when the TNC is opened non-blocking
+     */
+    uint8_t *txbuf;
+
+    size_t txbufsz,
+           txhead,
+           txlen;
+
+    /*
+     * Settings kept to reconnect to a TNC reached over TCP, and to push
+     * channel access parameters to it anew once reconnected
+     */
+    patty_kiss_tnc_info info;
+
+    char *tcp_host,
+         *tcp_port;
+
+    /*
+     * Addresses the host resolved to when the TNC was set up, so that
+     * reconnecting never blocks the caller on name resolution
+     */
+    struct addrinfo *tcp_ai;
+
+    enum tcp_state tcp_state;
+    int backoff;
 };
 
 static int init_sock(patty_kiss_tnc *tnc, patty_kiss_tnc_info *info) {
@@ -128,6 +179,250 @@ error_tcgetattr:
     return -1;
 }
 
+static int init_params(patty_kiss_tnc *tnc, patty_kiss_tnc_info *info) {
+    struct {
+        int flag;
+        enum patty_ax25_if_param param;
+        uint8_t value;
+    } params[] = {
+        { PATTY_KISS_TNC_TXDELAY,     PATTY_AX25_IF_PARAM_TXDELAY,     info->txdelay     },
+        { PATTY_KISS_TNC_PERSIST,     PATTY_AX25_IF_PARAM_PERSIST,     info->persist     },
+        { PATTY_KISS_TNC_SLOT_TIME,   PATTY_AX25_IF_PARAM_SLOT_TIME,   info->slot_time   },
+        { PATTY_KISS_TNC_TX_TAIL,     PATTY_AX25_IF_PARAM_TX_TAIL,     info->tx_tail     },
+        { PATTY_KISS_TNC_FULL_DUPLEX, PATTY_AX25_IF_PARAM_FULL_DUPLEX, info->full_duplex },
+        { 0, 0, 0 }
+    };
+
+    int i;
+
+    for (i=0; params[i].flag; i++) {
+        if (!(info->flags & params[i].flag)) {
+            continue;
+        }
+
+        if (patty_kiss_tnc_param_set(tnc,
+                                     params[i].param,
+                                     params[i].value) < 0) {
+            goto error_param_set;
+        }
+    }
+
+    return 0;
+
+error_param_set:
+    return -1;
+}
+
+static int init_nonblock(patty_kiss_tnc *tnc) {
+    int flags;
+
+    if ((flags = fcntl(tnc->fd, F_GETFL)) < 0) {
+        goto error_fcntl;
+    }
+
+    if (fcntl(tnc->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        goto error_fcntl;
+    }
+
+    if ((tnc->txbuf = malloc(PATTY_KISS_TNC_TXBUFSZ)) == NULL) {
+        goto error_malloc_txbuf;
+    }
+
+    tnc->txbufsz = PATTY_KISS_TNC_TXBUFSZ;
+
+    return 0;
+
+error_malloc_txbuf:
+error_fcntl:
+    return -1;
+}
+
+static int tcp_resolve(patty_kiss_tnc *tnc) {
+    struct addrinfo hints;
+
+    memset(&hints, '\0', sizeof(hints));
+
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    if (getaddrinfo(tnc->tcp_host, tnc->tcp_port, &hints, &tnc->tcp_ai) != 0) {
+        errno = EADDRNOTAVAIL;
+
+        goto error_getaddrinfo;
+    }
+
+    return 0;
+
+error_getaddrinfo:
+    return -1;
+}
+
+/*
+ * Take the connection to the TNC to be established, and start over with the
+ * shortest delay before reconnecting should it be lost
+ */
+static inline void tcp_established(patty_kiss_tnc *tnc) {
+    tnc->tcp_state = TCP_CONNECTED;
+    tnc->backoff   = PATTY_KISS_TNC_BACKOFF_MIN;
+}
+
+/*
+ * Determine whether a connection in progress has completed, which is once
+ * the socket becomes writable without error.  Should the connection have
+ * failed, that is left to be noticed upon the next read.
+ */
+static int tcp_complete(patty_kiss_tnc *tnc) {
+    struct pollfd pfd = {
+        .fd     = tnc->fd,
+        .events = POLLOUT
+    };
+
+    int error = 0;
+    socklen_t len = sizeof(error);
+
+    if (poll(&pfd, 1, 0) <= 0 || !(pfd.revents & POLLOUT)) {
+        return 0;
+    }
+
+    if (getsockopt(tnc->fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0
+     || error != 0) {
+        return 0;
+    }
+
+    tcp_established(tnc);
+
+    return 1;
+}
+
+static int tcp_connect(patty_kiss_tnc *tnc) {
+    struct addrinfo *ai;
+
+    int nodelay = 1;
+
+    for (ai=tnc->tcp_ai; ai; ai=ai->ai_next) {
+        int fd;
+
+        if ((fd = socket(ai->ai_family,
+                         ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                         ai->ai_protocol)) < 0) {
+            continue;
+        }
+
+        /*
+         * Frames are written whole, so there is nothing to be gained from
+         * delaying them to coalesce with others
+         */
+        if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+                       &nodelay, sizeof(nodelay)) < 0) {
+            close(fd);
+
+            continue;
+        }
+
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+            if (errno != EINPROGRESS) {
+                close(fd);
+
+                continue;
+            }
+
+            tnc->tcp_state = TCP_CONNECTING;
+        } else {
+            tcp_established(tnc);
+        }
+
+        return tnc->fd = fd;
+    }
+
+    return -1;
+}
+
+static int tcp_wait(patty_kiss_tnc *tnc) {
+    struct itimerspec its;
+    int fd;
+
+    memset(&its, '\0', sizeof(its));
+
+    its.it_value.tv_sec  =  tnc->backoff / 1000;
+    its.it_value.tv_nsec = (tnc->backoff % 1000) * 1000000;
+
+    if ((fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) < 0) {
+        goto error_timerfd_create;
+    }
+
+    if (timerfd_settime(fd, 0, &its, NULL) < 0) {
+        goto error_timerfd_settime;
+    }
+
+    tnc->tcp_state = TCP_WAITING;
+
+    if ((tnc->backoff *= 2) > PATTY_KISS_TNC_BACKOFF_MAX) {
+        tnc->backoff = PATTY_KISS_TNC_BACKOFF_MAX;
+    }
+
+    return tnc->fd = fd;
+
+error_timerfd_settime:
+    close(fd);
+
+error_timerfd_create:
+    return -1;
+}
+
+static int init_tcp(patty_kiss_tnc *tnc, patty_kiss_tnc_info *info) {
+    if (info->host == NULL || info->port == NULL) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    memcpy(&tnc->info, info, sizeof(tnc->info));
+
+    if ((tnc->tcp_host = strdup(info->host)) == NULL) {
+        goto error_strdup_host;
+    }
+
+    if ((tnc->tcp_port = strdup(info->port)) == NULL) {
+        goto error_strdup_port;
+    }
+
+    tnc->info.host = tnc->tcp_host;
+    tnc->info.port = tnc->tcp_port;
+
+    tnc->opts   |= TNC_TCP | TNC_CLOSE_ON_DESTROY;
+    tnc->backoff = PATTY_KISS_TNC_BACKOFF_MIN;
+
+    /*
+     * Only an address which cannot be resolved is taken to be an error;
+     * should the TNC not be reachable at first, try again later, as with any
+     * connection lost thereafter
+     */
+    if (tcp_resolve(tnc) < 0) {
+        goto error_tcp_resolve;
+    }
+
+    if (tcp_connect(tnc) < 0) {
+        if (tcp_wait(tnc) < 0) {
+            goto error_tcp_wait;
+        }
+    }
+
+    return 0;
+
+error_tcp_wait:
+    freeaddrinfo(tnc->tcp_ai);
+
+error_tcp_resolve:
+    free(tnc->tcp_port);
+
+error_strdup_port:
+    free(tnc->tcp_host);
+
+error_strdup_host:
+error_invalid:
+    return -1;
+}
+
 static int init_device(patty_kiss_tnc *tnc, patty_kiss_tnc_info *info) {
     struct stat st;
 
@@ -168,7 +463,13 @@ patty_kiss_tnc *patty_kiss_tnc_new(patty_kiss_tnc_info *info) {
         goto error_malloc_buf;
     }
 
-    if (info->flags & PATTY_KISS_TNC_DEVICE) {
+    tnc->opts = TNC_NONE;
+
+    if (info->flags & PATTY_KISS_TNC_TCP) {
+        if (init_tcp(tnc, info) < 0) {
+            goto error_init_device;
+        }
+    } else if (info->flags & PATTY_KISS_TNC_DEVICE) {
         if (init_device(tnc, info) < 0) {
             goto error_init_device;
         }
@@ -188,7 +489,6 @@ patty_kiss_tnc *patty_kiss_tnc_new(patty_kiss_tnc_info *info) {
 
     memset(&tnc->stats, '\0', sizeof(tnc->stats));
 
-    tnc->opts     = TNC_NONE;
     tnc->state    = KISS_NONE;
     tnc->command  = PATTY_KISS_RETURN;
     tnc->port     = 0;
@@ -196,14 +496,39 @@ patty_kiss_tnc *patty_kiss_tnc_new(patty_kiss_tnc_info *info) {
     tnc->offset_i = 0;
     tnc->offset_o = 0;
     tnc->readlen  = 0;
+    tnc->notice_len = 0;
+    tnc->txbuf    = NULL;
+    tnc->txbufsz  = 0;
+    tnc->txhead   = 0;
+    tnc->txlen    = 0;
+
+    if (info->flags & (PATTY_KISS_TNC_NONBLOCK | PATTY_KISS_TNC_TCP)) {
+        if (init_nonblock(tnc) < 0) {
+            goto error_init_nonblock;
+        }
+    }
+
+    if (init_params(tnc, info) < 0) {
+        goto error_init_params;
+    }
 
     return tnc;
 
+error_init_params:
+    free(tnc->txbuf);
+
+error_init_nonblock:
 error_init_termios:
-    if (info->flags & PATTY_KISS_TNC_DEVICE) {
+    if (tnc->opts & TNC_CLOSE_ON_DESTROY) {
         (void)close(tnc->fd);
     }
 
+    if (tnc->opts & TNC_TCP) {
+        freeaddrinfo(tnc->tcp_ai);
+        free(tnc->tcp_port);
+        free(tnc->tcp_host);
+    }
+
 error_init_device:
 error_invalid:
     free(tnc->buf);
@@ -224,6 +549,13 @@ void patty_kiss_tnc_destroy(patty_kiss_tnc *tnc) {
         (void)close(tnc->fd);
     }
 
+    if (tnc->opts & TNC_TCP) {
+        freeaddrinfo(tnc->tcp_ai);
+        free(tnc->tcp_port);
+        free(tnc->tcp_host);
+    }
+
+    free(tnc->txbuf);
     free(tnc->buf);
     free(tnc);
 }
@@ -240,9 +572,47 @@ int patty_kiss_tnc_ready(patty_kiss_tnc *tnc, fd_set *fds) {
     return FD_ISSET(tnc->fd, fds);
 }
 
+/*
+ * Reconnect to a TNC reached over TCP: at once if the connection was lost
+ * after having been established, or once the delay following a failed
+ * attempt has passed.  Either way, output not yet written to the previous
+ * connection is discarded, and the channel access parameters given upon
+ * creation are pushed to the TNC again.
+ */
 int patty_kiss_tnc_reset(patty_kiss_tnc *tnc) {
-    errno = ENOSYS;
+    if (!(tnc->opts & TNC_TCP)) {
+        errno = ENOSYS;
+
+        goto error_nosys;
+    }
+
+    (void)close(tnc->fd);
+
+    tnc->state    = KISS_NONE;
+    tnc->command  = PATTY_KISS_RETURN;
+    tnc->offset_i = 0;
+    tnc->offset_o = 0;
+    tnc->readlen  = 0;
+    tnc->txhead   = 0;
+    tnc->txlen    = 0;
 
+    if (tnc->tcp_state == TCP_CONNECTING || tcp_connect(tnc) < 0) {
+        if (tcp_wait(tnc) < 0) {
+            goto error_tcp_wait;
+        }
+
+        return tnc->fd;
+    }
+
+    if (init_params(tnc, &tnc->info) < 0) {
+        goto error_init_params;
+    }
+
+    return tnc->fd;
+
+error_init_params:
+error_tcp_wait:
+error_nosys:
     return -1;
 }
 
@@ -254,14 +624,95 @@ static void tnc_drop(patty_kiss_tnc *tnc) {
     tnc->offset_o = 0;
     tnc->readlen  = 0;
 
+    tnc->notice_len = 0;
+
     tnc->stats.dropped++;
 }
 
+static inline void body_put(patty_kiss_tnc *tnc, void *buf, uint8_t c) {
+    switch (tnc->command) {
+        case PATTY_KISS_DATA:
+            ((uint8_t *)buf)[tnc->offset_o++] = c;
+
+            break;
+
+        case PATTY_KISS_HW_SET:
+            if (tnc->port == PATTY_KISS_TNC_PORT_DROPPED
+             && tnc->notice_len < sizeof(tnc->notice)) {
+                tnc->notice[tnc->notice_len++] = c;
+            }
+
+            break;
+
+        default:
+            break;
+    }
+}
+
+/*
+ * Account for frames the sender reports having dropped
+ */
+static void body_end(patty_kiss_tnc *tnc) {
+    if (tnc->command == PATTY_KISS_HW_SET
+     && tnc->port == PATTY_KISS_TNC_PORT_DROPPED
+     && tnc->notice_len == sizeof(tnc->notice)) {
+        tnc->stats.dropped += ((uint32_t)tnc->notice[0] << 24)
+                            | ((uint32_t)tnc->notice[1] << 16)
+                            | ((uint32_t)tnc->notice[2] <<  8)
+                            |  (uint32_t)tnc->notice[3];
+    }
+
+    tnc->notice_len = 0;
+}
+
 ssize_t patty_kiss_tnc_fill(patty_kiss_tnc *tnc) {
-    if ((tnc->readlen = read(tnc->fd, tnc->buf, tnc->bufsz)) < 0) {
+    ssize_t readlen;
+
+    if ((tnc->opts & TNC_TCP) && tnc->tcp_state == TCP_WAITING) {
+        uint64_t expirations;
+
+        tnc->readlen = 0;
+
+        if (read(tnc->fd, &expirations, sizeof(expirations)) < 0) {
+            goto error_read;
+        }
+
+        /*
+         * The next attempt to reconnect is due; have the caller reset the
+         * TNC to make it
+         */
+        errno = ENOTCONN;
+
+        goto error_read;
+    }
+
+    if ((readlen = read(tnc->fd, tnc->buf, tnc->bufsz)) < 0) {
+        tnc->readlen = 0;
+
         goto error_read;
     }
 
+    if (tnc->opts & TNC_TCP) {
+        if (readlen == 0) {
+            /*
+             * Report the connection being closed by the TNC as an error
+             * rather than end of file, so that the caller resets the TNC
+             * to reconnect
+             */
+            tnc->readlen = 0;
+
+            errno = ECONNRESET;
+
+            goto error_read;
+        }
+
+        if (tnc->tcp_state == TCP_CONNECTING) {
+            tcp_established(tnc);
+        }
+    }
+
+    tnc->readlen = readlen;
+
     tnc->offset_i = 0;
 
     return tnc->readlen;
@@ -294,7 +745,7 @@ ssize_t patty_kiss_tnc_drain(patty_kiss_tnc *tnc, void *buf, size_t len) {
                 uint8_t command = PATTY_KISS_COMMAND(c),
                         port    = PATTY_KISS_COMMAND_PORT(c);
 
-                if (command == PATTY_KISS_FEND) {
+                if (c == PATTY_KISS_FEND) {
                     break;
                 }
 
@@ -319,6 +770,8 @@ ssize_t patty_kiss_tnc_drain(patty_kiss_tnc *tnc, void *buf, size_t len) {
                 tnc->command = command;
                 tnc->port    = port;
 
+                tnc->notice_len = 0;
+
                 break;
             }
 
@@ -328,24 +781,20 @@ ssize_t patty_kiss_tnc_drain(patty_kiss_tnc *tnc, void *buf, size_t len) {
                 } else if (c == PATTY_KISS_FEND) {
                     tnc->state = KISS_FRAME_COMMAND;
 
+                    body_end(tnc);
+
                     goto done;
                 } else {
-                    switch (tnc->command) {
-                        case PATTY_KISS_DATA:
-                            ((uint8_t *)buf)[tnc->offset_o++] = c;
-
-                        default:
-                            break;
-                    }
+                    body_put(tnc, buf, c);
                 }
 
                 break;
 
             case KISS_FRAME_ESCAPE:
                 if (c == PATTY_KISS_TFEND) {
-                    ((uint8_t *)buf)[tnc->offset_o++] = PATTY_KISS_FEND;
+                    body_put(tnc, buf, PATTY_KISS_FEND);
                 } else if (c == PATTY_KISS_TFESC) {
-                    ((uint8_t *)buf)[tnc->offset_o++] = PATTY_KISS_FESC;
+                    body_put(tnc, buf, PATTY_KISS_FESC);
                 } else {
                     errno = EIO;
 
@@ -404,12 +853,228 @@ error_fill:
     return -1;
 }
 
+static inline void tx_put(patty_kiss_tnc *tnc, uint8_t c) {
+    tnc->txbuf[(tnc->txhead + tnc->txlen++) % tnc->txbufsz] = c;
+}
+
+static ssize_t tx_enqueue(patty_kiss_tnc *tnc,
+                          enum patty_kiss_command command,
+                          int port,
+                          const void *buf,
+                          size_t len) {
+    size_t i;
+
+    /*
+     * Make room for the worst case, wherein every byte must be escaped, plus
+     * the command byte and both frame delimiters
+     */
+    if (tnc->txbufsz - tnc->txlen < 2 * len + 3) {
+        if (patty_kiss_tnc_transmit(tnc) < 0) {
+            goto error_transmit;
+        }
+
+        if (tnc->txbufsz - tnc->txlen < 2 * len + 3) {
+            tnc->stats.dropped++;
+
+            return len;
+        }
+    }
+
+    tx_put(tnc, PATTY_KISS_FEND);
+    tx_put(tnc, ((port & 0x0f) << 4) | (command & 0x0f));
+
+    for (i=0; i<len; i++) {
+        uint8_t c = ((uint8_t *)buf)[i];
+
+        switch (c) {
+            case PATTY_KISS_FEND:
+                tx_put(tnc, PATTY_KISS_FESC);
+                tx_put(tnc, PATTY_KISS_TFEND);
+
+                break;
+
+            case PATTY_KISS_FESC:
+                tx_put(tnc, PATTY_KISS_FESC);
+                tx_put(tnc, PATTY_KISS_TFESC);
+
+                break;
+
+            default:
+                tx_put(tnc, c);
+        }
+    }
+
+    tx_put(tnc, PATTY_KISS_FEND);
+
+    if (patty_kiss_tnc_transmit(tnc) < 0) {
+        goto error_transmit;
+    }
+
+    return len;
+
+error_transmit:
+    return -1;
+}
+
 ssize_t patty_kiss_tnc_send(patty_kiss_tnc *tnc,
                             const void *buf,
                             size_t len) {
+    if (tnc->txbuf) {
+        return tx_enqueue(tnc, PATTY_KISS_DATA, PATTY_KISS_TNC_PORT, buf, len);
+    }
+
     return patty_kiss_frame_send(tnc->fd, buf, len, PATTY_KISS_TNC_PORT);
 }
 
+ssize_t patty_kiss_tnc_send_dropped(patty_kiss_tnc *tnc, uint32_t count) {
+    uint8_t notice[4] = {
+        (count >> 24) & 0xff,
+        (count >> 16) & 0xff,
+        (count >>  8) & 0xff,
+         count        & 0xff
+    };
+
+    if (tnc->txbuf) {
+        return tx_enqueue(tnc,
+                          PATTY_KISS_HW_SET,
+                          PATTY_KISS_TNC_PORT_DROPPED,
+                          notice,
+                          sizeof(notice));
+    }
+
+    return patty_kiss_hw_send(tnc->fd,
+                              notice,
+                              sizeof(notice),
+                              PATTY_KISS_TNC_PORT_DROPPED);
+}
+
+ssize_t patty_kiss_tnc_queued(patty_kiss_tnc *tnc) {
+    /*
+     * Have the caller watch a connection in progress for writability, which
+     * is when it completes, even with no output queued
+     */
+    if ((tnc->opts & TNC_TCP)
+     && tnc->tcp_state == TCP_CONNECTING
+     && tnc->txlen == 0) {
+        return 1;
+    }
+
+    return tnc->txlen;
+}
+
+ssize_t patty_kiss_tnc_transmit(patty_kiss_tnc *tnc) {
+    size_t total = 0;
+
+    if ((tnc->opts & TNC_TCP)
+     && tnc->tcp_state == TCP_CONNECTING
+     && !tcp_complete(tnc)) {
+        return 0;
+    }
+
+    while (tnc->txlen) {
+        size_t len = tnc->txbufsz - tnc->txhead;
+        ssize_t wrlen;
+
+        if (len > tnc->txlen) {
+            len = tnc->txlen;
+        }
+
+        if (tnc->opts & TNC_TCP) {
+            /*
+             * Leave a lost connection to be noticed upon the next read, and
+             * never raise SIGPIPE over it
+             */
+            if (tnc->tcp_state == TCP_WAITING) {
+                break;
+            }
+
+            if ((wrlen = send(tnc->fd,
+                              tnc->txbuf + tnc->txhead,
+                              len,
+                              MSG_NOSIGNAL)) < 0) {
+                break;
+            }
+        } else if ((wrlen = write(tnc->fd, tnc->txbuf + tnc->txhead, len)) < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+
+            goto error_write;
+        }
+
+        tnc->txhead  = (tnc->txhead + wrlen) % tnc->txbufsz;
+        tnc->txlen  -= wrlen;
+
+        total += wrlen;
+
+        if (wrlen < len) {
+            break;
+        }
+    }
+
+    if (tnc->txlen == 0) {
+        tnc->txhead = 0;
+    }
+
+    return total;
+
+error_write:
+    return -1;
+}
+
+int patty_kiss_tnc_param_set(patty_kiss_tnc *tnc,
+                             enum patty_ax25_if_param param,
+                             uint32_t value) {
+    enum patty_kiss_command command;
+
+    switch (param) {
+        case PATTY_AX25_IF_PARAM_TXDELAY:
+            command = PATTY_KISS_TXDELAY; break;
+
+        case PATTY_AX25_IF_PARAM_PERSIST:
+            command = PATTY_KISS_PERSISTENCE; break;
+
+        case PATTY_AX25_IF_PARAM_SLOT_TIME:
+            command = PATTY_KISS_SLOT_TIME; break;
+
+        case PATTY_AX25_IF_PARAM_TX_TAIL:
+            command = PATTY_KISS_TX_TAIL; break;
+
+        case PATTY_AX25_IF_PARAM_FULL_DUPLEX:
+            command = PATTY_KISS_FULL_DUPLEX; break;
+
+        default:
+            errno = EINVAL;
+
+            goto error_invalid;
+    }
+
+    if (value > 0xff) {
+        errno = ERANGE;
+
+        goto error_invalid;
+    }
+
+    if (tnc->txbuf) {
+        uint8_t c = (uint8_t)value;
+
+        if (tx_enqueue(tnc, command, PATTY_KISS_TNC_PORT, &c, sizeof(c)) < 0) {
+            goto error_command_send;
+        }
+    } else if (patty_kiss_command_send(tnc->fd,
+                                       command,
+                                       (uint8_t)value,
+                                       PATTY_KISS_TNC_PORT) < 0) {
+        goto error_command_send;
+    }
+
+    return 0;
+
+error_command_send:
+error_invalid:
+    return -1;
+}
+
 patty_ax25_if_driver *patty_kiss_tnc_driver() {
     static patty_ax25_if_driver driver = {
         .create  = (patty_ax25_if_driver_create *)patty_kiss_tnc_new,
@@ -422,7 +1087,12 @@ patty_ax25_if_driver *patty_kiss_tnc_driver() {
         .drain   = (patty_ax25_if_driver_drain *)patty_kiss_tnc_drain,
         .pending = (patty_ax25_if_driver_pending *)patty_kiss_tnc_pending,
         .flush   = (patty_ax25_if_driver_flush *)patty_kiss_tnc_flush,
-        .send    = (patty_ax25_if_driver_send *)patty_kiss_tnc_send
+        .send    = (patty_ax25_if_driver_send *)patty_kiss_tnc_send,
+
+        .queued   = (patty_ax25_if_driver_queued *)patty_kiss_tnc_queued,
+        .transmit = (patty_ax25_if_driver_transmit *)patty_kiss_tnc_transmit,
+
+        .param_set = (patty_ax25_if_driver_param_set *)patty_kiss_tnc_param_set
     };
 
     return &driver;
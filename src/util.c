@@ -1,3 +1,9 @@
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+
 #include <patty/util.h>
 
 ssize_t patty_strlcpy(char *dest, const char *src, size_t n) {
@@ -15,3 +21,136 @@ ssize_t patty_strlcpy(char *dest, const char *src, size_t n) {
 
     return i;
 }
+
+/*
+ * Send or receive a message along with up to PATTY_FDS_MAX file descriptors
+ * passed as SCM_RIGHTS ancillary data
+ */
+ssize_t patty_send_fds(int sock,
+                       const void *buf,
+                       size_t len,
+                       const int *fds,
+                       size_t n_fds) {
+    struct iovec iov = {
+        .iov_base = (void *)buf,
+        .iov_len  = len
+    };
+
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(PATTY_FDS_MAX * sizeof(int))];
+    } control;
+
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    if (n_fds > PATTY_FDS_MAX) {
+        errno = EINVAL;
+
+        goto error_invalid;
+    }
+
+    memset(&msg, '\0', sizeof(msg));
+
+    msg.msg_iov    = &iov;
+    msg.msg_iovlen = 1;
+
+    if (n_fds > 0) {
+        memset(&control, '\0', sizeof(control));
+
+        msg.msg_control    = control.buf;
+        msg.msg_controllen = CMSG_SPACE(n_fds * sizeof(int));
+
+        cmsg = CMSG_FIRSTHDR(&msg);
+
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type  = SCM_RIGHTS;
+        cmsg->cmsg_len   = CMSG_LEN(n_fds * sizeof(int));
+
+        memcpy(CMSG_DATA(cmsg), fds, n_fds * sizeof(int));
+    }
+
+    /*
+     * Do not raise SIGPIPE should the receiving end have gone away
+     */
+    return sendmsg(sock, &msg, MSG_NOSIGNAL);
+
+error_invalid:
+    return -1;
+}
+
+ssize_t patty_recv_fds(int sock,
+                       void *buf,
+                       size_t len,
+                       int *fds,
+                       size_t n_fds) {
+    struct iovec iov = {
+        .iov_base = buf,
+        .iov_len  = len
+    };
+
+    union {
+        struct cmsghdr hdr;
+        char buf[CMSG_SPACE(PATTY_FDS_MAX * sizeof(int))];
+    } control;
+
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+
+    ssize_t ret;
+    size_t i;
+
+    memset(&msg, '\0', sizeof(msg));
+
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    for (i=0; i<n_fds; i++) {
+        fds[i] = -1;
+    }
+
+    if ((ret = recvmsg(sock, &msg, 0)) < 0) {
+        goto error_recvmsg;
+    }
+
+    for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        size_t count;
+
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+
+        count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+        for (i=0; i<count; i++) {
+            int fd;
+
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(fd));
+
+            /*
+             * Close any descriptors beyond those the caller asked for, rather
+             * than leaking them
+             */
+            if (i < n_fds) {
+                fds[i] = fd;
+            } else {
+                (void)close(fd);
+            }
+        }
+    }
+
+    return ret;
+
+error_recvmsg:
+    return -1;
+}
+
+ssize_t patty_send_fd(int sock, const void *buf, size_t len, int fd) {
+    return patty_send_fds(sock, buf, len, &fd, fd >= 0? 1: 0);
+}
+
+ssize_t patty_recv_fd(int sock, void *buf, size_t len, int *fd) {
+    return patty_recv_fds(sock, buf, len, fd, 1);
+}